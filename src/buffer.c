@@ -45,9 +45,23 @@ static int	otherfile_buf __ARGS((buf_T *buf, char_u *ffname));
 #ifdef FEAT_TITLE
 static int	ti_change __ARGS((char_u *str, char_u **last));
 #endif
+#ifdef FEAT_STL_OPT
+static int	stl_compile __ARGS((stl_cache_T *cache, char_u *fmt));
+static int	stl_changed __ARGS((win_T *wp, stl_cache_T *cache, int empty_line));
+static void	stl_item_value __ARGS((win_T *wp, stl_citem_T *ci, stl_value_T *sv, char_u *linecont, int empty_line));
+#endif
 static void	free_buffer __ARGS((buf_T *));
 static void	free_buffer_stuff __ARGS((buf_T *buf, int free_options));
 static void	clear_wininfo __ARGS((buf_T *buf));
+static unsigned	buf_name_hash __ARGS((char_u *ffname));
+#ifdef UNIX
+static unsigned	buf_ino_hash __ARGS((long dev, long ino));
+#endif
+static void	buf_hash_add __ARGS((buf_T *buf));
+static void	buf_hash_add_name __ARGS((buf_T *buf));
+static void	buf_hash_del __ARGS((buf_T *buf));
+static void	buf_hash_del_name __ARGS((buf_T *buf));
+static int	buf_hash_grow __ARGS((void));
 
 #ifdef UNIX
 # define dev_T dev_t
@@ -60,6 +74,27 @@ static void insert_sign __ARGS((buf_T *buf, signlist_T *prev, signlist_T *next,
 static void buf_delete_signs __ARGS((buf_T *buf));
 #endif
 
+/*
+ * Hash tables to quickly find a buffer by number, by full file name and, on
+ * Unix, by device and inode number.  All buffers in the buffer list are in
+ * bufhash_nr[], through b_nr_next.  Buffers with a name are also in
+ * bufhash_name[], through b_name_next, and buffers with a known inode in
+ * bufhash_ino[], through b_ino_next.  The hash value is remembered in the
+ * buffer, so that it can be removed after the name changed.
+ * The tables all have "bufhash_size" entries, a power of two.  When there are
+ * more than twice as many buffers they are made twice as big.
+ */
+static buf_T	**bufhash_nr = NULL;
+static buf_T	**bufhash_name = NULL;
+#ifdef UNIX
+static buf_T	**bufhash_ino = NULL;
+#endif
+static int	bufhash_size = 0;
+static int	bufhash_count = 0;	/* number of buffers in bufhash_nr[] */
+
+#define BUFHASH_INIT	64		/* initial size of the hash tables */
+#define BUFHASH(h)	((h) & (bufhash_size - 1))
+
 /*
  * Open current buffer, that is: open the memfile and read the file into memory
  * return FAIL for failure, OK otherwise
@@ -574,6 +609,7 @@ buf_freeall(buf, del_buf, wipe_buf)
 free_buffer(buf)
     buf_T	*buf;
 {
+    buf_hash_del(buf);
     free_buffer_stuff(buf, TRUE);
 #ifdef FEAT_PERL
     perl_buf_free(buf);
@@ -1611,6 +1647,10 @@ buflist_new(ffname, sfname, lnum, flags)
 	buf->b_ino = st.st_ino;
     }
 #endif
+    if (buf == curbuf)
+	buf_hash_update(buf);
+    else
+	buf_hash_add(buf);
     buf->b_u_synced = TRUE;
     buf->b_flags = BF_CHECK_RO | BF_NEVERLOADED;
     buf_clear_file(buf);
@@ -1866,15 +1906,44 @@ buflist_findname_stat(ffname, stp)
 {
 #endif
     buf_T	*buf;
+    buf_T	*found = NULL;
+    unsigned	hash;
+
+    if (ffname == NULL || *ffname == NUL || bufhash_size == 0)
+	return NULL;
+
+    /* When several buffers match use the oldest one, the first in the
+     * buffer list. */
+    hash = buf_name_hash(ffname);
+    for (buf = bufhash_name[BUFHASH(hash)]; buf != NULL; buf = buf->b_name_next)
+	if (buf->b_name_hash == hash
+		&& buf->b_ffname != NULL
+		&& fnamecmp(ffname, buf->b_ffname) == 0
+		&& (found == NULL || buf->b_fnum < found->b_fnum))
+	    found = buf;
 
-    for (buf = firstbuf; buf != NULL; buf = buf->b_next)
-	if (!otherfile_buf(buf, ffname
 #ifdef UNIX
-		    , stp
+    /* Use dev/ino to find the same file with another name, see
+     * otherfile_buf().  Get the dev/ino of a buffer again when they appear
+     * to match.  When they changed the buffer moves to another hash list,
+     * start all over then. */
+    if (stp->st_dev != (dev_T)-1)
+    {
+	hash = buf_ino_hash((long)stp->st_dev, (long)stp->st_ino);
+again:
+	for (buf = bufhash_ino[BUFHASH(hash)]; buf != NULL;
+							 buf = buf->b_ino_next)
+	    if (buf_same_ino(buf, stp) && buf != found
+		    && (found == NULL || buf->b_fnum < found->b_fnum))
+	    {
+		buf_setino(buf);
+		if (!buf_same_ino(buf, stp))
+		    goto again;
+		found = buf;
+	    }
+    }
 #endif
-		    ))
-	    return buf;
-    return NULL;
+    return found;
 }
 
 #if defined(FEAT_LISTCMDS) || defined(FEAT_EVAL) || defined(FEAT_PERL) || defined(PROTO)
@@ -2145,12 +2214,259 @@ buflist_findnr(nr)
 
     if (nr == 0)
 	nr = curwin->w_alt_fnum;
-    for (buf = firstbuf; buf != NULL; buf = buf->b_next)
+    if (bufhash_size == 0)
+	return NULL;
+    for (buf = bufhash_nr[BUFHASH((unsigned)nr)]; buf != NULL;
+							  buf = buf->b_nr_next)
 	if (buf->b_fnum == nr)
 	    return (buf);
     return NULL;
 }
 
+/*
+ * Compute the hash value for a full file name.  Must give the same value for
+ * names that fnamecmp() considers equal.
+ */
+    static unsigned
+buf_name_hash(ffname)
+    char_u	*ffname;
+{
+    unsigned	hash = 0;
+    char_u	*p;
+    int		c;
+
+    for (p = ffname; *p != NUL; ++p)
+    {
+	c = *p;
+#ifdef BACKSLASH_IN_FILENAME
+	if (c == '\\')
+	    c = '/';
+#endif
+#ifdef CASE_INSENSITIVE_FILENAME
+	/* Case folding of non-ASCII characters depends on the encoding, leave
+	 * them out. */
+	if (c >= 0x80)
+	    continue;
+	c = TOLOWER_ASC(c);
+#endif
+	hash = hash * 101 + c;
+    }
+    return hash;
+}
+
+#ifdef UNIX
+    static unsigned
+buf_ino_hash(dev, ino)
+    long	dev;
+    long	ino;
+{
+    return (unsigned)ino * 31 + (unsigned)dev;
+}
+#endif
+
+/*
+ * Add buffer "buf" to the hash tables.  It must already be in the buffer
+ * list.
+ */
+    static void
+buf_hash_add(buf)
+    buf_T	*buf;
+{
+    unsigned	h;
+
+    if (bufhash_count >= bufhash_size * 2 && buf_hash_grow() == OK)
+	return;		/* buf_hash_grow() added all buffers in the list */
+    if (bufhash_size == 0)
+	return;		/* out of memory */
+
+    h = BUFHASH((unsigned)buf->b_fnum);
+    buf->b_nr_next = bufhash_nr[h];
+    bufhash_nr[h] = buf;
+    ++bufhash_count;
+    buf_hash_add_name(buf);
+}
+
+/*
+ * Add buffer "buf" to the hash tables for the file name and inode.
+ */
+    static void
+buf_hash_add_name(buf)
+    buf_T	*buf;
+{
+    unsigned	h;
+
+    buf->b_name_hashed = FALSE;
+    if (buf->b_ffname != NULL)
+    {
+	buf->b_name_hash = buf_name_hash(buf->b_ffname);
+	h = BUFHASH(buf->b_name_hash);
+	buf->b_name_next = bufhash_name[h];
+	bufhash_name[h] = buf;
+	buf->b_name_hashed = TRUE;
+    }
+#ifdef UNIX
+    buf->b_ino_hashed = FALSE;
+    if (buf->b_dev >= 0)
+    {
+	buf->b_ino_hash = buf_ino_hash((long)buf->b_dev, (long)buf->b_ino);
+	h = BUFHASH(buf->b_ino_hash);
+	buf->b_ino_next = bufhash_ino[h];
+	bufhash_ino[h] = buf;
+	buf->b_ino_hashed = TRUE;
+    }
+#endif
+}
+
+/*
+ * Remove buffer "buf" from the hash tables, if it is there.
+ */
+    static void
+buf_hash_del(buf)
+    buf_T	*buf;
+{
+    buf_T	**pp;
+
+    if (bufhash_size == 0)
+	return;
+    for (pp = &bufhash_nr[BUFHASH((unsigned)buf->b_fnum)]; *pp != NULL;
+						     pp = &(*pp)->b_nr_next)
+	if (*pp == buf)
+	{
+	    *pp = buf->b_nr_next;
+	    --bufhash_count;
+	    buf_hash_del_name(buf);
+	    break;
+	}
+}
+
+/*
+ * Remove buffer "buf" from the hash tables for the file name and inode.
+ */
+    static void
+buf_hash_del_name(buf)
+    buf_T	*buf;
+{
+    buf_T	**pp;
+
+    if (buf->b_name_hashed)
+    {
+	for (pp = &bufhash_name[BUFHASH(buf->b_name_hash)]; *pp != NULL;
+						   pp = &(*pp)->b_name_next)
+	    if (*pp == buf)
+	    {
+		*pp = buf->b_name_next;
+		break;
+	    }
+	buf->b_name_hashed = FALSE;
+    }
+#ifdef UNIX
+    if (buf->b_ino_hashed)
+    {
+	for (pp = &bufhash_ino[BUFHASH(buf->b_ino_hash)]; *pp != NULL;
+						    pp = &(*pp)->b_ino_next)
+	    if (*pp == buf)
+	    {
+		*pp = buf->b_ino_next;
+		break;
+	    }
+	buf->b_ino_hashed = FALSE;
+    }
+#endif
+}
+
+/*
+ * Must be called when the file name or the inode of "buf" changed, to move it
+ * to the right place in the hash tables.
+ */
+    void
+buf_hash_update(buf)
+    buf_T	*buf;
+{
+    buf_T	*bp;
+
+    if (bufhash_size == 0)
+	return;
+
+    /* Nothing to do when the hash values didn't change, this is called
+     * often. */
+    if (buf->b_name_hashed ? (buf->b_ffname != NULL
+			 && buf_name_hash(buf->b_ffname) == buf->b_name_hash)
+						       : buf->b_ffname == NULL)
+    {
+#ifdef UNIX
+	if (buf->b_ino_hashed ? (buf->b_dev >= 0
+		    && buf_ino_hash((long)buf->b_dev, (long)buf->b_ino)
+							   == buf->b_ino_hash)
+							 : buf->b_dev < 0)
+#endif
+	    return;
+    }
+
+    /* Only for a buffer that is in the tables. */
+    for (bp = bufhash_nr[BUFHASH((unsigned)buf->b_fnum)]; bp != buf;
+							    bp = bp->b_nr_next)
+	if (bp == NULL)
+	    return;
+    buf_hash_del_name(buf);
+    buf_hash_add_name(buf);
+}
+
+/*
+ * Allocate the hash tables, or make them twice as big, and add all buffers in
+ * the buffer list.
+ * Returns FAIL when out of memory, the old tables are still used then.
+ */
+    static int
+buf_hash_grow()
+{
+    int		size;
+    buf_T	**nr, **name;
+#ifdef UNIX
+    buf_T	**ino;
+#endif
+    buf_T	*buf;
+    unsigned	h;
+
+    size = bufhash_size == 0 ? BUFHASH_INIT : bufhash_size * 2;
+    nr = (buf_T **)alloc_clear((unsigned)(size * sizeof(buf_T *)));
+    name = (buf_T **)alloc_clear((unsigned)(size * sizeof(buf_T *)));
+#ifdef UNIX
+    ino = (buf_T **)alloc_clear((unsigned)(size * sizeof(buf_T *)));
+    if (ino == NULL)
+    {
+	vim_free(nr);
+	nr = NULL;
+    }
+#endif
+    if (nr == NULL || name == NULL)
+    {
+	vim_free(nr);
+	vim_free(name);
+	return FAIL;
+    }
+
+    vim_free(bufhash_nr);
+    vim_free(bufhash_name);
+    bufhash_nr = nr;
+    bufhash_name = name;
+#ifdef UNIX
+    vim_free(bufhash_ino);
+    bufhash_ino = ino;
+#endif
+    bufhash_size = size;
+    bufhash_count = 0;
+
+    for (buf = firstbuf; buf != NULL; buf = buf->b_next)
+    {
+	h = BUFHASH((unsigned)buf->b_fnum);
+	buf->b_nr_next = bufhash_nr[h];
+	bufhash_nr[h] = buf;
+	++bufhash_count;
+	buf_hash_add_name(buf);
+    }
+    return OK;
+}
+
 /*
  * Get name of file 'n' in the buffer list.
  * When the file has no name an empty string is returned.
@@ -2520,6 +2836,8 @@ buf_name_changed(buf)
     if (buf->b_ml.ml_mfp != NULL)
 	ml_setname(buf);
 
+    buf_hash_update(buf);	/* file name or inode may have changed */
+
     if (curwin->w_buffer == buf)
 	check_arg_idx(curwin);	/* check file name for arg list */
 #ifdef FEAT_TITLE
@@ -2703,6 +3021,7 @@ buf_setino(buf)
     }
     else
 	buf->b_dev = -1;
+    buf_hash_update(buf);
 }
 
 /*
@@ -2859,6 +3178,10 @@ col_print(buf, col, vcol)
 
 static char_u *lasttitle = NULL;
 static char_u *lasticon = NULL;
+#ifdef FEAT_STL_OPT
+static stl_cache_T title_cache;		/* compiled 'titlestring' */
+static stl_cache_T icon_cache;		/* compiled 'iconstring' */
+#endif
 
     void
 maketitle()
@@ -2899,7 +3222,7 @@ maketitle()
 #ifdef FEAT_STL_OPT
 	    if (stl_syntax & STL_IN_TITLE)
 		build_stl_str_hl(curwin, t_str, sizeof(buf),
-					      p_titlestring, 0, maxlen, NULL);
+				 p_titlestring, 0, maxlen, NULL, &title_cache);
 	    else
 #endif
 		t_str = p_titlestring;
@@ -3005,7 +3328,7 @@ maketitle()
 #ifdef FEAT_STL_OPT
 	    if (stl_syntax & STL_IN_ICON)
 		build_stl_str_hl(curwin, i_str, sizeof(buf),
-						    p_iconstring, 0, 0, NULL);
+				       p_iconstring, 0, 0, NULL, &icon_cache);
 	    else
 #endif
 		i_str = p_iconstring;
@@ -3073,6 +3396,558 @@ resettitle()
 #endif /* FEAT_TITLE */
 
 #if defined(FEAT_STL_OPT) || defined(PROTO)
+/*
+ * Compile status line format "fmt" into "cache": Parse it into a list of
+ * items.  The values of the items are cleared.
+ * Returns FAIL when out of memory.
+ */
+    static int
+stl_compile(cache, fmt)
+    stl_cache_T	*cache;
+    char_u	*fmt;
+{
+    char_u	*s;
+    char_u	*d;
+    stl_citem_T	*ci;
+    int		itemcnt = 0;
+    int		minwid;
+    int		maxwid;
+    int		zeropad;
+    int		cached;
+    int		l;
+
+    stl_clear_cache(cache);
+    cache->sc_fmt = vim_strsave(fmt);
+    cache->sc_strings = alloc((unsigned)STRLEN(fmt) + 1);
+    if (cache->sc_fmt == NULL || cache->sc_strings == NULL)
+    {
+	stl_clear_cache(cache);
+	return FAIL;
+    }
+    ga_init2(&cache->sc_items, (int)sizeof(stl_citem_T), 10);
+
+    /* Text and items are copied to sc_strings, each one NUL terminated.  That
+     * always fits, "%" and "}" take the place of the NULs. */
+    d = cache->sc_strings;
+    for (s = fmt; *s != NUL; )
+    {
+	if (ga_grow(&cache->sc_items, 1) == FAIL)
+	{
+	    stl_clear_cache(cache);
+	    return FAIL;
+	}
+	ci = (stl_citem_T *)cache->sc_items.ga_data + cache->sc_items.ga_len;
+	vim_memset(ci, 0, sizeof(stl_citem_T));
+
+	if (*s != '%' || s[1] == '%')
+	{
+	    /* Literal text, up to the next item.  "%%" is a literal '%'. */
+	    ci->ci_type = STL_CI_TEXT;
+	    ci->ci_text = d;
+	    while (*s != NUL)
+	    {
+		if (*s == '%')
+		{
+		    if (s[1] != '%')
+			break;
+		    ++s;
+		}
+		*d++ = *s++;
+	    }
+	    *d++ = NUL;
+	    ++cache->sc_items.ga_len;
+	    --cache->sc_items.ga_room;
+	    continue;
+	}
+
+	/* Drop items that don't fit in the item[] array of
+	 * build_stl_str_hl(). */
+	if (++itemcnt >= STL_MAX_ITEM)
+	    break;
+
+	s++;
+	if (*s == STL_MIDDLEMARK || *s == STL_TRUNCMARK || *s == ')')
+	{
+	    ci->ci_type = *s == STL_MIDDLEMARK ? STL_CI_MIDDLE
+			: *s == STL_TRUNCMARK ? STL_CI_TRUNC : STL_CI_GROUPEND;
+	    s++;
+	    ++cache->sc_items.ga_len;
+	    --cache->sc_items.ga_room;
+	    continue;
+	}
+
+	minwid = 0;
+	maxwid = 9999;
+	zeropad = FALSE;
+	l = 1;
+	if (*s == '0')
+	{
+	    s++;
+	    zeropad = TRUE;
+	}
+	if (*s == '-')
+	{
+	    s++;
+	    l = -1;
+	}
+	if (VIM_ISDIGIT(*s))
+	{
+	    minwid = (int)getdigits(&s);
+	    if (minwid < 0)	/* overflow */
+		minwid = 0;
+	}
+	if (*s == STL_HIGHLIGHT)
+	{
+	    ci->ci_type = STL_CI_HIGHLIGHT;
+	    ci->ci_minwid = minwid > 9 ? 1 : minwid;
+	    s++;
+	    ++cache->sc_items.ga_len;
+	    --cache->sc_items.ga_room;
+	    continue;
+	}
+	if (*s == '.')
+	{
+	    s++;
+	    if (VIM_ISDIGIT(*s))
+	    {
+		maxwid = (int)getdigits(&s);
+		if (maxwid <= 0)	/* overflow */
+		    maxwid = 50;
+	    }
+	}
+	minwid = (minwid > 50 ? 50 : minwid) * l;
+	ci->ci_minwid = minwid;
+	ci->ci_maxwid = maxwid;
+	ci->ci_zeropad = zeropad;
+	if (*s == '(')
+	{
+	    ci->ci_type = STL_CI_GROUP;
+	    s++;
+	    ++cache->sc_items.ga_len;
+	    --cache->sc_items.ga_room;
+	    continue;
+	}
+	/* "%!{expr}": the value of the expression is remembered */
+	cached = (*s == STL_EXPR_CACHED && s[1] == STL_VIM_EXPR);
+	if (cached)
+	    s++;
+	if (*s == NUL || vim_strchr(STL_ALL, *s) == NULL)
+	{
+	    if (*s != NUL)
+		s++;
+	    --itemcnt;
+	    continue;
+	}
+
+	ci->ci_type = STL_CI_ITEM;
+	ci->ci_opt = *s++;
+	switch (ci->ci_opt)
+	{
+	    case STL_VIM_EXPR:
+		/* The text of the expression, without the "}".  When the
+		 * "}" is missing ci_text is NULL.  The result may depend on
+		 * anything, e.g., the time, it's only remembered for
+		 * "%!{expr}". */
+		if (cached)
+		    ci->ci_deps = STL_DEP_CURSOR | STL_DEP_BUFFER
+					     | STL_DEP_MODE | STL_DEP_OTHER;
+		else
+		    ci->ci_deps = STL_DEP_ALWAYS;
+		ci->ci_text = d;
+		while (*s != '}' && *s != NUL)
+		    *d++ = *s++;
+		*d++ = NUL;
+		if (*s == '}')
+		    s++;
+		else
+		    ci->ci_text = NULL;
+		break;
+
+	    case STL_LINE:
+	    case STL_NUMLINES:
+	    case STL_PERCENTAGE:
+	    case STL_ALTPERCENT:
+		ci->ci_deps = STL_DEP_CURSOR | STL_DEP_BUFFER;
+		break;
+
+	    case STL_COLUMN:
+	    case STL_VIRTCOL:
+	    case STL_VIRTCOL_ALT:
+	    case STL_OFFSET:
+	    case STL_OFFSET_X:
+	    case STL_BYTEVAL:
+	    case STL_BYTEVAL_X:
+		ci->ci_deps = STL_DEP_CURSOR | STL_DEP_BUFFER | STL_DEP_MODE;
+		break;
+
+	    case STL_KEYMAP:
+	    case STL_PAGENUM:
+		ci->ci_deps = STL_DEP_ALWAYS;
+		break;
+
+	    default:
+		/* file name, flags, buffer number, argument list */
+		ci->ci_deps = STL_DEP_BUFFER;
+		break;
+	}
+	++cache->sc_items.ga_len;
+	--cache->sc_items.ga_room;
+    }
+
+    cache->sc_values = (stl_value_T *)alloc_clear((unsigned)
+		     (sizeof(stl_value_T) * (cache->sc_items.ga_len + 1)));
+    if (cache->sc_values == NULL)
+    {
+	stl_clear_cache(cache);
+	return FAIL;
+    }
+    return OK;
+}
+
+/*
+ * Free the compiled format and the values in "cache".
+ */
+    void
+stl_clear_cache(cache)
+    stl_cache_T	*cache;
+{
+    int		i;
+
+    if (cache->sc_values != NULL)
+    {
+	for (i = 0; i < cache->sc_items.ga_len; ++i)
+	    vim_free(cache->sc_values[i].sv_str);
+	vim_free(cache->sc_values);
+	cache->sc_values = NULL;
+    }
+    ga_clear(&cache->sc_items);
+    vim_free(cache->sc_fmt);
+    cache->sc_fmt = NULL;
+    vim_free(cache->sc_strings);
+    cache->sc_strings = NULL;
+}
+
+/*
+ * Check what changed for window "wp" since the values in "cache" were
+ * computed and remember the current state.
+ * Returns the STL_DEP_ flags for what changed.
+ */
+    static int
+stl_changed(wp, cache, empty_line)
+    win_T	*wp;
+    stl_cache_T	*cache;
+    int		empty_line;
+{
+    int		dirty = STL_DEP_ALWAYS;
+    int		changed = bufIsChanged(wp->w_buffer);
+    int		visual = 0;
+
+#ifdef FEAT_VISUAL
+    if (VIsual_active)
+	visual = VIsual_mode;
+#endif
+    if (cache->sc_cursor.lnum != wp->w_cursor.lnum
+	    || cache->sc_cursor.col != wp->w_cursor.col
+#ifdef FEAT_VIRTUALEDIT
+	    || cache->sc_cursor.coladd != wp->w_cursor.coladd
+#endif
+	    || cache->sc_virtcol != wp->w_virtcol
+	    || cache->sc_topline != wp->w_topline
+	    || cache->sc_botline != wp->w_botline
+#ifdef FEAT_DIFF
+	    || cache->sc_topfill != wp->w_topfill
+#endif
+	    || cache->sc_line_count != wp->w_buffer->b_ml.ml_line_count
+	    || cache->sc_empty != empty_line)
+	dirty |= STL_DEP_CURSOR;
+    if (cache->sc_buf != wp->w_buffer
+	    || cache->sc_changedtick != wp->w_buffer->b_changedtick
+	    || cache->sc_changed != changed
+	    || cache->sc_tick != stl_tick)
+	dirty |= STL_DEP_BUFFER;
+    if (cache->sc_state != State
+	    || cache->sc_visual != visual
+	    || cache->sc_curwin != (wp == curwin))
+	dirty |= STL_DEP_MODE;
+    if (cache->sc_curbuf != curbuf)
+	dirty |= STL_DEP_OTHER;
+
+    cache->sc_cursor = wp->w_cursor;
+    cache->sc_virtcol = wp->w_virtcol;
+    cache->sc_topline = wp->w_topline;
+    cache->sc_botline = wp->w_botline;
+#ifdef FEAT_DIFF
+    cache->sc_topfill = wp->w_topfill;
+#endif
+    cache->sc_line_count = wp->w_buffer->b_ml.ml_line_count;
+    cache->sc_empty = empty_line;
+    cache->sc_buf = wp->w_buffer;
+    cache->sc_changedtick = wp->w_buffer->b_changedtick;
+    cache->sc_changed = changed;
+    cache->sc_tick = stl_tick;
+    cache->sc_state = State;
+    cache->sc_visual = visual;
+    cache->sc_curwin = (wp == curwin);
+    cache->sc_curbuf = curbuf;
+    return dirty;
+}
+
+/*
+ * Compute the value of status line item "ci" for window "wp" and store it in
+ * "sv".
+ */
+    static void
+stl_item_value(wp, ci, sv, linecont, empty_line)
+    win_T	*wp;
+    stl_citem_T	*ci;
+    stl_value_T	*sv;
+    char_u	*linecont;
+    int		empty_line;
+{
+    int		opt = ci->ci_opt;
+    char_u	*str = NULL;
+    long	num = -1;
+    int		itemisflag = FALSE;
+    int		fillable = TRUE;
+    char_u	*t;
+#ifdef FEAT_BYTEOFF
+    long	l;
+#endif
+    colnr_T	virtcol;
+#ifdef FEAT_EVAL
+    win_T	*o_curwin;
+    buf_T	*o_curbuf;
+    long	o_stl_tick;
+#endif
+#define TMPLEN 70
+    char_u	tmp[TMPLEN];
+
+    switch (opt)
+    {
+    case STL_FILEPATH:
+    case STL_FULLPATH:
+    case STL_FILENAME:
+	fillable = FALSE;	/* don't change ' ' to fillchar */
+	if (buf_spname(wp->w_buffer) != NULL)
+	    STRCPY(NameBuff, buf_spname(wp->w_buffer));
+	else
+	{
+	    t = (opt == STL_FULLPATH) ? wp->w_buffer->b_ffname
+				    : wp->w_buffer->b_fname;
+	    home_replace(wp->w_buffer, t, NameBuff, MAXPATHL, TRUE);
+	}
+	trans_characters(NameBuff, MAXPATHL);
+	if (opt != STL_FILENAME)
+	    str = NameBuff;
+	else
+	    str = gettail(NameBuff);
+	break;
+
+    case STL_VIM_EXPR: /* '{' */
+	itemisflag = TRUE;
+	if (ci->ci_text == NULL)	/* missing '}' */
+	    break;
+
+#ifdef FEAT_EVAL
+	sprintf((char *)tmp, "%d", curbuf->b_fnum);
+	set_internal_string_var((char_u *)"actual_curbuf", tmp);
+
+	o_curbuf = curbuf;
+	o_curwin = curwin;
+	curwin = wp;
+	curbuf = wp->w_buffer;
+
+	/* Commands executed by the expression must not cause all status
+	 * lines to be computed again. */
+	o_stl_tick = stl_tick;
+	sv->sv_str = eval_to_string_safe(ci->ci_text, &t);
+	stl_tick = o_stl_tick;
+
+	curwin = o_curwin;
+	curbuf = o_curbuf;
+	do_unlet((char_u *)"g:actual_curbuf");
+
+	if (sv->sv_str != NULL && *sv->sv_str != 0)
+	{
+	    if (*skipdigits(sv->sv_str) == NUL)
+	    {
+		num = atoi((char *)sv->sv_str);
+		vim_free(sv->sv_str);
+		sv->sv_str = NULL;
+		itemisflag = FALSE;
+	    }
+	}
+#endif
+	break;
+
+    case STL_LINE:
+	num = (wp->w_buffer->b_ml.ml_flags & ML_EMPTY)
+	      ? 0L : (long)(wp->w_cursor.lnum);
+	break;
+
+    case STL_NUMLINES:
+	num = wp->w_buffer->b_ml.ml_line_count;
+	break;
+
+    case STL_COLUMN:
+	num = !(State & INSERT) && empty_line
+	      ? 0 : (int)wp->w_cursor.col + 1;
+	break;
+
+    case STL_VIRTCOL:
+    case STL_VIRTCOL_ALT:
+	/* In list mode virtcol needs to be recomputed */
+	virtcol = wp->w_virtcol;
+	if (wp->w_p_list && lcs_tab1 == NUL)
+	{
+	    wp->w_p_list = FALSE;
+	    getvcol(wp, &wp->w_cursor, NULL, &virtcol, NULL);
+	    wp->w_p_list = TRUE;
+	}
+	++virtcol;
+	/* Don't display %V if it's the same as %c. */
+	if (opt == STL_VIRTCOL_ALT
+		&& (virtcol == (colnr_T)(!(State & INSERT) && empty_line
+			? 0 : (int)wp->w_cursor.col + 1)))
+	    break;
+	num = (long)virtcol;
+	break;
+
+    case STL_PERCENTAGE:
+	num = (int)(((long)wp->w_cursor.lnum * 100L) /
+		    (long)wp->w_buffer->b_ml.ml_line_count);
+	break;
+
+    case STL_ALTPERCENT:
+	str = tmp;
+	get_rel_pos(wp, str);
+	break;
+
+    case STL_ARGLISTSTAT:
+	fillable = FALSE;
+	tmp[0] = 0;
+	if (append_arg_number(wp, tmp, FALSE, (int)sizeof(tmp)))
+	    str = tmp;
+	break;
+
+    case STL_KEYMAP:
+	fillable = FALSE;
+	if (get_keymap_str(wp, tmp, TMPLEN))
+	    str = tmp;
+	break;
+    case STL_PAGENUM:
+#ifdef FEAT_PRINTER
+	num = get_printer_page_num();
+#else
+	num = 0;
+#endif
+	break;
+
+    case STL_BUFNO:
+	num = wp->w_buffer->b_fnum;
+	break;
+
+    case STL_OFFSET_X:
+    case STL_OFFSET:
+#ifdef FEAT_BYTEOFF
+	l = ml_find_line_or_offset(wp->w_buffer, wp->w_cursor.lnum, NULL);
+	num = (wp->w_buffer->b_ml.ml_flags & ML_EMPTY) || l < 0 ?
+	      0L : l + 1 + (!(State & INSERT) && empty_line ?
+			    0 : (int)wp->w_cursor.col);
+#endif
+	break;
+
+    case STL_BYTEVAL_X:
+    case STL_BYTEVAL:
+	if (((State & INSERT) && wp == curwin) || empty_line)
+	    num = 0;
+	else
+	{
+#ifdef FEAT_MBYTE
+	    num = (*mb_ptr2char)(linecont + wp->w_cursor.col);
+#else
+	    num = linecont[wp->w_cursor.col];
+#endif
+	}
+	if (num == NL)
+	    num = 0;
+	else if (num == CAR && get_fileformat(wp->w_buffer) == EOL_MAC)
+	    num = NL;
+	break;
+
+    case STL_ROFLAG:
+    case STL_ROFLAG_ALT:
+	itemisflag = TRUE;
+	if (wp->w_buffer->b_p_ro)
+	    str = (char_u *)((opt == STL_ROFLAG_ALT) ? ",RO" : "[RO]");
+	break;
+
+    case STL_HELPFLAG:
+    case STL_HELPFLAG_ALT:
+	itemisflag = TRUE;
+	if (wp->w_buffer->b_help)
+	    str = (char_u *)((opt == STL_HELPFLAG_ALT) ? ",HLP"
+							   : _("[help]"));
+	break;
+
+#ifdef FEAT_AUTOCMD
+    case STL_FILETYPE:
+	if (*wp->w_buffer->b_p_ft != NUL
+		&& STRLEN(wp->w_buffer->b_p_ft) < TMPLEN - 3)
+	{
+	    sprintf((char *)tmp, "[%s]", wp->w_buffer->b_p_ft);
+	    str = tmp;
+	}
+	break;
+
+    case STL_FILETYPE_ALT:
+	itemisflag = TRUE;
+	if (*wp->w_buffer->b_p_ft != NUL
+		&& STRLEN(wp->w_buffer->b_p_ft) < TMPLEN - 2)
+	{
+	    sprintf((char *)tmp, ",%s", wp->w_buffer->b_p_ft);
+	    for (t = tmp; *t != 0; t++)
+		*t = TOUPPER_LOC(*t);
+	    str = tmp;
+	}
+	break;
+#endif
+
+#if defined(FEAT_WINDOWS) && defined(FEAT_QUICKFIX)
+    case STL_PREVIEWFLAG:
+    case STL_PREVIEWFLAG_ALT:
+	itemisflag = TRUE;
+	if (wp->w_p_pvw)
+	    str = (char_u *)((opt == STL_PREVIEWFLAG_ALT) ? ",PRV"
+							: _("[Preview]"));
+	break;
+#endif
+
+    case STL_MODIFIED:
+    case STL_MODIFIED_ALT:
+	itemisflag = TRUE;
+	switch ((opt == STL_MODIFIED_ALT)
+		+ bufIsChanged(wp->w_buffer) * 2
+		+ (!wp->w_buffer->b_p_ma) * 4)
+	{
+	    case 2: str = (char_u *)"[+]"; break;
+	    case 3: str = (char_u *)",+"; break;
+	    case 4: str = (char_u *)"[-]"; break;
+	    case 5: str = (char_u *)",-"; break;
+	    case 6: str = (char_u *)"[+-]"; break;
+	    case 7: str = (char_u *)",+-"; break;
+	}
+	break;
+    }
+
+    if (str != NULL)
+	sv->sv_str = vim_strsave(str);
+    sv->sv_num = num;
+    sv->sv_isflag = itemisflag;
+    sv->sv_fillable = fillable;
+    sv->sv_valid = TRUE;
+}
+
 /*
  * Build a string from the status line items in fmt.
  * Return length of string in screen cells.
@@ -3083,9 +3958,13 @@ resettitle()
  *
  * If maxwidth is not zero, the string will be filled at any middle marker
  * or truncated if too long, fillchar is used for all whitespace.
+ *
+ * When "cache" is not NULL the compiled "fmt" and the item values are kept
+ * there.  An item is only computed again when something it depends on
+ * changed.
  */
     int
-build_stl_str_hl(wp, out, outlen, fmt, fillchar, maxwidth, hl)
+build_stl_str_hl(wp, out, outlen, fmt, fillchar, maxwidth, hl, cache)
     win_T	*wp;
     char_u	*out;		/* buffer to write into */
     size_t	outlen;		/* length of out[] */
@@ -3093,17 +3972,13 @@ build_stl_str_hl(wp, out, outlen, fmt, fillchar, maxwidth, hl)
     int		fillchar;
     int		maxwidth;
     struct stl_hlrec *hl;
+    stl_cache_T	*cache;		/* compiled "fmt" or NULL */
 {
     char_u	*p;
     char_u	*s;
     char_u	*t;
     char_u	*linecont;
-#ifdef FEAT_EVAL
-    win_T	*o_curwin;
-    buf_T	*o_curbuf;
-#endif
     int		empty_line;
-    colnr_T	virtcol;
     long	l;
     long	n;
     int		prevchar_isflag;
@@ -3136,9 +4011,32 @@ build_stl_str_hl(wp, out, outlen, fmt, fillchar, maxwidth, hl)
     int		maxwid;
     int		zeropad;
     char_u	base;
-    char_u	opt;
-#define TMPLEN 70
-    char_u	tmp[TMPLEN];
+    int		opt;
+    stl_cache_T	tmpcache;
+    stl_citem_T	*ci;
+    stl_value_T	*sv;
+    int		dirty;
+    int		idx;
+
+    /* Without a cache, or when it is being used by a recursive call, use a
+     * temporary one. */
+    if (cache == NULL || cache->sc_busy)
+    {
+	vim_memset(&tmpcache, 0, sizeof(tmpcache));
+	cache = &tmpcache;
+    }
+    if ((cache->sc_fmt == NULL || STRCMP(cache->sc_fmt, fmt) != 0)
+					       && stl_compile(cache, fmt) == FAIL)
+    {
+	*out = NUL;
+	if (hl != NULL)
+	{
+	    hl->start = NULL;
+	    hl->userhl = 0;
+	}
+	return 0;
+    }
+    cache->sc_busy = TRUE;
 
     if (fillchar == 0)
 	fillchar = ' ';
@@ -3149,55 +4047,49 @@ build_stl_str_hl(wp, out, outlen, fmt, fillchar, maxwidth, hl)
     linecont = ml_get_buf(wp->w_buffer, wp->w_cursor.lnum, FALSE);
     empty_line = (*linecont == NUL);
 
+    dirty = stl_changed(wp, cache, empty_line);
+
     groupdepth = 0;
     p = out;
     curitem = 0;
     prevchar_isflag = TRUE;
     prevchar_isitem = FALSE;
-    for (s = fmt; *s;)
+    for (idx = 0; idx < cache->sc_items.ga_len; ++idx)
     {
-	if (*s != NUL && *s != '%')
-	    prevchar_isflag = prevchar_isitem = FALSE;
+	ci = (stl_citem_T *)cache->sc_items.ga_data + idx;
 
 	/*
-	 * Handle up to the next '%' or the end.
+	 * Handle literal text.
 	 */
-	while (*s != NUL && *s != '%' && p + 1 < out + outlen)
-	    *p++ = *s++;
-	if (*s == NUL || p + 1 >= out + outlen)
+	if (ci->ci_type == STL_CI_TEXT)
+	{
+	    prevchar_isflag = prevchar_isitem = FALSE;
+	    for (s = ci->ci_text; *s != NUL && p + 1 < out + outlen; )
+		*p++ = *s++;
+	    continue;
+	}
+	if (p + 1 >= out + outlen)
 	    break;
 
 	/*
 	 * Handle one '%' item.
 	 */
-	s++;
-	if (*s == '%')
+	if (ci->ci_type == STL_CI_MIDDLE)
 	{
-	    if (p + 1 >= out + outlen)
-		break;
-	    *p++ = *s++;
-	    prevchar_isflag = prevchar_isitem = FALSE;
-	    continue;
-	}
-	if (*s == STL_MIDDLEMARK)
-	{
-	    s++;
 	    if (groupdepth > 0)
 		continue;
 	    item[curitem].type = Middle;
 	    item[curitem++].start = p;
 	    continue;
 	}
-	if (*s == STL_TRUNCMARK)
+	if (ci->ci_type == STL_CI_TRUNC)
 	{
-	    s++;
 	    item[curitem].type = Trunc;
 	    item[curitem++].start = p;
 	    continue;
 	}
-	if (*s == ')')
+	if (ci->ci_type == STL_CI_GROUPEND)
 	{
-	    s++;
 	    if (groupdepth < 1)
 		continue;
 	    groupdepth--;
@@ -3280,291 +4172,43 @@ build_stl_str_hl(wp, out, outlen, fmt, fillchar, maxwidth, hl)
 	    }
 	    continue;
 	}
-	minwid = 0;
-	maxwid = 9999;
-	zeropad = FALSE;
-	l = 1;
-	if (*s == '0')
-	{
-	    s++;
-	    zeropad = TRUE;
-	}
-	if (*s == '-')
-	{
-	    s++;
-	    l = -1;
-	}
-	if (VIM_ISDIGIT(*s))
-	{
-	    minwid = (int)getdigits(&s);
-	    if (minwid < 0)	/* overflow */
-		minwid = 0;
-	}
-	if (*s == STL_HIGHLIGHT)
+	if (ci->ci_type == STL_CI_HIGHLIGHT)
 	{
 	    item[curitem].type = Highlight;
 	    item[curitem].start = p;
-	    item[curitem].minwid = minwid > 9 ? 1 : minwid;
-	    s++;
+	    item[curitem].minwid = ci->ci_minwid;
 	    curitem++;
 	    continue;
 	}
-	if (*s == '.')
-	{
-	    s++;
-	    if (VIM_ISDIGIT(*s))
-	    {
-		maxwid = (int)getdigits(&s);
-		if (maxwid <= 0)	/* overflow */
-		    maxwid = 50;
-	    }
-	}
-	minwid = (minwid > 50 ? 50 : minwid) * l;
-	if (*s == '(')
+	minwid = ci->ci_minwid;
+	maxwid = ci->ci_maxwid;
+	zeropad = ci->ci_zeropad;
+	if (ci->ci_type == STL_CI_GROUP)
 	{
 	    groupitem[groupdepth++] = curitem;
 	    item[curitem].type = Group;
 	    item[curitem].start = p;
 	    item[curitem].minwid = minwid;
 	    item[curitem].maxwid = maxwid;
-	    s++;
 	    curitem++;
 	    continue;
 	}
-	if (vim_strchr(STL_ALL, *s) == NULL)
-	{
-	    s++;
-	    continue;
-	}
-	opt = *s++;
-
-	/* OK - now for the real work */
-	base = 'D';
-	itemisflag = FALSE;
-	fillable = TRUE;
-	num = -1;
-	str = NULL;
-	switch (opt)
-	{
-	case STL_FILEPATH:
-	case STL_FULLPATH:
-	case STL_FILENAME:
-	    fillable = FALSE;	/* don't change ' ' to fillchar */
-	    if (buf_spname(wp->w_buffer) != NULL)
-		STRCPY(NameBuff, buf_spname(wp->w_buffer));
-	    else
-	    {
-		t = (opt == STL_FULLPATH) ? wp->w_buffer->b_ffname
-					: wp->w_buffer->b_fname;
-		home_replace(wp->w_buffer, t, NameBuff, MAXPATHL, TRUE);
-	    }
-	    trans_characters(NameBuff, MAXPATHL);
-	    if (opt != STL_FILENAME)
-		str = NameBuff;
-	    else
-		str = gettail(NameBuff);
-	    break;
-
-	case STL_VIM_EXPR: /* '{' */
-	    itemisflag = TRUE;
-	    t = p;
-	    while (*s != '}' && *s != NUL && p + 1 < out + outlen)
-		*p++ = *s++;
-	    if (*s != '}')	/* missing '}' or out of space */
-		break;
-	    s++;
-	    *p = 0;
-	    p = t;
-
-#ifdef FEAT_EVAL
-	    sprintf((char *)tmp, "%d", curbuf->b_fnum);
-	    set_internal_string_var((char_u *)"actual_curbuf", tmp);
-
-	    o_curbuf = curbuf;
-	    o_curwin = curwin;
-	    curwin = wp;
-	    curbuf = wp->w_buffer;
-
-	    str = eval_to_string_safe(p, &t);
-
-	    curwin = o_curwin;
-	    curbuf = o_curbuf;
-	    do_unlet((char_u *)"g:actual_curbuf");
-
-	    if (str != NULL && *str != 0)
-	    {
-		if (*skipdigits(str) == NUL)
-		{
-		    num = atoi((char *)str);
-		    vim_free(str);
-		    str = NULL;
-		    itemisflag = FALSE;
-		}
-	    }
-#endif
-	    break;
+	opt = ci->ci_opt;
 
-	case STL_LINE:
-	    num = (wp->w_buffer->b_ml.ml_flags & ML_EMPTY)
-		  ? 0L : (long)(wp->w_cursor.lnum);
-	    break;
-
-	case STL_NUMLINES:
-	    num = wp->w_buffer->b_ml.ml_line_count;
-	    break;
-
-	case STL_COLUMN:
-	    num = !(State & INSERT) && empty_line
-		  ? 0 : (int)wp->w_cursor.col + 1;
-	    break;
-
-	case STL_VIRTCOL:
-	case STL_VIRTCOL_ALT:
-	    /* In list mode virtcol needs to be recomputed */
-	    virtcol = wp->w_virtcol;
-	    if (wp->w_p_list && lcs_tab1 == NUL)
-	    {
-		wp->w_p_list = FALSE;
-		getvcol(wp, &wp->w_cursor, NULL, &virtcol, NULL);
-		wp->w_p_list = TRUE;
-	    }
-	    ++virtcol;
-	    /* Don't display %V if it's the same as %c. */
-	    if (opt == STL_VIRTCOL_ALT
-		    && (virtcol == (colnr_T)(!(State & INSERT) && empty_line
-			    ? 0 : (int)wp->w_cursor.col + 1)))
-		break;
-	    num = (long)virtcol;
-	    break;
-
-	case STL_PERCENTAGE:
-	    num = (int)(((long)wp->w_cursor.lnum * 100L) /
-			(long)wp->w_buffer->b_ml.ml_line_count);
-	    break;
-
-	case STL_ALTPERCENT:
-	    str = tmp;
-	    get_rel_pos(wp, str);
-	    break;
-
-	case STL_ARGLISTSTAT:
-	    fillable = FALSE;
-	    tmp[0] = 0;
-	    if (append_arg_number(wp, tmp, FALSE, (int)sizeof(tmp)))
-		str = tmp;
-	    break;
-
-	case STL_KEYMAP:
-	    fillable = FALSE;
-	    if (get_keymap_str(wp, tmp, TMPLEN))
-		str = tmp;
-	    break;
-	case STL_PAGENUM:
-#ifdef FEAT_PRINTER
-	    num = get_printer_page_num();
-#else
-	    num = 0;
-#endif
-	    break;
-
-	case STL_BUFNO:
-	    num = wp->w_buffer->b_fnum;
-	    break;
-
-	case STL_OFFSET_X:
-	    base = 'X';
-	case STL_OFFSET:
-#ifdef FEAT_BYTEOFF
-	    l = ml_find_line_or_offset(wp->w_buffer, wp->w_cursor.lnum, NULL);
-	    num = (wp->w_buffer->b_ml.ml_flags & ML_EMPTY) || l < 0 ?
-		  0L : l + 1 + (!(State & INSERT) && empty_line ?
-				0 : (int)wp->w_cursor.col);
-#endif
-	    break;
-
-	case STL_BYTEVAL_X:
-	    base = 'X';
-	case STL_BYTEVAL:
-	    if (((State & INSERT) && wp == curwin) || empty_line)
-		num = 0;
-	    else
-	    {
-#ifdef FEAT_MBYTE
-		num = (*mb_ptr2char)(linecont + wp->w_cursor.col);
-#else
-		num = linecont[wp->w_cursor.col];
-#endif
-	    }
-	    if (num == NL)
-		num = 0;
-	    else if (num == CAR && get_fileformat(wp->w_buffer) == EOL_MAC)
-		num = NL;
-	    break;
-
-	case STL_ROFLAG:
-	case STL_ROFLAG_ALT:
-	    itemisflag = TRUE;
-	    if (wp->w_buffer->b_p_ro)
-		str = (char_u *)((opt == STL_ROFLAG_ALT) ? ",RO" : "[RO]");
-	    break;
-
-	case STL_HELPFLAG:
-	case STL_HELPFLAG_ALT:
-	    itemisflag = TRUE;
-	    if (wp->w_buffer->b_help)
-		str = (char_u *)((opt == STL_HELPFLAG_ALT) ? ",HLP"
-							       : _("[help]"));
-	    break;
-
-#ifdef FEAT_AUTOCMD
-	case STL_FILETYPE:
-	    if (*wp->w_buffer->b_p_ft != NUL
-		    && STRLEN(wp->w_buffer->b_p_ft) < TMPLEN - 3)
-	    {
-		sprintf((char *)tmp, "[%s]", wp->w_buffer->b_p_ft);
-		str = tmp;
-	    }
-	    break;
-
-	case STL_FILETYPE_ALT:
-	    itemisflag = TRUE;
-	    if (*wp->w_buffer->b_p_ft != NUL
-		    && STRLEN(wp->w_buffer->b_p_ft) < TMPLEN - 2)
-	    {
-		sprintf((char *)tmp, ",%s", wp->w_buffer->b_p_ft);
-		for (t = tmp; *t != 0; t++)
-		    *t = TOUPPER_LOC(*t);
-		str = tmp;
-	    }
-	    break;
-#endif
-
-#if defined(FEAT_WINDOWS) && defined(FEAT_QUICKFIX)
-	case STL_PREVIEWFLAG:
-	case STL_PREVIEWFLAG_ALT:
-	    itemisflag = TRUE;
-	    if (wp->w_p_pvw)
-		str = (char_u *)((opt == STL_PREVIEWFLAG_ALT) ? ",PRV"
-							    : _("[Preview]"));
-	    break;
-#endif
-
-	case STL_MODIFIED:
-	case STL_MODIFIED_ALT:
-	    itemisflag = TRUE;
-	    switch ((opt == STL_MODIFIED_ALT)
-		    + bufIsChanged(wp->w_buffer) * 2
-		    + (!wp->w_buffer->b_p_ma) * 4)
-	    {
-		case 2: str = (char_u *)"[+]"; break;
-		case 3: str = (char_u *)",+"; break;
-		case 4: str = (char_u *)"[-]"; break;
-		case 5: str = (char_u *)",-"; break;
-		case 6: str = (char_u *)"[+-]"; break;
-		case 7: str = (char_u *)",+-"; break;
-	    }
-	    break;
+	/* OK - now for the real work: only compute the value when something
+	 * it depends on changed */
+	sv = &cache->sc_values[idx];
+	if (!sv->sv_valid || (ci->ci_deps & dirty) != 0)
+	{
+	    vim_free(sv->sv_str);
+	    sv->sv_str = NULL;
+	    stl_item_value(wp, ci, sv, linecont, empty_line);
 	}
+	str = sv->sv_str;
+	num = sv->sv_num;
+	itemisflag = sv->sv_isflag;
+	fillable = sv->sv_fillable;
+	base = (opt == STL_OFFSET_X || opt == STL_BYTEVAL_X) ? 'X' : 'D';
 
 	item[curitem].start = p;
 	item[curitem].type = Normal;
@@ -3668,9 +4312,6 @@ build_stl_str_hl(wp, out, outlen, fmt, fillchar, maxwidth, hl)
 	else
 	    item[curitem].type = Empty;
 
-	if (opt == STL_VIM_EXPR)
-	    vim_free(str);
-
 	if (num >= 0 || (!itemisflag && str && *str))
 	    prevchar_isflag = FALSE;	    /* Item not NULL, but not a flag */
 	curitem++;
@@ -3678,6 +4319,10 @@ build_stl_str_hl(wp, out, outlen, fmt, fillchar, maxwidth, hl)
     *p = NUL;
     itemcnt = curitem;
 
+    cache->sc_busy = FALSE;
+    if (cache == &tmpcache)
+	stl_clear_cache(cache);
+
     width = vim_strsize(out);
     if (maxwidth > 0 && width > maxwidth)
     {
@@ -169,6 +169,7 @@ static void ins_drop __ARGS((void));
 #endif
 static int  ins_tab __ARGS((void));
 static int  ins_eol __ARGS((int c));
+static void ins_paste __ARGS((void));
 #ifdef FEAT_DIGRAPHS
 static int  ins_digraph __ARGS((void));
 #endif
@@ -303,7 +304,8 @@ edit(cmdchar, startln, count)
 	else
 #endif
 	{
-	    AppendCharToRedobuff(cmdchar);
+	    /* A paste in Normal mode is repeated like "i" */
+	    AppendCharToRedobuff(cmdchar == K_PS ? 'i' : cmdchar);
 	    if (cmdchar == 'g')		    /* "gI" command */
 		AppendCharToRedobuff('I');
 	    else if (cmdchar == 'r')	    /* "r<CR>" command */
@@ -609,7 +611,15 @@ edit(cmdchar, startln, count)
 	 * Get a character for Insert mode.
 	 */
 	lastc = c;			/* remember previous char for CTRL-D */
-	c = safe_vgetc();
+	if (cmdchar == K_PS)
+	    /* Started from Normal mode for a bracketed paste. */
+	    c = K_PS;
+	else
+	{
+	    allow_paste = TRUE;
+	    c = safe_vgetc();
+	    allow_paste = FALSE;
+	}
 
 #ifdef FEAT_RIGHTLEFT
 	if (p_hkmap && KeyTyped)
@@ -1041,6 +1051,16 @@ doESCkey:
 	case K_IGNORE:
 	    break;
 
+	case K_PS:	/* bracketed paste: insert the text literally */
+	    ins_paste();
+	    if (cmdchar == K_PS)
+		/* back to Normal mode */
+		goto doESCkey;
+	    break;
+
+	case K_PE:	/* end of paste without a start, ignore */
+	    break;
+
 #ifdef FEAT_GUI
 	case K_VER_SCROLLBAR:
 	    ins_scroll();
@@ -7387,6 +7407,166 @@ ins_eol(c)
     return (!i);
 }
 
+/*
+ * Handle a bracketed paste in Insert mode: get all the pasted text and insert
+ * it literally, without mappings, abbreviations, 'autoindent' or
+ * 'textwidth'.  In Insert mode the lines are put in the buffer at once, so
+ * that there is one undo entry and one redraw.  In Replace mode the text
+ * replaces characters like typed text.
+ */
+    static void
+ins_paste()
+{
+    garray_T	ga;
+    char_u	*text;
+    char_u	*p;
+    char_u	*s;
+    char_u	*line;
+    char_u	*last = NULL;
+    int		nlines = 1;
+    int		i;
+    int		len;
+    linenr_T	lnum;
+    colnr_T	col;
+    int		save_ai;
+    int		save_paste;
+
+    ga_init2(&ga, 1, 4096);
+    /* When interrupted insert what was received so far. */
+    (void)get_bracketed_paste(&ga);
+    if (ga.ga_len == 0 || ga_grow(&ga, 1) == FAIL)
+	goto theend;
+    text = (char_u *)ga.ga_data;
+    text[ga.ga_len] = NUL;
+
+    /* Split the text into NUL terminated lines.  A line break is a CR, NL
+     * or CR-NL.  A NUL in the text is stored as a NL. */
+    for (p = text, s = text; s < text + ga.ga_len; ++s)
+    {
+	if (*s == CAR || *s == NL)
+	{
+	    if (*s == CAR && s[1] == NL)
+		++s;
+	    *p++ = NUL;
+	    ++nlines;
+	}
+	else if (*s == NUL)
+	    *p++ = NL;
+	else
+	    *p++ = *s;
+    }
+    *p = NUL;
+
+    if (stop_arrow() == FAIL)
+	goto theend;
+    undisplay_dollar();
+    did_ai = FALSE;
+
+    if (State & REPLACE_FLAG)
+    {
+	/* Replace mode: insert character by character, with 'autoindent'
+	 * and friends switched off. */
+	save_ai = curbuf->b_p_ai;
+	save_paste = p_paste;
+	curbuf->b_p_ai = FALSE;
+	p_paste = TRUE;
+	for (s = text, i = 0; i < nlines; ++i)
+	{
+	    if (i > 0)
+	    {
+#ifdef FEAT_VREPLACE
+		if (!(State & VREPLACE_FLAG))
+#endif
+		    replace_push(NUL);
+		AppendToRedobuff(NL_STR);
+		if (!open_line(FORWARD, 0, 0))
+		    break;
+	    }
+	    AppendToRedobuffLit(s);
+	    while (*s != NUL)
+	    {
+#ifdef FEAT_MBYTE
+		if (has_mbyte && (len = (*mb_ptr2len_check)(s)) > 1)
+		{
+		    ins_char_bytes(s, len);
+		    s += len;
+		}
+		else
+#endif
+		    ins_char(*s++);
+	    }
+	    ++s;
+	}
+	curbuf->b_p_ai = save_ai;
+	p_paste = save_paste;
+	goto theend;
+    }
+
+    lnum = curwin->w_cursor.lnum;
+    col = curwin->w_cursor.col;
+    if (u_save(lnum - 1, lnum + 1) == FAIL)
+	goto theend;
+
+    /* First line: the text before the cursor plus the first pasted line.
+     * When there is only one line also the text after the cursor.  Otherwise
+     * the last line gets the text after the cursor, allocate it before
+     * changing anything, so that this text can't get lost. */
+    p = ml_get(lnum);
+    len = (int)STRLEN(text);
+    line = alloc((unsigned)(STRLEN(p) + len + 1));
+    if (line == NULL)
+	goto theend;
+    if (nlines > 1)
+    {
+	for (s = text, i = 1; i < nlines; ++i)
+	    s += STRLEN(s) + 1;
+	last = alloc((unsigned)(STRLEN(s) + STRLEN(p + col) + 1));
+	if (last == NULL)
+	{
+	    vim_free(line);
+	    goto theend;
+	}
+	STRCPY(last, s);
+	STRCAT(last, p + col);
+	mch_memmove(line, p, (size_t)col);
+	STRCPY(line + col, text);
+    }
+    else
+    {
+	mch_memmove(line, p, (size_t)col);
+	mch_memmove(line + col, text, (size_t)len);
+	STRCPY(line + col + len, p + col);
+    }
+    ml_replace(lnum, line, FALSE);
+    AppendToRedobuffLit(text);
+
+    /* Append the other lines, the last one gets the text after the
+     * cursor. */
+    s = text + len + 1;
+    for (i = 1; i < nlines; ++i)
+    {
+	len = (int)STRLEN(s);
+	if (i == nlines - 1)
+	    ml_append(lnum + i - 1, last, (colnr_T)0, FALSE);
+	else
+	    ml_append(lnum + i - 1, s, (colnr_T)0, FALSE);
+	AppendToRedobuff(NL_STR);
+	AppendToRedobuffLit(s);
+	s += len + 1;
+    }
+
+    if (i > 1)
+	mark_adjust(lnum + 1, (linenr_T)MAXLNUM, (long)(i - 1), 0L);
+    changed_lines(lnum, col, lnum + 1, (long)(i - 1));
+    curwin->w_cursor.lnum = lnum + i - 1;
+    curwin->w_cursor.col = (i == 1 ? col : 0) + len;
+    curwin->w_set_curswant = TRUE;
+
+theend:
+    vim_free(last);
+    ga_clear(&ga);
+}
+
 #ifdef FEAT_DIGRAPHS
 /*
  * Handle digraph in insert mode.
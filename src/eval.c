@@ -92,6 +92,17 @@ struct ufunc
     garray_T	lines;		/* function lines */
     scid_T	script_ID;	/* ID of script where function was defined,
 				   used for s: variables */
+#ifdef FEAT_PROFILE
+    int		profiling;	/* TRUE when func is being profiled */
+    /* profiling the function as a whole */
+    int		tm_count;	/* nr of calls */
+    proftime_T	tm_total;	/* time spend in function + children */
+    proftime_T	tm_self;	/* time spend in function itself */
+    /* profiling the function per line */
+    int		*tml_count;	/* nr of times line was executed */
+    proftime_T	*tml_total;	/* time spend in a line + children */
+    proftime_T	*tml_self;	/* time spend in a line itself */
+#endif
 };
 
 /* function flags */
@@ -123,6 +134,16 @@ struct funccall
     linenr_T	breakpoint;	/* next line with breakpoint or zero */
     int		dbg_tick;	/* debug_tick when breakpoint was set */
     int		level;		/* top nesting level of executed function */
+#ifdef FEAT_PROFILE
+    proftime_T	prof_child;	/* time spent in a child */
+    proftime_T	tm_children;	/* time spent in children this call */
+    /* profiling the function per line */
+    int		tml_idx;	/* index of line being timed; -1 if none */
+    int		tml_execed;	/* line being timed was executed */
+    proftime_T	tml_start;	/* start time for current line */
+    proftime_T	tml_children;	/* time spent in children for this line */
+    proftime_T	tml_wait;	/* start wait time for current line */
+#endif
 };
 
 /*
@@ -413,6 +434,22 @@ static void list_func_head __ARGS((ufunc_T *fp, int indent));
 static void cat_func_name __ARGS((char_u *buf, ufunc_T *fp));
 static ufunc_T *find_func __ARGS((char_u *name));
 static void call_user_func __ARGS((ufunc_T *fp, int argcount, VAR argvars, VAR retvar, linenr_T firstline, linenr_T lastline));
+#ifdef FEAT_PROFILE
+static void func_do_profile __ARGS((ufunc_T *fp));
+static void func_free_profile __ARGS((ufunc_T *fp));
+static void prof_func_line __ARGS((FILE *fd, int count, proftime_T *total, proftime_T *self, int prefer_self));
+static void prof_sort_list __ARGS((FILE *fd, ufunc_T **sorttab, int st_len, char *title, int prefer_self));
+static int
+# ifdef __BORLANDC__
+    _RTLENTRYF
+# endif
+	prof_total_cmp __ARGS((const void *s1, const void *s2));
+static int
+# ifdef __BORLANDC__
+    _RTLENTRYF
+# endif
+	prof_self_cmp __ARGS((const void *s1, const void *s2));
+#endif
 
 /* Magic braces are always enabled, otherwise Vim scripts would not be
  * portable. */
@@ -4970,6 +5007,9 @@ f_has(argvars, retvar)
 #ifdef FEAT_PRINTER
 	"printer",
 #endif
+#ifdef FEAT_PROFILE
+	"profile",
+#endif
 #ifdef FEAT_QUICKFIX
 	"quickfix",
 #endif
@@ -4995,6 +5035,9 @@ f_has(argvars, retvar)
 #ifdef FEAT_SNIFF
 	"sniff",
 #endif
+#ifdef FEAT_STARTUPTIME
+	"startuptime",
+#endif
 #ifdef FEAT_STL_OPT
 	"statusline",
 #endif
@@ -5013,12 +5056,18 @@ f_has(argvars, retvar)
 #ifdef FEAT_TAG_BINS
 	"tag_binary",
 #endif
+#ifdef FEAT_TAG_INDEX
+	"tag_index",
+#endif
 #ifdef FEAT_TAG_OLDSTATIC
 	"tag_old_static",
 #endif
 #ifdef FEAT_TAG_ANYWHITE
 	"tag_any_white",
 #endif
+#ifdef FEAT_TAG_XREF
+	"tag_xref",
+#endif
 #ifdef FEAT_TCL
 # ifndef DYNAMIC_TCL
 	"tcl",
@@ -9111,11 +9160,14 @@ ex_function(eap)
 	/* redefine existing function */
 	ga_clear_strings(&(fp->args));
 	ga_clear_strings(&(fp->lines));
+#ifdef FEAT_PROFILE
+	func_free_profile(fp);
+#endif
 	vim_free(name);
     }
     else
     {
-	fp = (ufunc_T *)alloc((unsigned)sizeof(ufunc_T));
+	fp = (ufunc_T *)alloc_clear((unsigned)sizeof(ufunc_T));
 	if (fp == NULL)
 	    goto erret;
 	/* insert the new function in the function list */
@@ -9129,6 +9181,10 @@ ex_function(eap)
     fp->flags = flags;
     fp->calls = 0;
     fp->script_ID = current_SID;
+#ifdef FEAT_PROFILE
+    if (do_profiling == PROF_YES && prof_def_func())
+	func_do_profile(fp);
+#endif
 #ifdef FEAT_MAGIC_BRACES
     did_emsg |= saved_did_emsg;
 #endif
@@ -9431,6 +9487,9 @@ ex_delfunction(eap)
 	vim_free(fp->name);
 	ga_clear_strings(&(fp->args));
 	ga_clear_strings(&(fp->lines));
+#ifdef FEAT_PROFILE
+	func_free_profile(fp);
+#endif
 
 	/* remove the function from the function list */
 	if (firstfunc == fp)
@@ -9467,6 +9526,12 @@ call_user_func(fp, argcount, argvars, retvar, firstline, lastline)
     struct funccall	*save_fcp = current_funccal;
     int			save_did_emsg;
     static int		depth = 0;
+#ifdef FEAT_PROFILE
+    proftime_T		wait_start;
+    proftime_T		call_start;
+    int			prof_child = FALSE; /* prof_child_enter() called */
+    int			prof_func = FALSE;  /* timing "fp" */
+#endif
 
     /* If depth of calling is getting too high, don't execute the function */
     if (depth >= p_mfd)
@@ -9480,6 +9545,15 @@ call_user_func(fp, argcount, argvars, retvar, firstline, lastline)
 
     line_breakcheck();		/* check for CTRL-C hit */
 
+#ifdef FEAT_PROFILE
+    /* The time spent in this function doesn't count for the caller. */
+    if (do_profiling == PROF_YES)
+    {
+	prof_child_enter(&wait_start);
+	prof_child = TRUE;
+    }
+#endif
+
     /* set local variables */
     var_init(&fc.l_vars);
     fc.func = fp;
@@ -9558,10 +9632,37 @@ call_user_func(fp, argcount, argvars, retvar, firstline, lastline)
     save_did_emsg = did_emsg;
     did_emsg = FALSE;
 
+#ifdef FEAT_PROFILE
+    fc.tml_idx = -1;
+    profile_zero(&fc.tm_children);
+    profile_zero(&fc.tml_children);
+    if (do_profiling == PROF_YES)
+    {
+	if (!fp->profiling && has_profiling(FALSE, fp->name, NULL))
+	    func_do_profile(fp);
+	if (fp->profiling)
+	{
+	    prof_func = TRUE;
+	    ++fp->tm_count;
+	    profile_start(&call_start);
+	}
+    }
+#endif
+
     /* call do_cmdline() to execute the lines */
     do_cmdline(NULL, get_func_line, (void *)&fc,
 				     DOCMD_NOWAIT|DOCMD_VERBOSE|DOCMD_REPEAT);
 
+#ifdef FEAT_PROFILE
+    if (prof_func)
+    {
+	profile_end(&call_start);
+	profile_sub_wait(&wait_start, &call_start);
+	profile_add(&fp->tm_total, &call_start);
+	profile_self(&fp->tm_self, &call_start, &fc.tm_children);
+    }
+#endif
+
     --RedrawingDisabled;
 
     /* when the function was aborted because of an error, return -1 */
@@ -9619,6 +9720,10 @@ call_user_func(fp, argcount, argvars, retvar, firstline, lastline)
 
     did_emsg |= save_did_emsg;
     current_funccal = save_fcp;
+#ifdef FEAT_PROFILE
+    if (prof_child)
+	prof_child_exit(&wait_start);
+#endif
 
     var_clear(&fc.l_vars);		/* free all local variables */
     --depth;
@@ -9870,6 +9975,302 @@ func_has_abort(cookie)
     return ((struct funccall *)cookie)->func->flags & FC_ABORT;
 }
 
+#if defined(FEAT_PROFILE) || defined(PROTO)
+/*
+ * Start profiling function "fp".
+ */
+    static void
+func_do_profile(fp)
+    ufunc_T	*fp;
+{
+    int		len = fp->lines.ga_len;
+
+    if (len == 0)
+	len = 1;  /* avoid getting error for allocating zero bytes */
+    fp->tm_count = 0;
+    profile_zero(&fp->tm_self);
+    profile_zero(&fp->tm_total);
+    fp->tml_count = (int *)alloc_clear((unsigned)(sizeof(int) * len));
+    fp->tml_total = (proftime_T *)alloc_clear((unsigned)
+						  (sizeof(proftime_T) * len));
+    fp->tml_self = (proftime_T *)alloc_clear((unsigned)
+						  (sizeof(proftime_T) * len));
+    if (fp->tml_count == NULL || fp->tml_total == NULL
+						      || fp->tml_self == NULL)
+	func_free_profile(fp);
+    else
+	fp->profiling = TRUE;
+}
+
+/*
+ * Stop profiling function "fp" and free the counters, when it is redefined
+ * or deleted.
+ */
+    static void
+func_free_profile(fp)
+    ufunc_T	*fp;
+{
+    vim_free(fp->tml_count);
+    fp->tml_count = NULL;
+    vim_free(fp->tml_total);
+    fp->tml_total = NULL;
+    vim_free(fp->tml_self);
+    fp->tml_self = NULL;
+    fp->profiling = FALSE;
+}
+
+/*
+ * Called when entering a function or sourcing a script: the time spent
+ * there is not counted for the function or script line that invokes it.
+ * "tm" is used to store the wait time, pass it to prof_child_exit().
+ */
+    void
+prof_child_enter(tm)
+    proftime_T	*tm;	/* place to store wait time */
+{
+    struct funccall *fc = current_funccal;
+
+    if (fc != NULL && fc->func->profiling)
+	profile_start(&fc->prof_child);
+    script_prof_save(tm);
+}
+
+/*
+ * Called when returning from a function or sourced script: add the time
+ * spent there to the children of the invoking function and script line.
+ */
+    void
+prof_child_exit(tm)
+    proftime_T	*tm;	/* wait time stored by prof_child_enter() */
+{
+    struct funccall *fc = current_funccal;
+
+    if (fc != NULL && fc->func->profiling)
+    {
+	profile_end(&fc->prof_child);
+	profile_sub_wait(tm, &fc->prof_child); /* don't count waiting time */
+	profile_add(&fc->tm_children, &fc->prof_child);
+	profile_add(&fc->tml_children, &fc->prof_child);
+    }
+    script_prof_restore(tm);
+}
+
+/*
+ * Called when starting to read a function line.
+ * "sourcing_lnum" must be correct!
+ */
+    void
+func_line_start(cookie)
+    void    *cookie;
+{
+    struct funccall *fcp = (struct funccall *)cookie;
+    ufunc_T	    *fp = fcp->func;
+
+    if (fp->profiling && sourcing_lnum >= 1
+				      && sourcing_lnum <= fp->lines.ga_len)
+    {
+	fcp->tml_idx = sourcing_lnum - 1;
+	fcp->tml_execed = FALSE;
+	profile_start(&fcp->tml_start);
+	profile_zero(&fcp->tml_children);
+	profile_get_wait(&fcp->tml_wait);
+    }
+}
+
+/*
+ * Called when actually executing a function line.
+ */
+    void
+func_line_exec(cookie)
+    void    *cookie;
+{
+    struct funccall *fcp = (struct funccall *)cookie;
+
+    if (fcp->func->profiling && fcp->tml_idx >= 0)
+	fcp->tml_execed = TRUE;
+}
+
+/*
+ * Called when done with a function line.
+ */
+    void
+func_line_end(cookie)
+    void    *cookie;
+{
+    struct funccall *fcp = (struct funccall *)cookie;
+    ufunc_T	    *fp = fcp->func;
+
+    if (fp->profiling && fcp->tml_idx >= 0)
+    {
+	if (fcp->tml_execed)
+	{
+	    ++fp->tml_count[fcp->tml_idx];
+	    profile_end(&fcp->tml_start);
+	    profile_sub_wait(&fcp->tml_wait, &fcp->tml_start);
+	    profile_add(&fp->tml_total[fcp->tml_idx], &fcp->tml_start);
+	    profile_self(&fp->tml_self[fcp->tml_idx], &fcp->tml_start,
+							  &fcp->tml_children);
+	}
+	fcp->tml_idx = -1;
+    }
+}
+
+/*
+ * Dump the profiling results for all functions in file "fd".
+ */
+    void
+func_dump_profile(fd)
+    FILE    *fd;
+{
+    ufunc_T	*fp;
+    int		i;
+    int		todo = 0;
+    ufunc_T	**sorttab;
+    int		st_len = 0;
+
+    for (fp = firstfunc; fp != NULL; fp = fp->next)
+	if (fp->profiling)
+	    ++todo;
+    if (todo == 0)
+	return;	    /* nothing to dump */
+
+    sorttab = (ufunc_T **)alloc((unsigned)(sizeof(ufunc_T *) * todo));
+
+    for (fp = firstfunc; fp != NULL; fp = fp->next)
+    {
+	if (!fp->profiling)
+	    continue;
+	if (sorttab != NULL)
+	    sorttab[st_len++] = fp;
+
+	if (fp->name[0] == K_SPECIAL)
+	    fprintf(fd, "FUNCTION  <SNR>%s()\n", fp->name + 3);
+	else
+	    fprintf(fd, "FUNCTION  %s()\n", fp->name);
+	if (fp->tm_count == 1)
+	    fprintf(fd, "Called 1 time\n");
+	else
+	    fprintf(fd, "Called %d times\n", fp->tm_count);
+	fprintf(fd, "Total time: %s\n", profile_msg(&fp->tm_total));
+	fprintf(fd, " Self time: %s\n", profile_msg(&fp->tm_self));
+	fprintf(fd, "\n");
+	fprintf(fd, "count  total (s)   self (s)\n");
+
+	for (i = 0; i < fp->lines.ga_len; ++i)
+	{
+	    prof_func_line(fd, fp->tml_count[i],
+			     &fp->tml_total[i], &fp->tml_self[i], TRUE);
+	    fprintf(fd, "%s\n", FUNCLINE(fp, i));
+	}
+	fprintf(fd, "\n");
+    }
+
+    if (sorttab != NULL && st_len > 0)
+    {
+	qsort((void *)sorttab, (size_t)st_len, sizeof(ufunc_T *),
+							      prof_total_cmp);
+	prof_sort_list(fd, sorttab, st_len, "TOTAL", FALSE);
+	qsort((void *)sorttab, (size_t)st_len, sizeof(ufunc_T *),
+							       prof_self_cmp);
+	prof_sort_list(fd, sorttab, st_len, "SELF", TRUE);
+    }
+    vim_free(sorttab);
+}
+
+/*
+ * Print the table of the functions that took the most time, sorted on
+ * "title" time, at most 20 of them.
+ */
+    static void
+prof_sort_list(fd, sorttab, st_len, title, prefer_self)
+    FILE	*fd;
+    ufunc_T	**sorttab;
+    int		st_len;
+    char	*title;
+    int		prefer_self;	/* when equal print only self time */
+{
+    int		i;
+    ufunc_T	*fp;
+
+    fprintf(fd, "FUNCTIONS SORTED ON %s TIME\n", title);
+    fprintf(fd, "count  total (s)   self (s)  function\n");
+    for (i = 0; i < 20 && i < st_len; ++i)
+    {
+	fp = sorttab[i];
+	prof_func_line(fd, fp->tm_count, &fp->tm_total, &fp->tm_self,
+								 prefer_self);
+	if (fp->name[0] == K_SPECIAL)
+	    fprintf(fd, " <SNR>%s()\n", fp->name + 3);
+	else
+	    fprintf(fd, " %s()\n", fp->name);
+    }
+    fprintf(fd, "\n");
+}
+
+/*
+ * Print the count and times for one function or function line.
+ */
+    static void
+prof_func_line(fd, count, total, self, prefer_self)
+    FILE	*fd;
+    int		count;
+    proftime_T	*total;
+    proftime_T	*self;
+    int		prefer_self;	/* when equal print only self time */
+{
+    if (count > 0)
+    {
+	fprintf(fd, "%5d ", count);
+	if (prefer_self && profile_equal(total, self))
+	    fprintf(fd, "           ");
+	else
+	    fprintf(fd, "%s ", profile_msg(total));
+	if (!prefer_self && profile_equal(total, self))
+	    fprintf(fd, "           ");
+	else
+	    fprintf(fd, "%s ", profile_msg(self));
+    }
+    else
+	fprintf(fd, "                            ");
+}
+
+/*
+ * Compare function for total time sorting.
+ */
+    static int
+#ifdef __BORLANDC__
+_RTLENTRYF
+#endif
+prof_total_cmp(s1, s2)
+    const void	*s1;
+    const void	*s2;
+{
+    ufunc_T	*p1, *p2;
+
+    p1 = *(ufunc_T **)s1;
+    p2 = *(ufunc_T **)s2;
+    return profile_cmp(&p1->tm_total, &p2->tm_total);
+}
+
+/*
+ * Compare function for self time sorting.
+ */
+    static int
+#ifdef __BORLANDC__
+_RTLENTRYF
+#endif
+prof_self_cmp(s1, s2)
+    const void	*s1;
+    const void	*s2;
+{
+    ufunc_T	*p1, *p2;
+
+    p1 = *(ufunc_T **)s1;
+    p2 = *(ufunc_T **)s2;
+    return profile_cmp(&p1->tm_self, &p2->tm_self);
+}
+#endif
+
 #if defined(FEAT_VIMINFO) || defined(FEAT_SESSION)
 typedef enum
 {
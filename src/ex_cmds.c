@@ -18,6 +18,9 @@
 # include <fcntl.h>
 #endif
 
+/* Number of lines ":copy" appends at once. */
+#define COPY_LINES_MAX 256
+
 #ifdef FEAT_EX_EXTRA
 static int linelen __ARGS((int *has_tab));
 #endif
@@ -531,7 +534,9 @@ ex_copy(line1, line2, n)
     linenr_T	n;
 {
     linenr_T	count;
-    char_u	*p;
+    char_u	*lines[COPY_LINES_MAX];
+    int		nlines;
+    int		i;
 
     count = line2 - line1 + 1;
     curbuf->b_op_start.lnum = n + 1;
@@ -555,23 +560,43 @@ ex_copy(line1, line2, n)
     curwin->w_cursor.lnum = n;
     while (line1 <= line2)
     {
-	/* need to use vim_strsave() because the line will be unlocked within
-	 * ml_append() */
-	p = vim_strsave(ml_get(line1));
-	if (p != NULL)
+	/* Append a number of lines at once, that is a lot faster.  Need to
+	 * use vim_strsave() because the lines will be unlocked within
+	 * ml_append_lines().  Stop at the destination line, in situation 2 the
+	 * copied lines must not be copied again. */
+	for (nlines = 0; nlines < COPY_LINES_MAX && line1 + nlines <= line2;
+								     ++nlines)
+	{
+	    lines[nlines] = vim_strsave(ml_get(line1 + nlines));
+	    if (lines[nlines] == NULL || line1 + nlines == n)
+	    {
+		if (lines[nlines] != NULL)
+		    ++nlines;
+		break;
+	    }
+	}
+	if (nlines > 0)
 	{
-	    ml_append(curwin->w_cursor.lnum, p, (colnr_T)0, FALSE);
-	    vim_free(p);
+	    (void)ml_append_lines(curwin->w_cursor.lnum, lines, NULL,
+						       (long)nlines, FALSE);
+	    for (i = 0; i < nlines; ++i)
+		vim_free(lines[i]);
 	}
-	/* situation 2: skip already copied lines */
-	if (line1 == n)
-	    line1 = curwin->w_cursor.lnum;
-	++line1;
-	if (curwin->w_cursor.lnum < line1)
+	else
+	    nlines = 1;	    /* out of memory, skip the line */
+
+	for (i = 0; i < nlines; ++i)
+	{
+	    /* situation 2: skip already copied lines */
+	    if (line1 == n)
+		line1 = curwin->w_cursor.lnum;
 	    ++line1;
-	if (curwin->w_cursor.lnum < line2)
-	    ++line2;
-	++curwin->w_cursor.lnum;
+	    if (curwin->w_cursor.lnum < line1)
+		++line1;
+	    if (curwin->w_cursor.lnum < line2)
+		++line2;
+	    ++curwin->w_cursor.lnum;
+	}
     }
 
     appended_lines_mark(n, count);
@@ -1311,6 +1336,10 @@ read_viminfo(file, want_info, want_marks, forceit)
 {
     FILE	*fp;
     char_u	*fname;
+#ifdef FEAT_STARTUPTIME
+    struct timeval	tv_rel;
+    struct timeval	tv_start;
+#endif
 
     if (no_viminfo())
 	return FAIL;
@@ -1333,14 +1362,28 @@ read_viminfo(file, want_info, want_marks, forceit)
 		    fp == NULL ? _(" FAILED") : "");
     }
 
-    vim_free(fname);
     if (fp == NULL)
+    {
+	vim_free(fname);
 	return FAIL;
+    }
 
+#ifdef FEAT_STARTUPTIME
+    if (time_fd != NULL)
+	time_push(&tv_rel, &tv_start);
+#endif
     viminfo_errcnt = 0;
     do_viminfo(fp, NULL, want_info, want_marks, forceit);
 
     fclose(fp);
+#ifdef FEAT_STARTUPTIME
+    if (time_fd != NULL)
+    {
+	time_msg("viminfo", (char *)fname, &tv_start);
+	time_pop(&tv_rel);
+    }
+#endif
+    vim_free(fname);
 
     return OK;
 }
@@ -2244,6 +2287,7 @@ do_write(eap)
 	    alt_buf->b_sfname = curbuf->b_sfname;
 	    curbuf->b_sfname = fname;
 	    buf_name_changed(curbuf);
+	    buf_hash_update(alt_buf);
 #ifdef FEAT_AUTOCMD
 	    apply_autocmds(EVENT_BUFFILEPOST, NULL, NULL, FALSE, curbuf);
 	    if (!alt_buf->b_p_bl)
@@ -510,6 +510,8 @@ EX(CMD_mkvimrc,		"mkvimrc",	ex_mkrc,
 			BANG|FILE1|TRLBAR|CMDWIN),
 EX(CMD_mkview,		"mkview",	ex_mkrc,
 			BANG|FILE1|TRLBAR),
+EX(CMD_mkxref,		"mkxref",	ex_mkxref,
+			BANG|EXTRA|FILES|TRLBAR|CMDWIN),
 EX(CMD_mode,		"mode",		ex_mode,
 			WORD1|TRLBAR|CMDWIN),
 EX(CMD_next,		"next",		ex_next,
@@ -586,6 +588,8 @@ EX(CMD_promptfind,	"promptfind",	gui_mch_find_dialog,
 			EXTRA|NOTRLCOM|CMDWIN),
 EX(CMD_promptrepl,	"promptrepl",	gui_mch_replace_dialog,
 			EXTRA|NOTRLCOM|CMDWIN),
+EX(CMD_profile,		"profile",	ex_profile,
+			BANG|EXTRA|TRLBAR|CMDWIN),
 EX(CMD_psearch,		"psearch",	ex_psearch,
 			BANG|RANGE|WHOLEFOLD|DFLALL|EXTRA),
 EX(CMD_ptag,		"ptag",		ex_ptag,
@@ -688,6 +692,8 @@ EX(CMD_scriptnames,	"scriptnames",	ex_scriptnames,
 			TRLBAR|CMDWIN),
 EX(CMD_scriptencoding,	"scriptencoding", ex_scriptencoding,
 			WORD1|TRLBAR|CMDWIN),
+EX(CMD_screenstats,	"screenstats",	ex_screenstats,
+			BANG|TRLBAR|CMDWIN),
 EX(CMD_scscope,		"scscope",	do_scscope,
 			EXTRA|NOTRLCOM|SBOXOK),
 EX(CMD_set,		"set",		ex_set,
@@ -750,6 +756,8 @@ EX(CMD_sview,		"sview",	ex_splitview,
 			NEEDARG|RANGE|NOTADR|BANG|FILE1|EDITCMD|ARGOPT|TRLBAR),
 EX(CMD_swapname,	"swapname",	ex_swapname,
 			TRLBAR|CMDWIN),
+EX(CMD_swapstats,	"swapstats",	ex_swapstats,
+			BANG|TRLBAR|CMDWIN),
 EX(CMD_syntax,		"syntax",	ex_syntax,
 			EXTRA|NOTRLCOM|CMDWIN),
 EX(CMD_syncbind,	"syncbind",	ex_syncbind,
@@ -795,6 +803,8 @@ EX(CMD_tselect,		"tselect",	ex_tag,
 EX(CMD_tunmenu,		"tunmenu",	ex_menu,
 			EXTRA|TRLBAR|NOTRLCOM|USECTRLV|CMDWIN),
 EX(CMD_undo,		"undo",		ex_undo,
+			RANGE|NOTADR|COUNT|ZEROR|TRLBAR|CMDWIN),
+EX(CMD_undolist,	"undolist",	ex_undolist,
 			TRLBAR|CMDWIN),
 EX(CMD_unabbreviate,	"unabbreviate",	ex_abbreviate,
 			EXTRA|TRLBAR|NOTRLCOM|USECTRLV|CMDWIN),
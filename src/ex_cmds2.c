@@ -352,33 +352,43 @@ struct debuggy
     char_u	*dbg_name;	/* function or file name */
     regprog_T	*dbg_prog;	/* regexp program */
     linenr_T	dbg_lnum;	/* line number in function or file */
+    int		dbg_forceit;	/* ! used */
 };
 
 static garray_T dbg_breakp = {0, 0, sizeof(struct debuggy), 4, NULL};
-#define BREAKP(idx)	(((struct debuggy *)dbg_breakp.ga_data)[idx])
+#define BREAKP(idx)		(((struct debuggy *)dbg_breakp.ga_data)[idx])
+#define DEBUGGY(gap, idx)	(((struct debuggy *)gap->ga_data)[idx])
 static int last_breakp = 0;	/* nr of last defined breakpoint */
 
+#ifdef FEAT_PROFILE
+/* Profiling uses file and func names similar to breakpoints. */
+static garray_T prof_ga = {0, 0, sizeof(struct debuggy), 4, NULL};
+#endif
 #define DBG_FUNC	1
 #define DBG_FILE	2
 
-static int dbg_parsearg __ARGS((char_u *arg));
+static int dbg_parsearg __ARGS((char_u *arg, garray_T *gap));
+static linenr_T debuggy_find __ARGS((int file, char_u *fname,
+			 linenr_T after, garray_T *gap, int *fp));
 
 /*
- * Parse the arguments of ":breakadd" or ":breakdel" and put them in the entry
- * just after the last one in dbg_breakp.  Note that "dbg_name" is allocated.
+ * Parse the arguments of ":profile", ":breakadd" or ":breakdel" and put them
+ * in the entry just after the last one in dbg_breakp or prof_ga.  Note that
+ * "dbg_name" is allocated.
  * Returns FAIL for failure.
  */
     static int
-dbg_parsearg(arg)
+dbg_parsearg(arg, gap)
     char_u	*arg;
+    garray_T	*gap;	    /* either &dbg_breakp or &prof_ga */
 {
     char_u	*p = arg;
     char_u	*q;
     struct debuggy *bp;
 
-    if (ga_grow(&dbg_breakp, 1) == FAIL)
+    if (ga_grow(gap, 1) == FAIL)
 	return FAIL;
-    bp = &BREAKP(dbg_breakp.ga_len);
+    bp = &DEBUGGY(gap, gap->ga_len);
 
     /* Find "func" or "file". */
     if (STRNCMP(p, "func", 4) == 0)
@@ -392,8 +402,8 @@ dbg_parsearg(arg)
     }
     p = skipwhite(p + 4);
 
-    /* Find optional line number. */
-    if (VIM_ISDIGIT(*p))
+    /* Find optional line number, not for profiling. */
+    if (gap == &dbg_breakp && VIM_ISDIGIT(*p))
     {
 	bp->dbg_lnum = getdigits(&p);
 	p = skipwhite(p);
@@ -450,7 +460,7 @@ dbg_parsearg(arg)
 }
 
 /*
- * ":breakadd".
+ * ":breakadd".  Also used for ":profile func" and ":profile file".
  */
     void
 ex_breakadd(eap)
@@ -458,10 +468,19 @@ ex_breakadd(eap)
 {
     struct debuggy *bp;
     char_u	*pat;
+    garray_T	*gap;
+
+    gap = &dbg_breakp;
+#ifdef FEAT_PROFILE
+    if (eap->cmdidx == CMD_profile)
+	gap = &prof_ga;
+#endif
 
-    if (dbg_parsearg(eap->arg) == OK)
+    if (dbg_parsearg(eap->arg, gap) == OK)
     {
-	bp = &BREAKP(dbg_breakp.ga_len);
+	bp = &DEBUGGY(gap, gap->ga_len);
+	bp->dbg_forceit = eap->forceit;
+
 	pat = file_pat_to_reg_pat(bp->dbg_name, NULL, NULL, FALSE);
 	if (pat != NULL)
 	{
@@ -474,9 +493,13 @@ ex_breakadd(eap)
 	{
 	    if (bp->dbg_lnum == 0)	/* default line number is 1 */
 		bp->dbg_lnum = 1;
-	    BREAKP(dbg_breakp.ga_len++).dbg_nr = ++last_breakp;
-	    --dbg_breakp.ga_room;
-	    ++debug_tick;
+	    if (gap == &dbg_breakp)
+	    {
+		bp->dbg_nr = ++last_breakp;
+		++debug_tick;
+	    }
+	    ++gap->ga_len;
+	    --gap->ga_room;
 	}
     }
 }
@@ -521,7 +544,7 @@ ex_breakdel(eap)
     else
     {
 	/* ":breakdel {func|file} [lnum] {name}" */
-	if (dbg_parsearg(eap->arg) == FAIL)
+	if (dbg_parsearg(eap->arg, &dbg_breakp) == FAIL)
 	    return;
 	bp = &BREAKP(dbg_breakp.ga_len);
 	for (i = 0; i < dbg_breakp.ga_len; ++i)
@@ -590,6 +613,35 @@ dbg_find_breakpoint(file, fname, after)
     int		file;	    /* TRUE for a file, FALSE for a function */
     char_u	*fname;	    /* file or function name */
     linenr_T	after;	    /* after this line number */
+{
+    return debuggy_find(file, fname, after, &dbg_breakp, NULL);
+}
+
+#if defined(FEAT_PROFILE) || defined(PROTO)
+/*
+ * Return TRUE if profiling is on for a function or sourced file.
+ */
+    int
+has_profiling(file, fname, fp)
+    int		file;	    /* TRUE for a file, FALSE for a function */
+    char_u	*fname;	    /* file or function name */
+    int		*fp;	    /* return: forceit */
+{
+    return (debuggy_find(file, fname, (linenr_T)0, &prof_ga, fp)
+							      != (linenr_T)0);
+}
+#endif
+
+/*
+ * Common code for dbg_find_breakpoint() and has_profiling().
+ */
+    static linenr_T
+debuggy_find(file, fname, after, gap, fp)
+    int		file;	    /* TRUE for a file, FALSE for a function */
+    char_u	*fname;	    /* file or function name */
+    linenr_T	after;	    /* after this line number */
+    garray_T	*gap;	    /* either &dbg_breakp or &prof_ga */
+    int		*fp;	    /* if not NULL: return forceit */
 {
     struct debuggy *bp;
     int		i;
@@ -611,14 +663,15 @@ dbg_find_breakpoint(file, fname, after)
 	}
     }
 
-    for (i = 0; i < dbg_breakp.ga_len; ++i)
+    for (i = 0; i < gap->ga_len; ++i)
     {
 	/* skip entries that are not useful or are for a line that is beyond
-	 * an already found breakpoint */
-	bp = &BREAKP(i);
+	 * an already found breakpoint; for profiling any match will do */
+	bp = &DEBUGGY(gap, i);
 	if ((bp->dbg_type == DBG_FILE) == file
-		&& bp->dbg_lnum > after
-		&& (lnum == 0 || bp->dbg_lnum < lnum))
+		&& (gap != &dbg_breakp
+		    || (bp->dbg_lnum > after
+			&& (lnum == 0 || bp->dbg_lnum < lnum))))
 	{
 	    regmatch.regprog = bp->dbg_prog;
 	    regmatch.rm_ic = FALSE;
@@ -630,7 +683,11 @@ dbg_find_breakpoint(file, fname, after)
 	    prev_got_int = got_int;
 	    got_int = FALSE;
 	    if (vim_regexec(&regmatch, name, (colnr_T)0))
+	    {
 		lnum = bp->dbg_lnum;
+		if (fp != NULL)
+		    *fp = bp->dbg_forceit;
+	    }
 	    got_int |= prev_got_int;
 	}
     }
@@ -654,6 +711,263 @@ dbg_breakpoint(name, lnum)
 }
 #endif
 
+#if defined(FEAT_PROFILE) || defined(PROTO)
+/*
+ * Functions for profiling.
+ */
+static void script_dump_profile __ARGS((FILE *fd));
+static proftime_T prof_wait_time;
+
+/*
+ * Set the time in "tm" to zero.
+ */
+    void
+profile_zero(tm)
+    proftime_T *tm;
+{
+    tm->tv_usec = 0;
+    tm->tv_sec = 0;
+}
+
+/*
+ * Store the current time in "tm".
+ */
+    void
+profile_start(tm)
+    proftime_T *tm;
+{
+    gettimeofday(tm, NULL);
+}
+
+/*
+ * Compute the elapsed time from "tm" till now and store in "tm".
+ */
+    void
+profile_end(tm)
+    proftime_T *tm;
+{
+    proftime_T now;
+
+    gettimeofday(&now, NULL);
+    tm->tv_usec = now.tv_usec - tm->tv_usec;
+    tm->tv_sec = now.tv_sec - tm->tv_sec;
+    if (tm->tv_usec < 0)
+    {
+	tm->tv_usec += 1000000;
+	--tm->tv_sec;
+    }
+}
+
+/*
+ * Subtract the time "tm2" from "tm".
+ */
+    void
+profile_sub(tm, tm2)
+    proftime_T *tm, *tm2;
+{
+    tm->tv_usec -= tm2->tv_usec;
+    tm->tv_sec -= tm2->tv_sec;
+    if (tm->tv_usec < 0)
+    {
+	tm->tv_usec += 1000000;
+	--tm->tv_sec;
+    }
+}
+
+/*
+ * Add the time "tm2" to "tm".
+ */
+    void
+profile_add(tm, tm2)
+    proftime_T *tm, *tm2;
+{
+    tm->tv_usec += tm2->tv_usec;
+    tm->tv_sec += tm2->tv_sec;
+    if (tm->tv_usec >= 1000000)
+    {
+	tm->tv_usec -= 1000000;
+	++tm->tv_sec;
+    }
+}
+
+/*
+ * Add the "self" time from the total time and the children's time.
+ */
+    void
+profile_self(self, total, children)
+    proftime_T *self, *total, *children;
+{
+    /* Check that the result won't be negative.  Can happen with recursive
+     * calls. */
+    if (total->tv_sec < children->tv_sec
+	    || (total->tv_sec == children->tv_sec
+		&& total->tv_usec <= children->tv_usec))
+	return;
+    profile_add(self, total);
+    profile_sub(self, children);
+}
+
+/*
+ * Get the current waittime.
+ */
+    void
+profile_get_wait(tm)
+    proftime_T *tm;
+{
+    *tm = prof_wait_time;
+}
+
+/*
+ * Subtract the passed waittime since "tm" from "tma".
+ */
+    void
+profile_sub_wait(tm, tma)
+    proftime_T *tm, *tma;
+{
+    proftime_T tm3 = prof_wait_time;
+
+    profile_sub(&tm3, tm);
+    profile_sub(tma, &tm3);
+}
+
+/*
+ * Return TRUE if "tm1" and "tm2" are equal.
+ */
+    int
+profile_equal(tm1, tm2)
+    proftime_T *tm1, *tm2;
+{
+    return (tm1->tv_usec == tm2->tv_usec && tm1->tv_sec == tm2->tv_sec);
+}
+
+/*
+ * Return <0, 0 or >0 if "tm1" < "tm2", "tm1" == "tm2" or "tm1" > "tm2".
+ * Used for sorting on time, the longest time comes first.
+ */
+    int
+profile_cmp(tm1, tm2)
+    proftime_T *tm1, *tm2;
+{
+    if (tm1->tv_sec == tm2->tv_sec)
+	return tm2->tv_usec - tm1->tv_usec;
+    return tm2->tv_sec - tm1->tv_sec;
+}
+
+/*
+ * Return a string that represents the time in "tm".
+ * Uses a static buffer!
+ */
+    char *
+profile_msg(tm)
+    proftime_T *tm;
+{
+    static char buf[50];
+
+    sprintf(buf, "%3ld.%06ld", (long)tm->tv_sec, (long)tm->tv_usec);
+    return buf;
+}
+
+static char_u	*profile_fname = NULL;
+static proftime_T pause_time;
+
+/*
+ * ":profile cmd args"
+ */
+    void
+ex_profile(eap)
+    exarg_T	*eap;
+{
+    char_u	*e;
+    int		len;
+
+    e = skiptowhite(eap->arg);
+    len = (int)(e - eap->arg);
+    e = skipwhite(e);
+
+    if (len == 5 && STRNCMP(eap->arg, "start", 5) == 0 && *e != NUL)
+    {
+	vim_free(profile_fname);
+	profile_fname = expand_env_save(e);
+	if (profile_fname != NULL)
+	{
+	    e = fix_fname(profile_fname);
+	    vim_free(profile_fname);
+	    profile_fname = e;
+	}
+	if (profile_fname == NULL)
+	    return;
+	if (do_profiling == PROF_NONE)
+	    profile_zero(&prof_wait_time);
+	do_profiling = PROF_YES;
+    }
+    else if (do_profiling == PROF_NONE)
+	EMSG(_("E681: First use \":profile start {fname}\""));
+    else if (STRCMP(eap->arg, "pause") == 0)
+    {
+	if (do_profiling == PROF_YES)
+	    profile_start(&pause_time);
+	do_profiling = PROF_PAUSED;
+    }
+    else if (STRCMP(eap->arg, "continue") == 0)
+    {
+	if (do_profiling == PROF_PAUSED)
+	{
+	    profile_end(&pause_time);
+	    profile_add(&prof_wait_time, &pause_time);
+	}
+	do_profiling = PROF_YES;
+    }
+    else
+    {
+	/* The rest is similar to ":breakadd". */
+	ex_breakadd(eap);
+    }
+}
+
+/*
+ * Dump the profiling info.
+ */
+    void
+profile_dump()
+{
+    FILE	*fd;
+
+    if (profile_fname != NULL)
+    {
+	fd = mch_fopen((char *)profile_fname, "w");
+	if (fd == NULL)
+	    EMSG2(_(e_notopen), profile_fname);
+	else
+	{
+	    script_dump_profile(fd);
+	    func_dump_profile(fd);
+	    fclose(fd);
+	}
+    }
+}
+
+static proftime_T inchar_time;
+
+/*
+ * Called when starting to wait for the user to type a character.
+ */
+    void
+prof_inchar_enter()
+{
+    profile_start(&inchar_time);
+}
+
+/*
+ * Called when finished waiting for the user to type a character.
+ */
+    void
+prof_inchar_exit()
+{
+    profile_end(&inchar_time);
+    profile_add(&prof_wait_time, &inchar_time);
+}
+#endif
+
 /*
  * If 'autowrite' option set, try to write the file.
  * Careful: autocommands may make "buf" invalid!
@@ -709,6 +1023,11 @@ check_changed(buf, checkaw, mult_win, forceit, allbuf)
     int		forceit;
     int		allbuf;		/* may write all buffers */
 {
+#ifdef UNIX
+    /* A background write may still fail and leave the buffer changed. */
+    if (!forceit && bgwrite_busy(buf))
+	(void)bgwrite_check(buf, TRUE);
+#endif
     if (       !forceit
 	    && bufIsChanged(buf)
 	    && (mult_win || buf->b_nwindows <= 1)
@@ -881,6 +1200,12 @@ check_changed_any(hidden)
     win_T	*wp;
 #endif
 
+#ifdef UNIX
+    /* A background write may still fail and leave a buffer changed. */
+    if (bgwrite_busy(NULL))
+	(void)bgwrite_check(NULL, TRUE);
+#endif
+
     for (;;)
     {
 	/* check curbuf first: if it was changed we can't abandon it */
@@ -1866,6 +2191,296 @@ cmd_runtime(name, all)
     return do_in_runtimepath(name, all, source_callback);
 }
 
+#ifdef UNIX
+/*
+ * Index of directories below 'runtimepath' entries.  ":runtime", filetype
+ * detection and ":syntax on" look for the same few names in every entry.
+ * Instead of reading the directory and getting the status of each matching
+ * file every time, the names found in a directory are remembered.  A lookup
+ * then only needs to get the status of the directory itself; when its
+ * modification time didn't change the remembered names are used.
+ * A directory that was changed in the same second it was read is read
+ * again, a later change may not update the time.
+ * Whether an entry is a file is found out when it first matches.
+ */
+typedef struct rtpdir_S rtpdir_T;
+
+struct rtpdir_S
+{
+    rtpdir_T	*rd_next;	/* next entry with the same hash */
+    unsigned	rd_hash;	/* hash of rd_name */
+    char_u	*rd_name;	/* directory name, ending in a slash */
+    int		rd_valid;	/* FALSE when it must be read again */
+    time_t	rd_mtime;	/* modification time when read */
+    garray_T	rd_files;	/* sorted names in the directory */
+    char_u	*rd_type;	/* RDT_ flags for each name in rd_files */
+};
+
+#define RDT_UNKNOWN	0	/* status not obtained yet */
+#define RDT_FILE	1	/* existing file */
+#define RDT_OTHER	2	/* directory or broken link */
+
+#define RTPDIR_HASH_SIZE	256	/* nr of hash buckets, power of two */
+
+static rtpdir_T	**rtpdir_hash = NULL;
+
+static int rtpdir_cmp __ARGS((const void *a, const void *b));
+static rtpdir_T *rtpdir_find __ARGS((char_u *dir, int len));
+static int rtpdir_read __ARGS((rtpdir_T *rd));
+static int rtpdir_isfile __ARGS((rtpdir_T *rd, int idx));
+static int rtpdir_expand __ARGS((char_u *path, int *num_files, char_u ***files));
+
+    static int
+rtpdir_cmp(a, b)
+    const void *a, *b;
+{
+    return pathcmp(*(char **)a, *(char **)b);
+}
+
+/*
+ * Find the index entry for directory "dir[len]", add one if there is none.
+ * Returns NULL when out of memory.
+ */
+    static rtpdir_T *
+rtpdir_find(dir, len)
+    char_u	*dir;
+    int		len;
+{
+    unsigned	hash = 0;
+    int		i;
+    rtpdir_T	*rd;
+
+    if (rtpdir_hash == NULL)
+    {
+	rtpdir_hash = (rtpdir_T **)alloc_clear(
+			     (unsigned)(RTPDIR_HASH_SIZE * sizeof(rtpdir_T *)));
+	if (rtpdir_hash == NULL)
+	    return NULL;
+    }
+
+    for (i = 0; i < len; ++i)
+	hash = hash * 33 + dir[i];
+    for (rd = rtpdir_hash[hash & (RTPDIR_HASH_SIZE - 1)]; rd != NULL;
+							       rd = rd->rd_next)
+	if (rd->rd_hash == hash && STRNCMP(rd->rd_name, dir, len) == 0
+						      && rd->rd_name[len] == NUL)
+	    return rd;
+
+    rd = (rtpdir_T *)alloc_clear((unsigned)sizeof(rtpdir_T));
+    if (rd == NULL)
+	return NULL;
+    rd->rd_name = vim_strnsave(dir, len);
+    if (rd->rd_name == NULL)
+    {
+	vim_free(rd);
+	return NULL;
+    }
+    rd->rd_hash = hash;
+    ga_init2(&rd->rd_files, (int)sizeof(char_u *), 20);
+    rd->rd_next = rtpdir_hash[hash & (RTPDIR_HASH_SIZE - 1)];
+    rtpdir_hash[hash & (RTPDIR_HASH_SIZE - 1)] = rd;
+    return rd;
+}
+
+/*
+ * Read the names in the directory of "rd".
+ * Returns FAIL when the directory can't be read.
+ */
+    static int
+rtpdir_read(rd)
+    rtpdir_T	*rd;
+{
+    DIR			*dirp;
+    struct dirent	*dp;
+    char_u		*p;
+
+    ga_clear_strings(&rd->rd_files);
+    vim_free(rd->rd_type);
+    rd->rd_type = NULL;
+    rd->rd_valid = FALSE;
+
+    dirp = opendir((char *)rd->rd_name);
+    if (dirp == NULL)
+	return FAIL;
+    while ((dp = readdir(dirp)) != NULL)
+    {
+	if (STRCMP(dp->d_name, ".") == 0 || STRCMP(dp->d_name, "..") == 0)
+	    continue;
+	if (ga_grow(&rd->rd_files, 1) == FAIL
+		|| (p = vim_strsave((char_u *)dp->d_name)) == NULL)
+	{
+	    closedir(dirp);
+	    ga_clear_strings(&rd->rd_files);
+	    return FAIL;
+	}
+	((char_u **)rd->rd_files.ga_data)[rd->rd_files.ga_len++] = p;
+	--rd->rd_files.ga_room;
+    }
+    closedir(dirp);
+
+    if (rd->rd_files.ga_len > 0)
+    {
+	rd->rd_type = alloc_clear((unsigned)rd->rd_files.ga_len);
+	if (rd->rd_type == NULL)
+	{
+	    ga_clear_strings(&rd->rd_files);
+	    return FAIL;
+	}
+	qsort(rd->rd_files.ga_data, (size_t)rd->rd_files.ga_len,
+					       sizeof(char_u *), rtpdir_cmp);
+    }
+    return OK;
+}
+
+/*
+ * Return TRUE if entry "idx" of "rd" is an existing file, not a directory.
+ */
+    static int
+rtpdir_isfile(rd, idx)
+    rtpdir_T	*rd;
+    int		idx;
+{
+    char_u	*name = ((char_u **)rd->rd_files.ga_data)[idx];
+    char_u	*p;
+    struct stat	st;
+
+    if (rd->rd_type[idx] == RDT_UNKNOWN)
+    {
+	rd->rd_type[idx] = RDT_OTHER;
+	p = concat_fnames(rd->rd_name, name, FALSE);
+	if (p != NULL)
+	{
+	    if (mch_stat((char *)p, &st) >= 0 && !S_ISDIR(st.st_mode))
+		rd->rd_type[idx] = RDT_FILE;
+	    vim_free(p);
+	}
+    }
+    return rd->rd_type[idx] == RDT_FILE;
+}
+
+/*
+ * Like gen_expand_wildcards() with EW_FILE for one "path", using the index of
+ * runtime directories.  Only wildcards in the last path component are
+ * handled.
+ * Returns OK when files were found, FAIL when there are none and NOTDONE
+ * when "path" can't be handled here.
+ */
+    static int
+rtpdir_expand(path, num_files, files)
+    char_u	*path;
+    int		*num_files;
+    char_u	***files;
+{
+    char_u	*exp = NULL;
+    char_u	*tail;
+    char_u	*p;
+    char_u	*pat;
+    rtpdir_T	*rd;
+    struct stat	st;
+    regmatch_T	regmatch;
+    garray_T	ga;
+    int		has_wildcard;
+    int		i;
+    int		retval = NOTDONE;
+
+    /* Things like "~user", "`cmd`" and "**" are left to
+     * gen_expand_wildcards(). */
+    if (vim_strpbrk(path, (char_u *)"$~") != NULL)
+    {
+	exp = expand_env_save(path);
+	if (exp == NULL)
+	    return NOTDONE;
+	path = exp;
+    }
+    tail = gettail(path);
+    if (!mch_isFullName(path)
+	    || vim_strpbrk(path, (char_u *)"$~\\" SPECIAL_WILDCHAR) != NULL
+	    || vim_strpbrk(tail, (char_u *)"/") != NULL
+	    || strstr((char *)tail, "**") != NULL)
+	goto theend;
+    for (p = path; p < tail; ++p)
+	if (vim_strchr((char_u *)"*?[", *p) != NULL)
+	    goto theend;
+    has_wildcard = (vim_strpbrk(tail, (char_u *)"*?[") != NULL);
+
+    rd = rtpdir_find(path, (int)(tail - path));
+    if (rd == NULL)
+	goto theend;
+
+    /* A directory that doesn't exist has no matches.  One that can't be
+     * read may still have files that can be found by name. */
+    if (mch_stat((char *)rd->rd_name, &st) < 0)
+    {
+	rd->rd_valid = FALSE;
+	retval = FAIL;
+	goto theend;
+    }
+    if (!rd->rd_valid || rd->rd_mtime != st.st_mtime)
+    {
+	if (rtpdir_read(rd) == FAIL)
+	    goto theend;
+	rd->rd_mtime = st.st_mtime;
+	rd->rd_valid = (st.st_mtime < time(NULL));
+    }
+    retval = FAIL;
+
+    ga_init2(&ga, (int)sizeof(char_u *), 10);
+    if (has_wildcard)
+    {
+	pat = file_pat_to_reg_pat(tail, NULL, NULL, FALSE);
+	if (pat == NULL)
+	    goto theend;
+# ifdef MACOS_X
+	regmatch.rm_ic = TRUE;		/* like unix_expandpath() */
+# else
+	regmatch.rm_ic = FALSE;
+# endif
+	regmatch.regprog = vim_regcomp(pat, RE_MAGIC);
+	vim_free(pat);
+	if (regmatch.regprog == NULL)
+	    goto theend;
+	for (i = 0; i < rd->rd_files.ga_len; ++i)
+	{
+	    p = ((char_u **)rd->rd_files.ga_data)[i];
+	    if ((*p != '.' || *tail == '.')
+		    && vim_regexec(&regmatch, p, (colnr_T)0)
+		    && rtpdir_isfile(rd, i)
+		    && ga_grow(&ga, 1) == OK
+		    && (p = concat_fnames(rd->rd_name, p, FALSE)) != NULL)
+	    {
+		((char_u **)ga.ga_data)[ga.ga_len++] = p;
+		--ga.ga_room;
+	    }
+	}
+	vim_free(regmatch.regprog);
+    }
+    else
+    {
+	for (i = 0; i < rd->rd_files.ga_len; ++i)
+	    if (fnamecmp(((char_u **)rd->rd_files.ga_data)[i], tail) == 0)
+		break;
+	if (i < rd->rd_files.ga_len && rtpdir_isfile(rd, i)
+		&& ga_grow(&ga, 1) == OK
+		&& (p = vim_strsave(path)) != NULL)
+	{
+	    ((char_u **)ga.ga_data)[ga.ga_len++] = p;
+	    --ga.ga_room;
+	}
+    }
+
+    if (ga.ga_len > 0)
+    {
+	*num_files = ga.ga_len;
+	*files = (char_u **)ga.ga_data;
+	retval = OK;
+    }
+
+theend:
+    vim_free(exp);
+    return retval;
+}
+#endif
+
 /*
  * Find "name" in 'runtimepath'.  When found, call the "callback" function for
  * it.
@@ -1888,6 +2503,10 @@ do_in_runtimepath(name, all, callback)
     char_u	**files;
     int		i;
     int		did_one = FALSE;
+#ifdef FEAT_STARTUPTIME
+    struct timeval	tv_rel;
+    struct timeval	tv_start;
+#endif
 #ifdef AMIGA
     struct Process	*proc = (struct Process *)FindTask(0L);
     APTR		save_winptr = proc->pr_WindowPtr;
@@ -1927,9 +2546,27 @@ do_in_runtimepath(name, all, callback)
 		    if (p_verbose > 2)
 			msg_str((char_u *)_("Searching for \"%s\""), buf);
 
-		    /* Expand wildcards, invoke the callback for each match. */
-		    if (gen_expand_wildcards(1, &buf, &num_files, &files,
-							       EW_FILE) == OK)
+		    /* Expand wildcards, invoke the callback for each match.
+		     * Only the expanding is timed, sourcing the files found
+		     * is timed separately. */
+#ifdef FEAT_STARTUPTIME
+		    if (time_fd != NULL)
+			time_push(&tv_rel, &tv_start);
+#endif
+#ifdef UNIX
+		    i = rtpdir_expand(buf, &num_files, &files);
+		    if (i == NOTDONE)
+#endif
+			i = gen_expand_wildcards(1, &buf, &num_files, &files,
+								     EW_FILE);
+#ifdef FEAT_STARTUPTIME
+		    if (time_fd != NULL)
+		    {
+			time_msg("runtime", (char *)buf, &tv_start);
+			time_pop(&tv_rel);
+		    }
+#endif
+		    if (i == OK)
 		    {
 			for (i = 0; i < num_files; ++i)
 			{
@@ -2095,11 +2732,44 @@ struct scriptstuff
     int		dev;
     ino_t	ino;
 # endif
+# ifdef FEAT_PROFILE
+    int		prof_on;	/* TRUE when script is/was profiled */
+    int		pr_force;	/* forceit: profile functions in this script */
+    proftime_T	pr_child;	/* time set when going into first child */
+    int		pr_nest;	/* nesting for pr_child */
+    /* profiling the script as a whole */
+    int		pr_count;	/* nr of times sourced */
+    proftime_T	pr_total;	/* time spend in script + children */
+    proftime_T	pr_self;	/* time spend in script itself */
+    proftime_T	pr_start;	/* time at script start */
+    proftime_T	pr_children;	/* time in children after script start */
+    /* profiling the script per line */
+    garray_T	prl_ga;		/* things stored for every line */
+    proftime_T	prl_start;	/* start time for current line */
+    proftime_T	prl_children;	/* time spent in children for this line */
+    proftime_T	prl_wait;	/* wait start time for current line */
+    int		prl_idx;	/* index of line being timed; -1 if none */
+    int		prl_execed;	/* line being timed was executed */
+# endif
 };
 static garray_T script_names = {0, 0, sizeof(struct scriptstuff), 4, NULL};
-#define SCRIPT_NAME(id) (((struct scriptstuff *)script_names.ga_data)[(id) - 1].name)
-#define SCRIPT_DEV(id) (((struct scriptstuff *)script_names.ga_data)[(id) - 1].dev)
-#define SCRIPT_INO(id) (((struct scriptstuff *)script_names.ga_data)[(id) - 1].ino)
+#define SCRIPT_ITEM(id) (((struct scriptstuff *)script_names.ga_data)[(id) - 1])
+#define SCRIPT_NAME(id) (SCRIPT_ITEM(id).name)
+#define SCRIPT_DEV(id) (SCRIPT_ITEM(id).dev)
+#define SCRIPT_INO(id) (SCRIPT_ITEM(id).ino)
+
+# ifdef FEAT_PROFILE
+/* Struct used in prl_ga for every line of a script. */
+struct scriptline
+{
+    int		count;		/* nr of times line was executed */
+    proftime_T	total;		/* time spend in a line + children */
+    proftime_T	self;		/* time spend in a line itself */
+};
+#  define PRL_ITEM(si, idx)	(((struct scriptline *)(si)->prl_ga.ga_data)[(idx)])
+
+static void script_do_profile __ARGS((struct scriptstuff *si));
+# endif
 #endif
 
 #if defined(WIN32) && defined(FEAT_CSCOPE)
@@ -2150,11 +2820,18 @@ do_source(fname, check_other, is_vimrc)
     int			    stat_ok;
 # endif
 #endif
-#ifdef STARTUPTIME
+#ifdef FEAT_PROFILE
+    struct scriptstuff	    *si = NULL;
+    proftime_T		    wait_start;
+    int			    prof_child = FALSE; /* prof_child_enter() called */
+    int			    prof_script = FALSE; /* timing the script */
+#endif
+#ifdef FEAT_STARTUPTIME
     struct timeval	    tv_rel;
     struct timeval	    tv_start;
 #endif
 
+
 #ifdef RISCOS
     p = mch_munge_fname(fname);
 #else
@@ -2174,6 +2851,10 @@ do_source(fname, check_other, is_vimrc)
 	msg_str((char_u *)_("Cannot source a directory: \"%s\""), fname);
 	goto theend;
     }
+#ifdef UNIX
+    /* The file may still be written in the background. */
+    bgwrite_wait_file(fname_exp);
+#endif
 
 #if defined(WIN32) && defined(FEAT_CSCOPE)
     cookie.fp = fopen_noinh_readbin((char *)fname_exp);
@@ -2290,8 +2971,18 @@ do_source(fname, check_other, is_vimrc)
     save_sourcing_lnum = sourcing_lnum;
     sourcing_lnum = 0;
 
-#ifdef STARTUPTIME
-    time_push(&tv_rel, &tv_start);
+#ifdef FEAT_STARTUPTIME
+    if (time_fd != NULL)
+	time_push(&tv_rel, &tv_start);
+#endif
+
+#ifdef FEAT_PROFILE
+    /* The time spent in the script doesn't count for the caller. */
+    if (do_profiling == PROF_YES)
+    {
+	prof_child_enter(&wait_start);
+	prof_child = TRUE;
+    }
 #endif
 
 #ifdef FEAT_EVAL
@@ -2324,6 +3015,9 @@ do_source(fname, check_other, is_vimrc)
 	    while (script_names.ga_len < current_SID)
 	    {
 		SCRIPT_NAME(script_names.ga_len + 1) = NULL;
+# ifdef FEAT_PROFILE
+		SCRIPT_ITEM(script_names.ga_len + 1).prof_on = FALSE;
+# endif
 		++script_names.ga_len;
 		--script_names.ga_room;
 	    }
@@ -2347,12 +3041,46 @@ do_source(fname, check_other, is_vimrc)
     save_funccalp = save_funccal();
 #endif
 
+#ifdef FEAT_PROFILE
+    if (do_profiling == PROF_YES && current_SID <= script_names.ga_len)
+    {
+	int	forceit;
+
+	/* Check if we do profiling for this script. */
+	si = &SCRIPT_ITEM(current_SID);
+	if (!si->prof_on && has_profiling(TRUE, si->name, &forceit))
+	{
+	    script_do_profile(si);
+	    si->pr_force = forceit;
+	}
+	if (si->prof_on)
+	{
+	    prof_script = TRUE;
+	    ++si->pr_count;
+	    profile_start(&si->pr_start);
+	    profile_zero(&si->pr_children);
+	}
+    }
+#endif
+
     /*
      * Call do_cmdline, which will call getsourceline() to get the lines.
      */
     do_cmdline(NULL, getsourceline, (void *)&cookie,
 				     DOCMD_VERBOSE|DOCMD_NOWAIT|DOCMD_REPEAT);
 
+#ifdef FEAT_PROFILE
+    if (prof_script)
+    {
+	/* Get "si" again, "script_names" may have been reallocated. */
+	si = &SCRIPT_ITEM(current_SID);
+	profile_end(&si->pr_start);
+	profile_sub_wait(&wait_start, &si->pr_start);
+	profile_add(&si->pr_total, &si->pr_start);
+	profile_self(&si->pr_self, &si->pr_start, &si->pr_children);
+    }
+#endif
+
     retval = OK;
     fclose(cookie.fp);
     vim_free(cookie.nextline);
@@ -2367,6 +3095,10 @@ do_source(fname, check_other, is_vimrc)
 #ifdef FEAT_EVAL
     current_SID = save_current_SID;
     restore_funccal(save_funccalp);
+#endif
+#ifdef FEAT_PROFILE
+    if (prof_child)
+	prof_child_exit(&wait_start);
 #endif
     if (p_verbose > 1)
     {
@@ -2374,14 +3106,12 @@ do_source(fname, check_other, is_vimrc)
 	if (sourcing_name != NULL)
 	    msg_str((char_u *)_("continuing in %s"), sourcing_name);
     }
-#ifdef STARTUPTIME
-# ifdef HAVE_SNPRINTF
-    snprintf(IObuff, IOSIZE, "sourcing %s", fname);
-# else
-    sprintf(IObuff, "sourcing %s", fname);
-# endif
-    time_msg(IObuff, &tv_start);
-    time_pop(&tv_rel);
+#ifdef FEAT_STARTUPTIME
+    if (time_fd != NULL)
+    {
+	time_msg("source", (char *)fname, &tv_start);
+	time_pop(&tv_rel);
+    }
 #endif
 
 #ifdef FEAT_EVAL
@@ -2415,6 +3145,215 @@ ex_scriptnames(eap)
 	    smsg((char_u *)"%3d: %s", i, SCRIPT_NAME(i));
 }
 
+# if defined(FEAT_PROFILE) || defined(PROTO)
+/*
+ * Start profiling script "si".
+ */
+    static void
+script_do_profile(si)
+    struct scriptstuff	*si;
+{
+    si->pr_count = 0;
+    profile_zero(&si->pr_total);
+    profile_zero(&si->pr_self);
+
+    ga_init2(&si->prl_ga, sizeof(struct scriptline), 100);
+    si->prl_idx = -1;
+    si->prof_on = TRUE;
+    si->pr_nest = 0;
+}
+
+/*
+ * Save time when starting to invoke another script or function.
+ */
+    void
+script_prof_save(tm)
+    proftime_T	*tm;	    /* place to store wait time */
+{
+    struct scriptstuff	*si;
+
+    if (current_SID > 0 && current_SID <= script_names.ga_len)
+    {
+	si = &SCRIPT_ITEM(current_SID);
+	if (si->prof_on && si->pr_nest++ == 0)
+	    profile_start(&si->pr_child);
+    }
+    profile_get_wait(tm);
+}
+
+/*
+ * Count time spent in children after invoking another script or function.
+ */
+    void
+script_prof_restore(tm)
+    proftime_T	*tm;	    /* wait time stored by script_prof_save() */
+{
+    struct scriptstuff	*si;
+
+    if (current_SID > 0 && current_SID <= script_names.ga_len)
+    {
+	si = &SCRIPT_ITEM(current_SID);
+	if (si->prof_on && si->pr_nest > 0 && --si->pr_nest == 0)
+	{
+	    profile_end(&si->pr_child);
+	    profile_sub_wait(tm, &si->pr_child); /* don't count wait time */
+	    profile_add(&si->pr_children, &si->pr_child);
+	    profile_add(&si->prl_children, &si->pr_child);
+	}
+    }
+}
+
+/*
+ * Called when starting to read a script line.
+ * "sourcing_lnum" must be correct!
+ */
+    void
+script_line_start()
+{
+    struct scriptstuff	*si;
+    struct scriptline	*pp;
+
+    if (current_SID <= 0 || current_SID > script_names.ga_len)
+	return;
+    si = &SCRIPT_ITEM(current_SID);
+    if (si->prof_on && sourcing_lnum >= 1)
+    {
+	/* Grow the array before starting the timer, so that the time spent
+	 * here isn't counted. */
+	ga_grow(&si->prl_ga, (int)(sourcing_lnum - si->prl_ga.ga_len));
+	si->prl_idx = sourcing_lnum - 1;
+	while (si->prl_ga.ga_len <= si->prl_idx && si->prl_ga.ga_room > 0)
+	{
+	    /* Zero counters for a line that was not used before. */
+	    pp = &PRL_ITEM(si, si->prl_ga.ga_len);
+	    pp->count = 0;
+	    profile_zero(&pp->total);
+	    profile_zero(&pp->self);
+	    ++si->prl_ga.ga_len;
+	    --si->prl_ga.ga_room;
+	}
+	si->prl_execed = FALSE;
+	profile_start(&si->prl_start);
+	profile_zero(&si->prl_children);
+	profile_get_wait(&si->prl_wait);
+    }
+}
+
+/*
+ * Called when actually executing a command of a script line.
+ */
+    void
+script_line_exec()
+{
+    struct scriptstuff	*si;
+
+    if (current_SID <= 0 || current_SID > script_names.ga_len)
+	return;
+    si = &SCRIPT_ITEM(current_SID);
+    if (si->prof_on && si->prl_idx >= 0)
+	si->prl_execed = TRUE;
+}
+
+/*
+ * Called when done with a script line.
+ */
+    void
+script_line_end()
+{
+    struct scriptstuff	*si;
+    struct scriptline	*pp;
+
+    if (current_SID <= 0 || current_SID > script_names.ga_len)
+	return;
+    si = &SCRIPT_ITEM(current_SID);
+    if (si->prof_on && si->prl_idx >= 0
+				     && si->prl_idx < si->prl_ga.ga_len)
+    {
+	if (si->prl_execed)
+	{
+	    pp = &PRL_ITEM(si, si->prl_idx);
+	    ++pp->count;
+	    profile_end(&si->prl_start);
+	    profile_sub_wait(&si->prl_wait, &si->prl_start);
+	    profile_add(&pp->total, &si->prl_start);
+	    profile_self(&pp->self, &si->prl_start, &si->prl_children);
+	}
+	si->prl_idx = -1;
+    }
+}
+
+/*
+ * Return TRUE when a function defined in the current script should be
+ * profiled.
+ */
+    int
+prof_def_func()
+{
+    if (current_SID > 0 && current_SID <= script_names.ga_len)
+	return SCRIPT_ITEM(current_SID).pr_force;
+    return FALSE;
+}
+
+/*
+ * Dump the profiling info for sourced scripts to "fd".  The script is read
+ * again to show each line with its count and times.
+ */
+    static void
+script_dump_profile(fd)
+    FILE	*fd;
+{
+    int			id;
+    struct scriptstuff	*si;
+    struct scriptline	*pp;
+    int			i;
+    FILE		*sfd;
+
+    for (id = 1; id <= script_names.ga_len; ++id)
+    {
+	si = &SCRIPT_ITEM(id);
+	if (si->name == NULL || !si->prof_on)
+	    continue;
+
+	fprintf(fd, "SCRIPT  %s\n", si->name);
+	if (si->pr_count == 1)
+	    fprintf(fd, "Sourced 1 time\n");
+	else
+	    fprintf(fd, "Sourced %d times\n", si->pr_count);
+	fprintf(fd, "Total time: %s\n", profile_msg(&si->pr_total));
+	fprintf(fd, " Self time: %s\n", profile_msg(&si->pr_self));
+	fprintf(fd, "\n");
+	fprintf(fd, "count  total (s)   self (s)\n");
+
+	sfd = mch_fopen((char *)si->name, "r");
+	if (sfd == NULL)
+	    fprintf(fd, "Cannot open file!\n");
+	else
+	{
+	    for (i = 0; !vim_fgets(IObuff, IOSIZE, sfd); ++i)
+	    {
+		pp = (i < si->prl_ga.ga_len) ? &PRL_ITEM(si, i) : NULL;
+		if (pp != NULL && pp->count > 0)
+		{
+		    fprintf(fd, "%5d ", pp->count);
+		    if (profile_equal(&pp->total, &pp->self))
+			fprintf(fd, "           ");
+		    else
+			fprintf(fd, "%s ", profile_msg(&pp->total));
+		    fprintf(fd, "%s ", profile_msg(&pp->self));
+		}
+		else
+		    fprintf(fd, "                            ");
+		fprintf(fd, "%s", IObuff);
+		if (*IObuff == NUL || IObuff[STRLEN(IObuff) - 1] != '\n')
+		    fprintf(fd, "\n");
+	    }
+	    fclose(sfd);
+	}
+	fprintf(fd, "\n");
+    }
+}
+# endif
+
 # if defined(BACKSLASH_IN_FILENAME) || defined(PROTO)
 /*
  * Fix slashes in the list of script names for 'shellslash'.
@@ -3236,7 +4175,7 @@ prt_header(psettings, pagenum, lnum)
 	printer_page_num = pagenum;
 
 	build_stl_str_hl(curwin, tbuf, (size_t)(width + IOSIZE),
-						  p_header, ' ', width, NULL);
+					    p_header, ' ', width, NULL, NULL);
 
 	/* Reset line numbers */
 	curwin->w_cursor.lnum = tmp_lnum;
@@ -65,6 +65,8 @@ static char_u	*do_one_cmd __ARGS((char_u **, int, char_u *(*getline)(int, void *
 static int	if_level = 0;		/* depth in :if */
 #endif
 static int	checkforcmd __ARGS((char_u **pp, char *cmd, int len));
+static unsigned	cmd_name_hash __ARGS((char_u *name, int len));
+static int	init_cmd_hash __ARGS((void));
 static char_u	*find_command __ARGS((exarg_T *eap, int *full));
 
 static void	ex_abbreviate __ARGS((exarg_T *eap));
@@ -212,6 +214,9 @@ static void	ex_popup __ARGS((exarg_T *eap));
 #ifndef FEAT_GUI_GTK
 # define ex_helpfind		ex_ni
 #endif
+#ifndef FEAT_TAG_XREF
+# define ex_mkxref		ex_ni
+#endif
 #ifndef FEAT_CSCOPE
 # define do_cscope		ex_ni
 # define do_scscope		ex_ni
@@ -409,6 +414,9 @@ static void	ex_folddo __ARGS((exarg_T *eap));
 # define ex_breakdel		ex_ni
 # define ex_breaklist		ex_ni
 #endif
+#ifndef FEAT_PROFILE
+# define ex_profile		ex_ni
+#endif
 
 #ifndef FEAT_CMDHIST
 # define ex_history		ex_ni
@@ -458,6 +466,22 @@ cmdidx_T cmdidxs[27] =
 	CMD_bang
 };
 
+/*
+ * Hash table to find a command by its full name or an abbreviation in one
+ * lookup, instead of comparing with each command that starts with the same
+ * character.  Built from cmdnames[] by init_cmd_hash() when first used.
+ * Each abbreviation is mapped to the first command in cmdnames[] that
+ * starts with it, which is what searching from cmdidxs[] would find.
+ */
+typedef struct
+{
+    short	ch_idx;		/* index in cmdnames[], -1 for unused entry */
+    short	ch_len;		/* length of the (abbreviated) name */
+} cmdhash_T;
+
+static cmdhash_T *cmd_hash = NULL;
+static int	cmd_hash_mask = 0;	/* table size minus one */
+
 static char_u dollar_command[2] = {'$', 0};
 
 
@@ -658,6 +682,9 @@ do_cmdline(cmdline, getline, cookie, flags)
 # define cmd_cookie cookie
 #endif
     static int	call_depth = 0;		/* recursiveness */
+#ifdef FEAT_PROFILE
+    linenr_T	prof_lnum = 0;		/* line being profiled */
+#endif
 
 #ifdef FEAT_EVAL
     /* For every pair of do_cmdline()/do_one_cmd() calls, use an extra memory
@@ -982,6 +1009,26 @@ do_cmdline(cmdline, getline, cookie, flags)
 	    --no_wait_return;
 	}
 
+#ifdef FEAT_PROFILE
+	/* Time each line of a profiled function or script, the '|'
+	 * separated commands in a line count for that line. */
+	if (do_profiling == PROF_YES && sourcing_lnum != prof_lnum)
+	{
+	    if (getline_equal(getline, cookie, get_func_line))
+	    {
+		func_line_end(real_cookie);
+		func_line_start(real_cookie);
+		prof_lnum = sourcing_lnum;
+	    }
+	    else if (getline_equal(getline, cookie, getsourceline))
+	    {
+		script_line_end();
+		script_line_start();
+		prof_lnum = sourcing_lnum;
+	    }
+	}
+#endif
+
 	/*
 	 * 2. Execute one '|' separated command.
 	 *    do_one_cmd() will return NULL if there is no trailing '|'.
@@ -1171,6 +1218,15 @@ do_cmdline(cmdline, getline, cookie, flags)
 			|| (flags & DOCMD_REPEAT)));
 
     vim_free(cmdline_copy);
+#ifdef FEAT_PROFILE
+    if (prof_lnum != 0)
+    {
+	if (getline_equal(getline, cookie, get_func_line))
+	    func_line_end(real_cookie);
+	else
+	    script_line_end();
+    }
+#endif
 #ifdef FEAT_EVAL
     free_cmdlines(&lines_ga);
     ga_clear(&lines_ga);
@@ -1600,6 +1656,11 @@ do_one_cmd(cmdlinep, sourcing,
 	    )
 	--quitmore;
 
+#ifdef FEAT_STL_OPT
+    /* The command may change anything a status line item shows. */
+    ++stl_tick;
+#endif
+
     /*
      * Reset browse, confirm, etc..  They are restored when returning, for
      * recursive calls.
@@ -1772,6 +1833,16 @@ do_one_cmd(cmdlinep, sourcing,
 	(void)do_intthrow(cstack);
     }
 #endif
+#ifdef FEAT_PROFILE
+    /* Count the line as executed, unless the command is skipped. */
+    if (do_profiling == PROF_YES && !ea.skip)
+    {
+	if (getline_equal(getline, cookie, get_func_line))
+	    func_line_exec(getline_cookie(getline, cookie));
+	else if (getline_equal(getline, cookie, getsourceline))
+	    script_line_exec();
+    }
+#endif
 
 /*
  * 3. parse a range specifier of the form: addr [,addr] [;addr] ..
@@ -2286,7 +2357,8 @@ do_one_cmd(cmdlinep, sourcing,
     {
 	n = getdigits(&ea.arg);
 	ea.arg = skipwhite(ea.arg);
-	if (n <= 0 && !ni)
+	/* ":undo 0" goes back to before the first change. */
+	if (n <= 0 && !ni && ea.cmdidx != CMD_undo)
 	{
 	    errormsg = (char_u *)_(e_zerocount);
 	    goto doend;
@@ -2580,6 +2652,71 @@ checkforcmd(pp, cmd, len)
     return FALSE;
 }
 
+/*
+ * Hash function for the first "len" bytes of command name "name".
+ */
+    static unsigned
+cmd_name_hash(name, len)
+    char_u	*name;
+    int		len;
+{
+    unsigned	hash = 0;
+
+    while (len-- > 0)
+	hash = hash * 33 + *name++;
+    return hash;
+}
+
+/*
+ * Fill cmd_hash[] with all command names and their abbreviations.
+ * Returns FAIL when out of memory.
+ */
+    static int
+init_cmd_hash()
+{
+    int		idx;
+    int		len;
+    int		todo = 0;
+    int		size;
+    unsigned	hash;
+    cmdhash_T	*hp;
+
+    for (idx = 0; idx < (int)CMD_SIZE; ++idx)
+	todo += (int)STRLEN(cmdnames[idx].cmd_name);
+    /* Keep the table at most half full. */
+    for (size = 256; size < todo * 2; size <<= 1)
+	;
+    cmd_hash = (cmdhash_T *)alloc((unsigned)(size * sizeof(cmdhash_T)));
+    if (cmd_hash == NULL)
+	return FAIL;
+    cmd_hash_mask = size - 1;
+    for (hash = 0; hash < (unsigned)size; ++hash)
+	cmd_hash[hash].ch_idx = -1;
+
+    for (idx = 0; idx < (int)CMD_SIZE; ++idx)
+	for (len = 1; cmdnames[idx].cmd_name[len - 1] != NUL; ++len)
+	{
+	    /* Linear probing.  When an earlier command already has this
+	     * abbreviation it is not added. */
+	    hash = cmd_name_hash(cmdnames[idx].cmd_name, len);
+	    for (;;)
+	    {
+		hp = &cmd_hash[hash & cmd_hash_mask];
+		if (hp->ch_idx < 0)
+		{
+		    hp->ch_idx = idx;
+		    hp->ch_len = len;
+		    break;
+		}
+		if (hp->ch_len == len && STRNCMP(cmdnames[hp->ch_idx].cmd_name,
+				       cmdnames[idx].cmd_name, (size_t)len) == 0)
+		    break;
+		++hash;
+	    }
+	}
+    return OK;
+}
+
 /*
  * Find an Ex command by its name, either built-in or user.
  * Name can be found at eap->cmd.
@@ -2628,23 +2765,51 @@ find_command(eap, full)
 	    ++p;
 	len = (int)(p - eap->cmd);
 
-	if (ASCII_ISLOWER(*eap->cmd))
-	    eap->cmdidx = cmdidxs[CharOrdLow(*eap->cmd)];
-	else
-	    eap->cmdidx = cmdidxs[26];
+	if (len > 0 && (cmd_hash != NULL || init_cmd_hash() == OK))
+	{
+	    cmdhash_T	*hp;
+	    unsigned	hash = cmd_name_hash(eap->cmd, len);
 
-	for ( ; (int)eap->cmdidx < (int)CMD_SIZE;
-			       eap->cmdidx = (cmdidx_T)((int)eap->cmdidx + 1))
-	    if (STRNCMP(cmdnames[(int)eap->cmdidx].cmd_name, (char *)eap->cmd,
-							    (size_t)len) == 0)
+	    eap->cmdidx = CMD_SIZE;
+	    for (;;)
 	    {
+		hp = &cmd_hash[hash & cmd_hash_mask];
+		if (hp->ch_idx < 0)
+		    break;
+		if (hp->ch_len == len && STRNCMP(cmdnames[hp->ch_idx].cmd_name,
+					      (char *)eap->cmd, (size_t)len) == 0)
+		{
+		    eap->cmdidx = (cmdidx_T)hp->ch_idx;
 #ifdef FEAT_EVAL
-		if (full != NULL
+		    if (full != NULL
 			   && cmdnames[(int)eap->cmdidx].cmd_name[len] == NUL)
-		    *full = TRUE;
+			*full = TRUE;
 #endif
-		break;
+		    break;
+		}
+		++hash;
 	    }
+	}
+	else
+	{
+	    if (ASCII_ISLOWER(*eap->cmd))
+		eap->cmdidx = cmdidxs[CharOrdLow(*eap->cmd)];
+	    else
+		eap->cmdidx = cmdidxs[26];
+
+	    for ( ; (int)eap->cmdidx < (int)CMD_SIZE;
+			       eap->cmdidx = (cmdidx_T)((int)eap->cmdidx + 1))
+		if (STRNCMP(cmdnames[(int)eap->cmdidx].cmd_name,
+					(char *)eap->cmd, (size_t)len) == 0)
+		{
+#ifdef FEAT_EVAL
+		    if (full != NULL
+			   && cmdnames[(int)eap->cmdidx].cmd_name[len] == NUL)
+			*full = TRUE;
+#endif
+		    break;
+		}
+	}
 
 #ifdef FEAT_USR_CMDS
 	/* Look for a user defined command as a last resort */
@@ -7342,14 +7507,16 @@ ex_bang(eap)
 }
 
 /*
- * ":undo".
+ * ":undo" and ":undo N".
  */
-/*ARGSUSED*/
     static void
 ex_undo(eap)
     exarg_T	*eap;
 {
-    u_undo(1);
+    if (eap->addr_count == 1)	    /* :undo 123 */
+	u_undo_to((long)eap->line2);
+    else
+	u_undo(1);
 }
 
 /*
@@ -9618,7 +9785,7 @@ ex_nohlsearch(eap)
     exarg_T	*eap;
 {
     no_hlsearch = TRUE;
-    redraw_all_later(NOT_VALID);
+    redraw_all_lines_later();
 }
 
 /*
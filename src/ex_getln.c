@@ -289,7 +289,9 @@ getcmdline(firstc, count, indent)
 	quit_more = FALSE;	/* reset after CTRL-D which had a more-prompt */
 
 	cursorcmd();		/* set the cursor on the right spot */
+	allow_paste = TRUE;
 	c = safe_vgetc();
+	allow_paste = FALSE;
 	if (KeyTyped)
 	{
 	    some_key_typed = TRUE;
@@ -1124,6 +1126,28 @@ getcmdline(firstc, count, indent)
 	case K_IGNORE:
 		goto cmdline_not_changed;	/* Ignore mouse */
 
+	case K_PS:	/* bracketed paste: insert the text literally, without
+			 * the line breaks */
+		{
+		    garray_T	ga;
+		    char_u	*p, *s;
+
+		    ga_init2(&ga, 1, 1000);
+		    (void)get_bracketed_paste(&ga);
+		    p = (char_u *)ga.ga_data;
+		    for (s = p, i = 0; i < ga.ga_len; ++i)
+			if (p[i] != CAR && p[i] != NL && p[i] != NUL)
+			    *s++ = p[i];
+		    if (s > p)
+			put_on_cmdline(p, (int)(s - p), FALSE);
+		    ga_clear(&ga);
+		}
+		redrawcmd();
+		goto cmdline_changed;
+
+	case K_PE:	/* end of paste without a start */
+		goto cmdline_not_changed;
+
 #ifdef FEAT_MOUSE
 	case K_MIDDLEDRAG:
 	case K_MIDDLERELEASE:
@@ -349,6 +349,22 @@
 # define FEAT_TAG_BINS
 #endif
 
+/*
+ * +tag_index		Keep tags files in memory with an index on the tag
+ *			names, for fast searching also when ignoring case.
+ */
+#if defined(FEAT_TAG_BINS) && defined(UNIX)
+# define FEAT_TAG_INDEX
+#endif
+
+/*
+ * +tag_xref		":mkxref": make a tags file with the identifiers used
+ *			in files, updated when one of them is written.
+ */
+#ifdef FEAT_TAG_BINS
+# define FEAT_TAG_XREF
+#endif
+
 /*
  * +tag_old_static	Old style static tags: "file:tag  file  ..".  Slows
  *			down tag searching a bit.
@@ -378,6 +394,15 @@
 # define FEAT_EVAL
 #endif
 
+/*
+ * +profile		Profiling for functions and scripts, ":profile".
+ *			Needs gettimeofday() for the timing.
+ */
+#if defined(FEAT_HUGE) && defined(FEAT_EVAL) \
+	&& defined(HAVE_GETTIMEOFDAY) && defined(HAVE_SYS_TIME_H)
+# define FEAT_PROFILE
+#endif
+
 /*
  * +user_commands	Allow the user to define his own commands.
  */
@@ -781,10 +806,14 @@
 /* #define DEBUG */
 
 /*
- * STARTUPTIME		Time the startup process.  Writes a "vimstartup" file
- *			with timestamps.
+ * +startuptime		Time the startup process.  With the --startuptime
+ *			{fname} argument the timestamps are written to
+ *			{fname}.  Only possible when gettimeofday() is
+ *			available.
  */
-/* #define STARTUPTIME "vimstartup" */
+#if defined(HAVE_GETTIMEOFDAY) && defined(HAVE_SYS_TIME_H)
+# define FEAT_STARTUPTIME
+#endif
 
 /*
  * MEM_PROFILE		Debugging of memory allocation and freeing.
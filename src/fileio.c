@@ -35,6 +35,9 @@
 
 #define BUFSIZE		8192	/* size of normal write buffer */
 #define SMBUFSIZE	256	/* size of emergency write buffer */
+#ifndef WRITEBUFSIZE
+# define WRITEBUFSIZE	65536	/* size of buffer for writing a file */
+#endif
 
 #ifdef FEAT_CRYPT
 # define CRYPT_MAGIC		"VimCrypt~01!"	/* "01" is the version nr */
@@ -63,6 +66,7 @@ static void set_file_time __ARGS((char_u *fname, time_t atime, time_t mtime));
 #endif
 static void msg_add_fname __ARGS((buf_T *, char_u *));
 static int msg_add_fileformat __ARGS((int eol_type));
+static int append_read_lines __ARGS((linenr_T lnum, char_u **lines, colnr_T *lens, int *countp, int newfile));
 static void msg_add_lines __ARGS((int, long, long));
 static void msg_add_eol __ARGS((void));
 static int check_mtime __ARGS((buf_T *buf, struct stat *s));
@@ -97,6 +101,9 @@ static int apply_autocmds_exarg __ARGS((EVENT_T event, char_u *fname, char_u *fn
  * for the next call.  The value is guessed... */
 #define CONV_RESTLEN 30
 
+/* Number of lines readfile() collects before appending them to the buffer. */
+#define READ_LINES_MAX 256
+
 /* We have to guess how much a sequence of bytes may expand when converting
  * with iconv() to be able to allocate a buffer. */
 #define ICONV_MULT 8
@@ -123,9 +130,42 @@ struct bw_info
     iconv_t	bw_iconv_fd;	/* descriptor for iconv() or -1 */
 # endif
 #endif
+#ifdef UNIX
+    garray_T	*bw_ga;		/* when not NULL collect the text here
+				   instead of writing it */
+#endif
 };
 
 static int  buf_write_bytes __ARGS((struct bw_info *ip));
+#ifdef HAVE_WRITEV
+static int  buf_write_iov __ARGS((struct bw_info *ip, char_u *ptr, long len));
+#endif
+
+#ifdef UNIX
+/*
+ * Writes done in the background for 'asyncwrite'.  A child process writes
+ * the text to a temp file and renames it to the file name.  The list is used
+ * to report the result when it has finished.
+ */
+typedef struct bgwrite_S bgwrite_T;
+struct bgwrite_S
+{
+    bgwrite_T	*bgw_next;
+    long	bgw_pid;	/* child process, zero when already done */
+    int		bgw_result;	/* BGW_ value when bgw_pid is zero */
+    int		bgw_fnum;	/* number of the written buffer */
+    char_u	*bgw_fname;	/* written file name */
+    char_u	*bgw_tmpname;	/* full name of the temp file */
+    char_u	*bgw_msg;	/* message to give when done or NULL */
+};
+
+static bgwrite_T *first_bgwrite = NULL;
+
+static int bgwrite_open __ARGS((buf_T *buf, char_u *fname, char_u *sfname, exarg_T *eap, struct stat *st_old, int newfile, long perm, char_u **tmpnamep));
+static bgwrite_T *bgwrite_start __ARGS((buf_T *buf, int fd, garray_T *gap, char_u *fname, char_u *tmpname));
+static void bgwrite_done __ARGS((bgwrite_T *bgw, int result));
+static int bgwrite_check_match __ARGS((buf_T *buf, char_u *fname, char_u *cmd, int wait));
+#endif
 
 #ifdef FEAT_MBYTE
 static int ucs2bytes __ARGS((unsigned c, char_u **pp, int flags));
@@ -233,6 +273,12 @@ readfile(fname, sfname, from, lines_to_skip, lines_to_read, eap, flags)
     colnr_T	len;
     long	size = 0;
     char_u	*p;
+    char_u	*q;
+    char_u	*end;
+    int		has_nul;
+    char_u	*read_lines[READ_LINES_MAX];	/* lines not appended yet */
+    colnr_T	read_lens[READ_LINES_MAX];
+    int		read_lines_count = 0;
     long	filesize = 0;
     int		skip_read = FALSE;
 #ifdef FEAT_CRYPT
@@ -293,6 +339,10 @@ readfile(fname, sfname, from, lines_to_skip, lines_to_read, eap, flags)
 #ifdef FEAT_AUTOCMD
     write_no_eol_lnum = 0;	/* in case it was set by the previous read */
 #endif
+#ifdef UNIX
+    /* The file may still be written in the background. */
+    bgwrite_wait_file(fname);
+#endif
 
     /*
      * If there is no file name yet, use the one for the read file.
@@ -1805,17 +1855,13 @@ rewind_retry:
 		/* First try finding a NL, for Dos and Unix */
 		if (try_dos || try_unix)
 		{
-		    for (p = ptr; p < ptr + size; ++p)
+		    p = memchr(ptr, NL, (size_t)size);
+		    if (p != NULL)
 		    {
-			if (*p == NL)
-			{
-			    if (!try_unix
-				    || (try_dos && p > ptr && p[-1] == CAR))
-				fileformat = EOL_DOS;
-			    else
-				fileformat = EOL_UNIX;
-			    break;
-			}
+			if (!try_unix || (try_dos && p > ptr && p[-1] == CAR))
+			    fileformat = EOL_DOS;
+			else
+			    fileformat = EOL_UNIX;
 		    }
 
 		    /* Don't give in to EOL_UNIX if EOL_MAC is more likely */
@@ -1876,13 +1922,17 @@ rewind_retry:
 		    if (skip_count == 0)
 		    {
 			*ptr = NUL;	    /* end of line */
-			len = (colnr_T) (ptr - line_start + 1);
-			if (ml_append(lnum, line_start, len, newfile) == FAIL)
+			read_lines[read_lines_count] = line_start;
+			read_lens[read_lines_count++] =
+					  (colnr_T)(ptr - line_start + 1);
+			++lnum;
+			if (read_lines_count == READ_LINES_MAX
+				&& append_read_lines(lnum, read_lines,
+			       read_lens, &read_lines_count, newfile) == FAIL)
 			{
 			    error = TRUE;
 			    break;
 			}
-			++lnum;
 			if (--read_count == 0)
 			{
 			    error = TRUE;	/* break loop */
@@ -1898,68 +1948,91 @@ rewind_retry:
 	}
 	else
 	{
-	    --ptr;
-	    while (++ptr, --size >= 0)
+	    /*
+	     * Unix and Dos format: memchr() is used to find the end of each
+	     * line, it is much faster than looking at every byte.  NULs are
+	     * replaced by newlines!  They are rare, only look for them in a
+	     * line when the block contains one.
+	     */
+	    end = ptr + size;
+	    has_nul = (memchr(ptr, NUL, (size_t)size) != NULL);
+	    for (;;)
 	    {
-		if ((c = *ptr) != NUL && c != NL)  /* catch most common case */
-		    continue;
-		if (c == NUL)
-		    *ptr = NL;	/* NULs are replaced by newlines! */
-		else
+		q = ptr;
+		ptr = memchr(ptr, NL, (size_t)(end - ptr));
+		if (ptr == NULL)
+		    ptr = end;
+		if (has_nul)
+		    while ((q = memchr(q, NUL, (size_t)(ptr - q))) != NULL)
+			*q++ = NL;
+		if (ptr == end)
+		    break;
+
+		if (skip_count == 0)
 		{
-		    if (skip_count == 0)
+		    *ptr = NUL;		/* end of line */
+		    len = (colnr_T)(ptr - line_start + 1);
+		    if (fileformat == EOL_DOS)
 		    {
-			*ptr = NUL;		/* end of line */
-			len = (colnr_T)(ptr - line_start + 1);
-			if (fileformat == EOL_DOS)
+			if (ptr[-1] == CAR)	/* remove CR */
 			{
-			    if (ptr[-1] == CAR)	/* remove CR */
-			    {
-				ptr[-1] = NUL;
-				--len;
-			    }
-			    /*
-			     * Reading in Dos format, but no CR-LF found!
-			     * When 'fileformats' includes "unix", delete all
-			     * the lines read so far and start all over again.
-			     * Otherwise give an error message later.
-			     */
-			    else if (ff_error != EOL_DOS)
-			    {
-				if (   try_unix
-				    && !read_stdin
-				    && (read_buffer
-					|| lseek(fd, (off_t)0L, SEEK_SET) == 0))
-				{
-				    fileformat = EOL_UNIX;
-				    if (newfile)
-					set_fileformat(EOL_UNIX, OPT_LOCAL);
-				    file_rewind = TRUE;
-				    keep_fileformat = TRUE;
-				    goto retry;
-				}
-				ff_error = EOL_DOS;
-			    }
+			    ptr[-1] = NUL;
+			    --len;
 			}
-			if (ml_append(lnum, line_start, len, newfile) == FAIL)
-			{
-			    error = TRUE;
-			    break;
-			}
-			++lnum;
-			if (--read_count == 0)
+			/*
+			 * Reading in Dos format, but no CR-LF found!
+			 * When 'fileformats' includes "unix", delete all
+			 * the lines read so far and start all over again.
+			 * Otherwise give an error message later.
+			 */
+			else if (ff_error != EOL_DOS)
 			{
-			    error = TRUE;	    /* break loop */
-			    line_start = ptr;	/* nothing left to write */
-			    break;
+			    if (   try_unix
+				&& !read_stdin
+				&& (read_buffer
+				    || lseek(fd, (off_t)0L, SEEK_SET) == 0))
+			    {
+				fileformat = EOL_UNIX;
+				if (newfile)
+				    set_fileformat(EOL_UNIX, OPT_LOCAL);
+				file_rewind = TRUE;
+				keep_fileformat = TRUE;
+				/* the lines are deleted, they must be in
+				 * the buffer */
+				(void)append_read_lines(lnum, read_lines,
+				       read_lens, &read_lines_count, newfile);
+				goto retry;
+			    }
+			    ff_error = EOL_DOS;
 			}
 		    }
-		    else
-			--skip_count;
-		    line_start = ptr + 1;
+		    read_lines[read_lines_count] = line_start;
+		    read_lens[read_lines_count++] = len;
+		    ++lnum;
+		    if (read_lines_count == READ_LINES_MAX
+			    && append_read_lines(lnum, read_lines, read_lens,
+					 &read_lines_count, newfile) == FAIL)
+		    {
+			error = TRUE;
+			break;
+		    }
+		    if (--read_count == 0)
+		    {
+			error = TRUE;	    /* break loop */
+			line_start = ptr;	/* nothing left to write */
+			break;
+		    }
 		}
+		else
+		    --skip_count;
+		line_start = ptr + 1;
+		++ptr;
 	    }
 	}
+	/* The lines are in "buffer", append them before reading more. */
+	if (read_lines_count > 0 && append_read_lines(lnum, read_lines,
+			       read_lens, &read_lines_count, newfile) == FAIL)
+	    error = TRUE;
 	linerest = (long)(ptr - line_start);
 	ui_breakcheck();
     }
@@ -2310,6 +2383,24 @@ failed:
     return OK;
 }
 
+/*
+ * Append the "*countp" lines collected by readfile(), the last one becomes
+ * line "lnum".  "*countp" is reset to zero.
+ */
+    static int
+append_read_lines(lnum, lines, lens, countp, newfile)
+    linenr_T	lnum;
+    char_u	**lines;
+    colnr_T	*lens;
+    int		*countp;
+    int		newfile;
+{
+    long	count = *countp;
+
+    *countp = 0;
+    return ml_append_lines(lnum - count, lines, lens, count, newfile);
+}
+
 /*
  * Fill "*eap" to force the 'fileencoding' and 'fileformat' to be equal to the
  * buffer "buf".  Used for calling readfile().
@@ -2589,6 +2680,8 @@ buf_write(buf, fname, sfname, start, end, eap, append, forceit,
     char_u	    *ptr;
     char_u	    c;
     int		    len;
+    long	    linelen;
+    int		    n;
     linenr_T	    lnum;
     long	    nchars;
     char_u	    *errmsg = NULL;
@@ -2633,6 +2726,17 @@ buf_write(buf, fname, sfname, start, end, eap, append, forceit,
     vim_acl_T	    acl = NULL;		/* ACL copied from original file to
 					   backup or new file */
 #endif
+#ifdef HAVE_WRITEV
+    int		    can_writev;		/* write long lines directly */
+#endif
+#ifdef UNIX
+    int		    bgwrite = FALSE;	/* writing in the background */
+    int		    bg_fd = -1;		/* temp file for background write */
+    char_u	    *bg_tmpname = NULL;
+    garray_T	    bg_ga;		/* text for background write */
+    int		    bg_result;
+    bgwrite_T	    *bgw = NULL;
+#endif
 
     if (fname == NULL || *fname == NUL)	/* safety check */
 	return FAIL;
@@ -2659,6 +2763,15 @@ buf_write(buf, fname, sfname, start, end, eap, append, forceit,
 # ifdef USE_ICONV
     write_info.bw_iconv_fd = (iconv_t)-1;
 # endif
+#endif
+#ifdef UNIX
+    write_info.bw_ga = NULL;
+    ga_init2(&bg_ga, 1, BUFSIZE);
+
+    /* Finish a previous background write of this buffer first, the file
+     * must be complete before checking its timestamp. */
+    if (bgwrite_busy(buf))
+	(void)bgwrite_check(buf, TRUE);
 #endif
 
     /*
@@ -2908,7 +3021,7 @@ buf_write(buf, fname, sfname, start, end, eap, append, forceit,
 		    (char_u *)"", 0);	/* show that we are busy */
     msg_scroll = FALSE;		    /* always overwrite the file message now */
 
-    buffer = alloc(BUFSIZE);
+    buffer = alloc(WRITEBUFSIZE);
     if (buffer == NULL)		    /* can't allocate big buffer, use small
 				     * one (to be able to write when out of
 				     * memory) */
@@ -2917,7 +3030,7 @@ buf_write(buf, fname, sfname, start, end, eap, append, forceit,
 	bufsize = SMBUFSIZE;
     }
     else
-	bufsize = BUFSIZE;
+	bufsize = WRITEBUFSIZE;
 
     /*
      * Get information about original file (if there is one).
@@ -3044,6 +3157,26 @@ buf_write(buf, fname, sfname, start, end, eap, append, forceit,
 	dobackup = FALSE;
 #endif
 
+#ifdef UNIX
+    /*
+     * With 'asyncwrite' the buffer may be written in the background.  The
+     * text goes to a temp file that is renamed to the file name when
+     * complete, thus the original file doesn't need a backup.
+     */
+    if (p_asw && overwriting && reset_changed && whole && !append
+	    && !filtering && !device && !file_readonly
+	    && (bg_fd = bgwrite_open(buf, fname, sfname, eap, &st_old, newfile,
+						      perm, &bg_tmpname)) >= 0)
+    {
+# ifdef HAVE_ACL
+	if (!newfile)
+	    mch_set_acl(bg_tmpname, acl);
+# endif
+	bgwrite = TRUE;
+	dobackup = FALSE;
+    }
+#endif
+
     /*
      * Save the value of got_int and reset it.  We don't want a previous
      * interruption cancel writing, only hitting CTRL-C while writing should
@@ -3704,7 +3837,17 @@ buf_write(buf, fname, sfname, start, end, eap, append, forceit,
      * a new one. If this still fails we may have lost the original file!
      * (this may happen when the user reached his quotum for number of files).
      * Appending will fail if the file does not exist and forceit is FALSE.
+     * For a background write the temp file was already opened.
      */
+#ifdef UNIX
+    if (bgwrite)
+    {
+	fd = bg_fd;
+	bg_fd = -1;
+	write_info.bw_ga = &bg_ga;
+    }
+    else
+#endif
     while ((fd = mch_open((char *)wfname, O_WRONLY | O_EXTRA | (append
 			? (forceit ? (O_APPEND | O_CREAT) : O_APPEND)
 			: (O_CREAT | O_TRUNC))
@@ -3871,34 +4014,97 @@ restore_backup:
     write_info.bw_flags = wb_flags;
 #endif
     fileformat = get_fileformat_force(buf, eap);
+#ifdef HAVE_WRITEV
+    /* Without conversion or encryption a long line can be written from the
+     * memline, instead of copying it into the buffer first. */
+    can_writev = (bufsize == WRITEBUFSIZE
+# ifdef HAS_BW_FLAGS
+	    && wb_flags == 0
+# endif
+# ifdef FEAT_MBYTE
+	    && write_info.bw_conv_buf == NULL
+# endif
+# ifdef UNIX
+	    && write_info.bw_ga == NULL
+# endif
+	    );
+#endif
     s = buffer;
     len = 0;
     for (lnum = start; lnum <= end; ++lnum)
     {
-	/*
-	 * The next while loop is done once for each character written.
-	 * Keep it fast!
-	 */
-	ptr = ml_get_buf(buf, lnum, FALSE) - 1;
-	while ((c = *++ptr) != NUL)
+	ptr = ml_get_buf(buf, lnum, FALSE);
+	linelen = (long)STRLEN(ptr);
+	if (memchr(ptr, NL, (size_t)linelen) == NULL
+		&& (fileformat != EOL_MAC
+			     || memchr(ptr, CAR, (size_t)linelen) == NULL))
 	{
-	    if (c == NL)
-		*s = NUL;		/* replace newlines with NULs */
-	    else if (c == CAR && fileformat == EOL_MAC)
-		*s = NL;		/* Mac: replace CRs with NLs */
-	    else
-		*s = c;
-	    ++s;
-	    if (++len != bufsize)
-		continue;
-	    if (buf_write_bytes(&write_info) == FAIL)
+	    /* Nothing to replace in the line: copy it in pieces that fill
+	     * the buffer. */
+#ifdef HAVE_WRITEV
+	    if (can_writev && linelen >= bufsize - len)
 	    {
-		end = 0;		/* write error: break loop */
-		break;
+		/* Write what is in the buffer and the line with one system
+		 * call. */
+		write_info.bw_len = len;
+		if (buf_write_iov(&write_info, ptr, linelen) == FAIL)
+		    end = 0;		/* write error */
+		write_info.bw_len = bufsize;
+		nchars += len + linelen;
+		s = buffer;
+		len = 0;
+		linelen = 0;
+	    }
+#endif
+	    while (linelen > 0)
+	    {
+		n = bufsize - len;
+		if (n > linelen)
+		    n = (int)linelen;
+		mch_memmove(s, ptr, (size_t)n);
+		s += n;
+		ptr += n;
+		linelen -= n;
+		len += n;
+		if (len != bufsize)
+		    continue;
+		if (buf_write_bytes(&write_info) == FAIL)
+		{
+		    end = 0;		/* write error: break loop */
+		    break;
+		}
+		nchars += bufsize;
+		s = buffer;
+		len = 0;
+	    }
+	}
+	else
+	{
+	    /*
+	     * The next while loop is done once for each character written.
+	     * Keep it fast!
+	     */
+	    --ptr;
+	    while ((c = *++ptr) != NUL)
+	    {
+		if (c == NL)
+		    *s = NUL;		/* replace newlines with NULs */
+		else if (c == CAR && fileformat == EOL_MAC)
+		    *s = NL;		/* Mac: replace CRs with NLs */
+		else
+		    *s = c;
+		++s;
+		if (++len != bufsize)
+		    continue;
+		if (buf_write_bytes(&write_info) == FAIL)
+		{
+		    end = 0;		/* write error: break loop */
+		    break;
+		}
+		nchars += bufsize;
+		s = buffer;
+		len = 0;
 	    }
-	    nchars += bufsize;
-	    s = buffer;
-	    len = 0;
 	}
 	/* write failed or last line has no EOL: stop here */
 	if (end == 0
@@ -4001,8 +4207,9 @@ restore_backup:
      * journalled.  Syncing the file slows down the system, but assures it has
      * been written to disk and we don't lose it.
      * For a device do try the fsync() but don't complain if it does not work
-     * (could be a pipe). */
-    if (fsync(fd) != 0 && !device)
+     * (could be a pipe).
+     * A background write does this in the child process. */
+    if (!bgwrite && fsync(fd) != 0 && !device)
     {
 	errmsg = (char_u *)_("E667: Fsync failed");
 	end = 0;
@@ -4030,8 +4237,36 @@ restore_backup:
 # endif
 	buf_setino(buf);
     }
-#endif
 
+    if (bgwrite)
+    {
+	/* Let a child process write the collected text, it also closes
+	 * "fd".  Free the text right away, the child has its own copy.
+	 * When the text didn't fit in memory it was written to the temp file
+	 * already, or when the child can't be started, finish the write
+	 * here. */
+	if (end != 0 && (write_info.bw_ga == NULL
+		 || (bgw = bgwrite_start(buf, fd, &bg_ga, fname,
+						       bg_tmpname)) == NULL))
+	{
+	    bg_result = mch_write_tmp(fd, (char_u *)bg_ga.ga_data,
+				      (long)bg_ga.ga_len, bg_tmpname, fname);
+	    if (bg_result != BGW_OK)
+	    {
+		errmsg = (char_u *)(bg_result == BGW_WRITE
+			    ? _("E514: write error (file system full?)")
+			: bg_result == BGW_FSYNC ? _("E667: Fsync failed")
+			: bg_result == BGW_CLOSE ? _("E512: Close failed")
+			: _("E682: cannot rename temp file"));
+		end = 0;
+	    }
+	}
+	else if (end == 0)
+	    close(fd);
+	ga_clear(&bg_ga);
+    }
+    else
+#endif
     if (close(fd) != 0)
     {
 	errmsg = (char_u *)_("E512: Close failed");
@@ -4093,6 +4328,15 @@ restore_backup:
 		    errmsg = (char_u *)_("E514: write error (file system full?)");
 	}
 
+#ifdef UNIX
+	/* The original file was not touched by a background write. */
+	if (bgwrite)
+	{
+	    mch_remove(bg_tmpname);
+	    end = 1;
+	}
+#endif
+
 	/*
 	 * If we have a backup file, try to put it in place of the new file,
 	 * because the new file is probably corrupt.  This avoids loosing the
@@ -4205,6 +4449,15 @@ restore_backup:
 	    else
 		STRCAT(IObuff, shortmess(SHM_WRI) ? _(" [w]") : _(" written"));
 	}
+#ifdef UNIX
+	if (bgw != NULL)
+	{
+	    /* Give this message when the background write is done. */
+	    bgw->bgw_msg = vim_strsave(IObuff);
+	    msg_add_fname(buf, fname);
+	    STRCAT(IObuff, _("writing in background"));
+	}
+#endif
 
 	set_keep_msg(msg_trunc_attr(IObuff, FALSE, 0));
 	keep_msg_attr = 0;
@@ -4306,8 +4559,20 @@ fail:
     --no_wait_return;		/* may wait for return now */
 nofail:
 
-    /* Done saving, we accept changed buffer warnings again */
+    /* Done saving, we accept changed buffer warnings again.  Not before a
+     * background write has finished. */
+#ifdef UNIX
+    buf->b_saving = (bgw != NULL);
+    if (bg_fd >= 0)		/* background write was not started */
+    {
+	close(bg_fd);
+	mch_remove(bg_tmpname);
+    }
+    vim_free(bg_tmpname);
+    ga_clear(&bg_ga);
+#else
     buf->b_saving = FALSE;
+#endif
 
     vim_free(backup);
     if (buffer != smallbuf)
@@ -4370,6 +4635,17 @@ nofail:
     }
     msg_scroll = msg_save;
 
+#ifdef FEAT_TAG_XREF
+    /* Update tags files made with ":mkxref" for this file.  For a write in
+     * the background this is done when it has finished. */
+    if (retval == OK && !filtering
+# ifdef UNIX
+	    && !bgwrite
+# endif
+	    )
+	xref_written(fname);
+#endif
+
 #ifdef FEAT_AUTOCMD
 #ifdef FEAT_EVAL
     if (!should_abort(retval))
@@ -4419,6 +4695,301 @@ nofail:
     return retval;
 }
 
+#if defined(UNIX) || defined(PROTO)
+/*
+ * Check if buffer "buf" can be written to its file "fname" in the background
+ * and open a temp file for it in the same directory.
+ * Returns the file descriptor, -1 when a normal write is to be done.
+ */
+    static int
+bgwrite_open(buf, fname, sfname, eap, st_old, newfile, perm, tmpnamep)
+    buf_T	*buf;
+    char_u	*fname;
+    char_u	*sfname;
+    exarg_T	*eap;
+    struct stat	*st_old;
+    int		newfile;
+    long	perm;
+    char_u	**tmpnamep;
+{
+    struct stat	st;
+    char_u	*tmpname;
+    int		fd;
+
+    if (p_bk || *p_pm != NUL)
+	return -1;
+#ifdef FEAT_MBYTE
+    /* Converting with 'charconvert' needs a file to start with, keep it
+     * simple and don't convert at all. */
+    if ((eap != NULL && eap->force_enc != 0)
+	    || (*buf->b_p_fenc != NUL && !same_encoding(p_enc, buf->b_p_fenc)))
+	return -1;
+#endif
+#ifdef FEAT_AUTOCMD
+    /* Autocommands would expect the file to be complete. */
+    if (has_autocmd(EVENT_BUFWRITEPOST, sfname))
+	return -1;
+#endif
+    /* Renaming would break a hard or symbolic link and change the owner of
+     * a file that belongs to someone else. */
+    if (!newfile && (st_old->st_nlink > 1
+		|| mch_lstat((char *)fname, &st) < 0
+		|| st.st_dev != st_old->st_dev
+		|| st.st_ino != st_old->st_ino
+		|| st_old->st_uid != getuid()))
+	return -1;
+
+    tmpname = buf_modname(
+#ifdef SHORT_FNAME
+	    TRUE,
+#else
+	    (buf->b_p_sn || buf->b_shortname),
+#endif
+	    fname, (char_u *)".tmp", TRUE);
+    if (tmpname == NULL)
+	return -1;
+    fd = mch_open((char *)tmpname, O_WRONLY | O_EXTRA | O_CREAT | O_EXCL,
+					    perm < 0 ? 0666 : (perm & 0777));
+    if (fd < 0)
+    {
+	vim_free(tmpname);
+	return -1;
+    }
+
+    if (!newfile)
+    {
+# ifdef HAVE_FCHOWN
+	/* The group may differ, e.g. for a directory with the setgid bit. */
+	if (fstat(fd, &st) >= 0 && st.st_gid != st_old->st_gid)
+	    fchown(fd, st_old->st_uid, st_old->st_gid);
+# endif
+	(void)mch_setperm(tmpname, perm);
+    }
+    *tmpnamep = tmpname;
+    return fd;
+}
+
+/*
+ * Start writing the text in "gap" for buffer "buf" in the background.  It
+ * goes to "fd", opened for "tmpname", which is renamed to "fname" when done.
+ * "fd" is closed.
+ * Returns the entry added to the list of background writes, NULL when out
+ * of memory, "fd" is still open then.
+ */
+    static bgwrite_T *
+bgwrite_start(buf, fd, gap, fname, tmpname)
+    buf_T	*buf;
+    int		fd;
+    garray_T	*gap;
+    char_u	*fname;
+    char_u	*tmpname;
+{
+    bgwrite_T	*bgw;
+
+    bgw = (bgwrite_T *)alloc_clear((unsigned)sizeof(bgwrite_T));
+    if (bgw != NULL)
+    {
+	bgw->bgw_fname = vim_strsave(fname);
+	bgw->bgw_tmpname = FullName_save(tmpname, FALSE);
+    }
+    if (bgw == NULL || bgw->bgw_fname == NULL || bgw->bgw_tmpname == NULL)
+    {
+	if (bgw != NULL)
+	{
+	    vim_free(bgw->bgw_fname);
+	    vim_free(bgw);
+	}
+	return NULL;
+    }
+
+    bgw->bgw_result = mch_write_bg(fd, (char_u *)gap->ga_data,
+				(long)gap->ga_len, tmpname, fname, &bgw->bgw_pid);
+    bgw->bgw_fnum = buf->b_fnum;
+    bgw->bgw_next = first_bgwrite;
+    first_bgwrite = bgw;
+    return bgw;
+}
+
+/*
+ * Return TRUE if a background write for buffer "buf" has not been reported
+ * yet.  When "buf" is NULL for any buffer.
+ */
+    int
+bgwrite_busy(buf)
+    buf_T	*buf;
+{
+    bgwrite_T	*bgw;
+
+    for (bgw = first_bgwrite; bgw != NULL; bgw = bgw->bgw_next)
+	if (buf == NULL || bgw->bgw_fnum == buf->b_fnum)
+	    return TRUE;
+    return FALSE;
+}
+
+/*
+ * Report background writes for buffer "buf" that have finished.  When "buf"
+ * is NULL for all buffers.  When "wait" is TRUE wait for them to finish.
+ * Returns FAIL when a write failed.
+ */
+    int
+bgwrite_check(buf, wait)
+    buf_T	*buf;
+    int		wait;
+{
+    return bgwrite_check_match(buf, NULL, NULL, wait);
+}
+
+/*
+ * Wait for background writes of file "fname" to finish and report them.
+ * Used before reading or sourcing "fname".  Writes of other files are not
+ * waited for.
+ */
+    void
+bgwrite_wait_file(fname)
+    char_u	*fname;
+{
+    if (fname != NULL && first_bgwrite != NULL)
+	(void)bgwrite_check_match(NULL, fname, NULL, TRUE);
+}
+
+/*
+ * Wait for background writes of files whose name appears in shell command
+ * "cmd" to finish and report them.
+ */
+    void
+bgwrite_wait_cmd(cmd)
+    char_u	*cmd;
+{
+    if (cmd != NULL && first_bgwrite != NULL)
+	(void)bgwrite_check_match(NULL, NULL, cmd, TRUE);
+}
+
+/*
+ * Report finished background writes, like bgwrite_check().  Only for the
+ * writes of buffer "buf", of file "fname" or of a file whose name is in
+ * "cmd", when not NULL.
+ */
+    static int
+bgwrite_check_match(buf, fname, cmd, wait)
+    buf_T	*buf;
+    char_u	*fname;
+    char_u	*cmd;
+    int		wait;
+{
+    bgwrite_T	**pp;
+    bgwrite_T	*bgw;
+    int		result;
+    int		retval = OK;
+
+    pp = &first_bgwrite;
+    while ((bgw = *pp) != NULL)
+    {
+	if ((buf != NULL && bgw->bgw_fnum != buf->b_fnum)
+		|| (fname != NULL && !(fullpathcmp(fname, bgw->bgw_fname,
+							  TRUE) & FPC_SAME))
+		|| (cmd != NULL && strstr((char *)cmd,
+				     (char *)gettail(bgw->bgw_fname)) == NULL))
+	    result = -1;
+	else if (bgw->bgw_pid == 0)
+	    result = bgw->bgw_result;
+	else
+	    result = mch_write_bg_done(bgw->bgw_pid, bgw->bgw_tmpname, wait);
+	if (result < 0)
+	    pp = &bgw->bgw_next;
+	else
+	{
+	    *pp = bgw->bgw_next;
+	    if (result != BGW_OK)
+		retval = FAIL;
+	    bgwrite_done(bgw, result);
+	}
+    }
+    return retval;
+}
+
+/*
+ * A background write has finished with "result": give a message and update
+ * the buffer.  Frees "bgw".
+ */
+    static void
+bgwrite_done(bgw, result)
+    bgwrite_T	*bgw;
+    int		result;
+{
+    buf_T	*buf;
+    char	*errmsg;
+
+    buf = buflist_findnr(bgw->bgw_fnum);
+    if (buf != NULL)
+    {
+	buf->b_saving = bgwrite_busy(buf);
+	if (buf->b_ml.ml_mfp == NULL)	/* buffer was unloaded */
+	    buf = NULL;
+    }
+
+    if (result == BGW_OK)
+    {
+	/* Update the timestamp of the swap file and the buffer. */
+	if (buf != NULL)
+	    ml_timestamp(buf);
+	if (bgw->bgw_msg != NULL)
+	{
+	    set_keep_msg(msg_trunc_attr(bgw->bgw_msg, FALSE, 0));
+	    keep_msg_attr = 0;
+	}
+#ifdef FEAT_TAG_XREF
+	xref_written(bgw->bgw_fname);
+#endif
+    }
+    else
+    {
+	mch_remove(bgw->bgw_tmpname);
+
+	/* The file was not written, the buffer is changed again. */
+	if (buf != NULL && !buf->b_changed)
+	{
+	    buf->b_changed = TRUE;
+	    ml_setdirty(buf, TRUE);
+#ifdef FEAT_WINDOWS
+	    check_status(buf);
+#endif
+#ifdef FEAT_TITLE
+	    need_maketitle = TRUE;
+#endif
+	    ++buf->b_changedtick;
+	}
+
+	switch (result)
+	{
+	    case BGW_WRITE:  errmsg = _("write error (file system full?)");
+			     break;
+	    case BGW_FSYNC:  errmsg = _("fsync failed");
+			     break;
+	    case BGW_CLOSE:  errmsg = _("close failed");
+			     break;
+	    case BGW_RENAME: errmsg = _("cannot rename temp file");
+			     break;
+	    case BGW_UNKNOWN: errmsg = _("result of the write is unknown");
+			     break;
+	    default:	     errmsg = _("write was interrupted");
+			     break;
+	}
+	msg_add_fname(buf, bgw->bgw_fname);
+	if (STRLEN(IObuff) + STRLEN(errmsg) + 6 >= IOSIZE)
+	    IObuff[IOSIZE - STRLEN(errmsg) - 7] = NUL;
+	mch_memmove(IObuff + 6, IObuff, STRLEN(IObuff) + 1);
+	mch_memmove(IObuff, "E682: ", 6);
+	STRCAT(IObuff, errmsg);
+	emsg(IObuff);
+    }
+
+    vim_free(bgw->bgw_fname);
+    vim_free(bgw->bgw_tmpname);
+    vim_free(bgw->bgw_msg);
+    vim_free(bgw);
+}
+#endif
+
 /*
  * Put file name into IObuff with quotes.
  */
@@ -4562,6 +5133,10 @@ buf_write_bytes(ip)
 #ifdef HAS_BW_FLAGS
     int		flags = ip->bw_flags;	/* extra flags */
 #endif
+#ifdef UNIX
+    char_u	*s;
+    int		n;
+#endif
 
 #ifdef FEAT_MBYTE
     /*
@@ -4948,6 +5523,60 @@ buf_write_bytes(ip)
     }
 #endif
 
+#ifdef UNIX
+    if (ip->bw_ga != NULL)
+    {
+	/* Collect the text for a background write.  Grow by doubling, it may
+	 * become big.  The size must fit in an int. */
+	if (ip->bw_ga->ga_growsize < ip->bw_ga->ga_len
+				     && ip->bw_ga->ga_len < 0x10000000)
+	    ip->bw_ga->ga_growsize = ip->bw_ga->ga_len;
+	s = NULL;
+	if (ip->bw_ga->ga_room >= len && ip->bw_ga->ga_data != NULL)
+	    s = (char_u *)ip->bw_ga->ga_data;
+	else if (ip->bw_ga->ga_len <= 0x7fffffff - ip->bw_ga->ga_growsize - len)
+	{
+	    /* Like ga_grow(), but without an error message and without
+	     * clearing the memory. */
+	    n = ip->bw_ga->ga_growsize > len ? ip->bw_ga->ga_growsize : len;
+	    s = lalloc((long_u)(ip->bw_ga->ga_len + n), FALSE);
+	    if (s != NULL)
+	    {
+		if (ip->bw_ga->ga_data != NULL)
+		    mch_memmove(s, ip->bw_ga->ga_data,
+						  (size_t)ip->bw_ga->ga_len);
+		vim_free(ip->bw_ga->ga_data);
+		ip->bw_ga->ga_data = s;
+		ip->bw_ga->ga_room = n;
+	    }
+	}
+	if (s != NULL)
+	{
+	    mch_memmove((char_u *)ip->bw_ga->ga_data + ip->bw_ga->ga_len, buf,
+								 (size_t)len);
+	    ip->bw_ga->ga_len += len;
+	    ip->bw_ga->ga_room -= len;
+	    return OK;
+	}
+
+	/* The text doesn't fit in memory: write what was collected to the
+	 * temp file and continue writing directly.  buf_write() then finishes
+	 * the write without a child process. */
+	s = (char_u *)ip->bw_ga->ga_data;
+	n = ip->bw_ga->ga_len;
+	while (n > 0)
+	{
+	    wlen = vim_write(ip->bw_fd, s, n);
+	    if (wlen <= 0)
+		return FAIL;
+	    n -= wlen;
+	    s += wlen;
+	}
+	ga_clear(ip->bw_ga);
+	ip->bw_ga = NULL;
+    }
+#endif
+
     /* Repeat the write(), it may be interrupted by a signal. */
     while (len)
     {
@@ -4960,6 +5589,52 @@ buf_write_bytes(ip)
     return OK;
 }
 
+#ifdef HAVE_WRITEV
+/*
+ * Write the "ip->bw_len" bytes in "ip->bw_buf" followed by "len" bytes at
+ * "ptr", using one writev() call when possible.  Avoids copying "ptr" into
+ * the buffer.  Can only be used without conversion or encryption.
+ * Return FAIL for failure, OK otherwise.
+ */
+    static int
+buf_write_iov(ip, ptr, len)
+    struct bw_info *ip;
+    char_u	*ptr;
+    long	len;
+{
+    struct iovec    iov[2];
+    int		    i = 0;
+    long	    wlen;
+
+    iov[0].iov_base = (void *)ip->bw_buf;
+    iov[0].iov_len = (size_t)ip->bw_len;
+    iov[1].iov_base = (void *)ptr;
+    iov[1].iov_len = (size_t)len;
+    if (ip->bw_len == 0)
+	i = 1;
+
+    /* Repeat the writev(), it may be interrupted or write only part. */
+    while (i < 2)
+    {
+	wlen = (long)writev(ip->bw_fd, iov + i, 2 - i);
+	if (wlen <= 0)		    /* error! */
+	{
+	    if (wlen < 0 && errno == EINTR)
+		continue;
+	    return FAIL;
+	}
+	for ( ; i < 2 && wlen >= (long)iov[i].iov_len; ++i)
+	    wlen -= (long)iov[i].iov_len;
+	if (i < 2)
+	{
+	    iov[i].iov_base = (void *)((char *)iov[i].iov_base + wlen);
+	    iov[i].iov_len -= (size_t)wlen;
+	}
+    }
+    return OK;
+}
+#endif
+
 #ifdef FEAT_MBYTE
 /*
  * Convert a Unicode character to bytes.
@@ -6648,12 +7323,23 @@ typedef struct AutoPat
 					   has been removed) */
     int		    patlen;		/* strlen() of pat */
     char_u	    *reg_pat;		/* pattern converted to regexp */
+    regprog_T	    *reg_prog;		/* compiled regexp program or NULL */
+    int		    litlen;		/* nr of literal chars at end of pat */
+    char	    lit_only;		/* AP_LIT_ values */
     char	    allow_dirs;		/* Pattern may match whole path */
     char	    last;		/* last pattern for apply_autocmds() */
     AutoCmd	    *cmds;		/* list of commands to do */
     struct AutoPat  *next;		/* next AutoPat in AutoPat list */
 } AutoPat;
 
+/*
+ * Values for "lit_only": whether the pattern can be matched by only comparing
+ * the literal text at its end, without the regexp.
+ */
+#define AP_LIT_NO	0	/* need to use the regexp */
+#define AP_LIT_SUFFIX	1	/* "*text": name must end in "text" */
+#define AP_LIT_EXACT	2	/* "text": name must be "text" */
+
 static struct event_name
 {
     char	*name;	/* event name */
@@ -6763,6 +7449,9 @@ static int au_need_clean = FALSE;   /* need to delete marked patterns */
 
 static void show_autocmd __ARGS((AutoPat *ap, EVENT_T event));
 static void au_remove_pat __ARGS((AutoPat *ap));
+static void au_set_literal __ARGS((AutoPat *ap));
+static int au_lit_match __ARGS((AutoPat *ap, char_u *name));
+static int au_match_pat __ARGS((AutoPat *ap, char_u *fname, char_u *sfname, char_u *tail));
 static void au_remove_cmds __ARGS((AutoPat *ap));
 static void au_cleanup __ARGS((void));
 static int au_new_group __ARGS((char_u *name));
@@ -6855,6 +7544,106 @@ au_remove_pat(ap)
     au_need_clean = TRUE;
 }
 
+/*
+ * Find the literal text at the end of the pattern of "ap", e.g., ".c" for
+ * "*.c".  A file name can only match when it ends in this text, which is
+ * much quicker to check than executing the regexp.  When the pattern is only
+ * this text, possibly after a "*", the regexp isn't needed at all.
+ */
+    static void
+au_set_literal(ap)
+    AutoPat	*ap;
+{
+    char_u	*p = ap->pat;
+    int		len = ap->patlen;
+    int		i;
+
+    ap->litlen = 0;
+    ap->lit_only = AP_LIT_NO;
+#ifdef FEAT_OSFILETYPE
+    if (*p == '<')
+	return;
+#endif
+    /* Only use characters that stand for themselves in the regexp. */
+    while (ap->litlen < len)
+    {
+	i = p[len - ap->litlen - 1];
+	if (i >= 0x80 || !(isalnum(i) || vim_strchr((char_u *)"_-+=@%:~"
+#ifndef BACKSLASH_IN_FILENAME
+		    "/"
+#endif
+#ifndef RISCOS
+		    "."
+#endif
+		    , i) != NULL))
+	    break;
+	++ap->litlen;
+    }
+
+    if (ap->litlen == len)
+	ap->lit_only = AP_LIT_EXACT;
+    else if (p[len - ap->litlen - 1] == '\\')
+    {
+	/* "\+" is not a literal '+', don't use the escaped character */
+	if (ap->litlen > 0)
+	    --ap->litlen;
+    }
+    else
+    {
+	for (i = 0; p[i] == '*'; ++i)
+	    ;
+	if (i == len - ap->litlen)
+	    ap->lit_only = AP_LIT_SUFFIX;
+    }
+}
+
+/*
+ * Return TRUE if file name "name" ends in the literal text of the pattern of
+ * "ap".  For AP_LIT_EXACT it must be equal.
+ */
+    static int
+au_lit_match(ap, name)
+    AutoPat	*ap;
+    char_u	*name;
+{
+    int		len = (int)STRLEN(name);
+
+    if (len < ap->litlen || (ap->lit_only == AP_LIT_EXACT
+							&& len != ap->litlen))
+	return FALSE;
+    return fnamencmp(name + len - ap->litlen, ap->pat + ap->patlen
+					      - ap->litlen, ap->litlen) == 0;
+}
+
+/*
+ * Return TRUE if the pattern of "ap" matches the file name.
+ * Arguments are like for match_file_pat().
+ */
+    static int
+au_match_pat(ap, fname, sfname, tail)
+    AutoPat	*ap;
+    char_u	*fname;
+    char_u	*sfname;
+    char_u	*tail;
+{
+    int		found;
+
+    if (ap->litlen > 0 || ap->lit_only != AP_LIT_NO)
+    {
+	/* A matching name must end in the literal text, the regexp is
+	 * anchored at the end. */
+	if (ap->allow_dirs)
+	    found = au_lit_match(ap, fname)
+			     || (sfname != NULL && au_lit_match(ap, sfname));
+	else
+	    found = au_lit_match(ap, tail);
+	if (!found || ap->lit_only != AP_LIT_NO)
+	    return found;
+    }
+    return match_file_pat(ap->reg_pat, &ap->reg_prog, fname, sfname, tail,
+							      ap->allow_dirs);
+}
+
 /*
  * Mark all commands for a pattern for deletion.
  */
@@ -6915,6 +7704,7 @@ au_cleanup()
 	    {
 		*prev_ap = ap->next;
 		vim_free(ap->reg_pat);
+		vim_free(ap->reg_prog);
 		vim_free(ap);
 	    }
 	    else
@@ -7476,6 +8266,9 @@ do_autocmd_event(event, pat, nested, cmd, forceit, group)
 		    vim_free(ap);
 		    return FAIL;
 		}
+		/* The regexp is compiled when first used. */
+		ap->reg_prog = NULL;
+		au_set_literal(ap);
 		ap->cmds = NULL;
 		*prev_ap = ap;
 		ap->next = NULL;
@@ -7837,6 +8630,10 @@ apply_autocmds_group(event, fname, fname_io, force, group, buf, eap)
     long	save_cmdbang;
 #endif
     static int	filechangeshell_busy = FALSE;
+#ifdef FEAT_STARTUPTIME
+    struct timeval	tv_rel;
+    struct timeval	tv_start;
+#endif
 
     /*
      * Quickly return if there are no autocommands for this event or
@@ -8063,8 +8860,26 @@ apply_autocmds_group(event, fname, fname_io, force, group, buf, eap)
 	    ap->last = FALSE;
 	ap->last = TRUE;
 	check_lnums(TRUE);	/* make sure cursor and topline are valid */
+#ifdef FEAT_STARTUPTIME
+	if (time_fd != NULL)
+	    time_push(&tv_rel, &tv_start);
+#endif
 	do_cmdline(NULL, getnextac, (void *)&patcmd,
 				     DOCMD_NOWAIT|DOCMD_VERBOSE|DOCMD_REPEAT);
+#ifdef FEAT_STARTUPTIME
+	if (time_fd != NULL)
+	{
+	    char_u	*name = event_nr2name(event);
+
+	    /* "Event fname", truncated to fit in IObuff */
+	    STRNCPY(IObuff, name, IOSIZE - 2);
+	    IObuff[IOSIZE - 2] = NUL;
+	    STRCAT(IObuff, " ");
+	    STRNCAT(IObuff, fname, IOSIZE - 1 - STRLEN(IObuff));
+	    time_msg("autocmd", (char *)IObuff, &tv_start);
+	    time_pop(&tv_rel);
+	}
+#endif
 #ifdef FEAT_EVAL
 	if (eap != NULL)
 	{
@@ -8150,8 +8965,7 @@ auto_next_pat(apc, stop_at_last)
 	if (ap->pat != NULL && ap->cmds != NULL
 		&& (apc->group == AUGROUP_ALL || apc->group == ap->group))
 	{
-	    if (match_file_pat(ap->reg_pat, apc->fname, apc->sfname, apc->tail,
-							      ap->allow_dirs))
+	    if (au_match_pat(ap, apc->fname, apc->sfname, apc->tail))
 	    {
 		name = event_nr2name(apc->event);
 		s = _("%s Auto commands for \"%s\"");
@@ -8276,8 +9090,7 @@ has_autocmd(event, sfname)
 
     for (ap = first_autopat[(int)event]; ap != NULL; ap = ap->next)
 	if (ap->pat != NULL && ap->cmds != NULL
-		&& match_file_pat(ap->reg_pat, fname, sfname, tail,
-							      ap->allow_dirs))
+		&& au_match_pat(ap, fname, sfname, tail))
 	{
 	    retval = TRUE;
 	    break;
@@ -8432,11 +9245,14 @@ au_exists(name, name_end, pattern)
 /*
  * Try matching a filename with a pattern.
  * Used for autocommands and 'wildignore'.
+ * When "prog" is not NULL the compiled regexp is kept in "*prog" and used the
+ * next time, the caller must free it.
  * Returns TRUE if there is a match, FALSE otherwise.
  */
     int
-match_file_pat(pattern, fname, sfname, tail, allow_dirs)
+match_file_pat(pattern, prog, fname, sfname, tail, allow_dirs)
     char_u	*pattern;		/* pattern to match with */
+    regprog_T	**prog;			/* compiled pattern or NULL */
     char_u	*fname;			/* full path of file name */
     char_u	*sfname;		/* short file name or NULL */
     char_u	*tail;			/* tail of path */
@@ -8488,9 +9304,14 @@ match_file_pat(pattern, fname, sfname, tail, allow_dirs)
 	}
 	else
 	    regmatch.regprog = vim_regcomp(pattern + 1, RE_MAGIC);
+	/* The filetype check must be done each time. */
+	prog = NULL;
     }
     else
 #endif
+    if (prog != NULL && *prog != NULL)
+	regmatch.regprog = *prog;
+    else
 	regmatch.regprog = vim_regcomp(pattern, RE_MAGIC);
 
     /*
@@ -8514,7 +9335,10 @@ match_file_pat(pattern, fname, sfname, tail, allow_dirs)
 		 || (!allow_dirs && vim_regexec(&regmatch, tail, (colnr_T)0)))))
 	result = TRUE;
 
-    vim_free(regmatch.regprog);
+    if (prog != NULL)
+	*prog = regmatch.regprog;
+    else
+	vim_free(regmatch.regprog);
     return result;
 }
 #endif
@@ -8548,7 +9372,8 @@ match_file_list(list, sfname, ffname)
 	regpat = file_pat_to_reg_pat(buf, NULL, &allow_dirs, FALSE);
 	if (regpat == NULL)
 	    break;
-	match = match_file_pat(regpat, ffname, sfname, tail, (int)allow_dirs);
+	match = match_file_pat(regpat, NULL, ffname, sfname, tail,
+							    (int)allow_dirs);
 	vim_free(regpat);
 	if (match)
 	    return TRUE;
@@ -71,6 +71,52 @@ static int	block_redo = FALSE;
 static mapblock_T	*(maphash[256]);
 static int		maphash_valid = FALSE;
 
+/*
+ * To find the mappings that match the typed keys, the entries of a maphash[]
+ * list are put in a trie on the bytes of "m_keys".  Following the typed keys
+ * down the trie gives the full and partial matches, without comparing with
+ * every mapping that starts with the same key.  A trie is built when the
+ * list is first used and built again after "map_tick" changed.
+ * Items are kept in growarrays and refer to each other by index.
+ */
+typedef struct
+{
+    int		mn_next;	/* next node with the same parent, 0 if none */
+    int		mn_child;	/* first node for the next key, 0 if none */
+    int		mn_end;		/* first mapping ending here, -1 if none */
+    int		mn_modes;	/* m_mode of all mappings in the subtree */
+    int		mn_nolmodes;	/* idem, without ":lmap" mappings */
+    char_u	mn_byte;	/* the key for this node */
+} mapnode_T;
+
+typedef struct
+{
+    mapblock_T	*me_mp;		/* mapping with the keys of the node */
+    int		me_next;	/* next one for the same node, -1 if none */
+} mapend_T;
+
+typedef struct
+{
+    int		mt_tick;	/* "map_tick" when the trie was built */
+    garray_T	mt_nodes;	/* mapnode_T items, the first is the root */
+    garray_T	mt_ends;	/* mapend_T items */
+} maptrie_T;
+
+#define MT_NODE(mt, idx) (((mapnode_T *)(mt)->mt_nodes.ga_data)[idx])
+#define MT_END(mt, idx)	(((mapend_T *)(mt)->mt_ends.ga_data)[idx])
+
+/* Modes of the mappings in the subtree of node "np" that can be used now,
+ * ":lmap" mappings are not used for keys that were mapped. */
+#define MT_MODES(np)	(typebuf.tb_maplen == 0 ? (np)->mn_modes \
+							: (np)->mn_nolmodes)
+
+static int		map_tick = 0;	/* incremented when mappings change */
+static maptrie_T	*(maptrie[256]);    /* trie for each maphash[] list */
+#ifdef FEAT_LOCALMAP
+static maptrie_T	*(b_maptrie[256]);  /* idem for b_maphash[] */
+static int		b_maptrie_fnum = 0; /* buffer used for b_maptrie[] */
+#endif
+
 /*
  * List used for abbreviations.
  */
@@ -127,6 +173,12 @@ static void	closescript __ARGS((void));
 static int	vgetorpeek __ARGS((int));
 static void	map_free __ARGS((mapblock_T **));
 static void	validate_maphash __ARGS((void));
+static int	map_trie_match __ARGS((int c1, int local_State, int timedout, mapblock_T **mp_part, mapblock_T **mp_match, int *mp_match_len, int *max_mlen));
+static maptrie_T *map_trie_get __ARGS((maptrie_T **mtp, mapblock_T *list));
+static int	map_trie_add __ARGS((maptrie_T *mt, mapblock_T *mp));
+static void	map_trie_free __ARGS((maptrie_T **mtp));
+static mapblock_T *map_trie_find __ARGS((maptrie_T *mt, int c1, int local_State, int timedout, mapblock_T **mp_match, int *mp_match_len, int *max_mlen));
+static mapblock_T *map_trie_first __ARGS((maptrie_T *mt, int idx, int depth, int local_State, int script));
 static void	showmap __ARGS((mapblock_T *mp, int local));
 
 /*
@@ -923,6 +975,7 @@ ins_typebuf(str, noremap, offset, nottyped, silent)
     int		addlen;
     int		i;
     int		newoff;
+    int		extra;
     int		val;
     int		nrm;
 
@@ -939,16 +992,38 @@ ins_typebuf(str, noremap, offset, nottyped, silent)
 	typebuf.tb_off -= addlen;
 	mch_memmove(typebuf.tb_buf + typebuf.tb_off, str, (size_t)addlen);
     }
+    /*
+     * Inserting after the first half and there is room at the end: move the
+     * characters after the insertion point.
+     */
+    else if (offset > 0 && typebuf.tb_len - offset <= offset
+	    && typebuf.tb_buflen - typebuf.tb_off - typebuf.tb_len
+						 > addlen + 3 * MAXMAPLEN + 3)
+    {
+	i = typebuf.tb_off + offset;
+	mch_memmove(typebuf.tb_buf + i + addlen, typebuf.tb_buf + i,
+				       (size_t)(typebuf.tb_len - offset + 1));
+	mch_memmove(typebuf.tb_buf + i, str, (size_t)addlen);
+	mch_memmove(typebuf.tb_noremap + i + addlen, typebuf.tb_noremap + i,
+					   (size_t)(typebuf.tb_len - offset));
+    }
     /*
      * Need to allocate new buffer.
      * In typebuf.tb_buf there must always be room for 3 * MAXMAPLEN + 4
      * characters.  We add some extra room to avoid having to allocate too
-     * often.
+     * often.  The extra room grows with the buffer size and is put where the
+     * insertion is done, so that executing a register with many lines, which
+     * inserts each line in front, doesn't copy the whole buffer every time.
      */
     else
     {
+	extra = typebuf.tb_len + addlen;
 	newoff = MAXMAPLEN + 4;
+	if (offset == 0)
+	    newoff += extra;
 	newlen = typebuf.tb_len + addlen + newoff + 4 * (MAXMAPLEN + 4);
+	if (offset > 0)
+	    newlen += extra;
 	if (newlen < 0)		    /* string is getting too long */
 	{
 	    EMSG(_(e_toocompl));    /* also calls flush_buffers */
@@ -1089,11 +1164,21 @@ del_typebuf(len, offset)
     typebuf.tb_len -= len;
 
     /*
-     * Easy case: Just increase typebuf.tb_off.
+     * Easy case: Just increase typebuf.tb_off.  When deleting in the first
+     * half, move the characters before the deleted ones, there are fewer.
      */
-    if (offset == 0 && typebuf.tb_buflen - (typebuf.tb_off + len)
-							 >= 3 * MAXMAPLEN + 3)
+    if (offset <= typebuf.tb_len - offset
+	    && typebuf.tb_buflen - (typebuf.tb_off + len) >= 3 * MAXMAPLEN + 3)
+    {
+	if (offset > 0)
+	{
+	    mch_memmove(typebuf.tb_buf + typebuf.tb_off + len,
+			     typebuf.tb_buf + typebuf.tb_off, (size_t)offset);
+	    mch_memmove(typebuf.tb_noremap + typebuf.tb_off + len,
+			 typebuf.tb_noremap + typebuf.tb_off, (size_t)offset);
+	}
 	typebuf.tb_off += len;
+    }
     /*
      * Have to move the characters in typebuf.tb_buf[] and typebuf.tb_noremap[]
      */
@@ -1494,6 +1579,15 @@ vgetc()
 	    }
 	    c = TO_SPECIAL(c2, c);
 
+	    /* A bracketed paste where the caller doesn't handle it, e.g., for
+	     * "r" or at a prompt: drop the pasted text, so that it isn't
+	     * executed as commands. */
+	    if (c == K_PS && !allow_paste)
+	    {
+		(void)get_bracketed_paste(NULL);
+		c = K_IGNORE;
+	    }
+
 #if defined(FEAT_GUI_W32) && defined(FEAT_MENU) && defined(FEAT_TEAROFF)
 	    /* Handle K_TEAROFF here, the caller of vgetc() doesn't need to
 	     * know that a menu was torn off */
@@ -1679,6 +1773,113 @@ vungetc(c)	/* unget one character (can only be done once!) */
     old_mod_mask = mod_mask;
 }
 
+/*
+ * Get the text of a bracketed paste, after the t_PS code was received: the
+ * characters up to the t_PE code.  They are taken from the typeahead buffer a
+ * block at a time, without mapping and without recognizing terminal codes.
+ * The text is appended to "gap", when "gap" is NULL it is dropped.
+ * Returns FAIL when interrupted or out of memory.
+ */
+    int
+get_bracketed_paste(gap)
+    garray_T	*gap;
+{
+    garray_T	drop_ga;
+    char_u	*end = find_termcode((char_u *)"PE");
+    int		endlen = (end == NULL) ? 0 : (int)STRLEN(end);
+    int		start_len;
+    char_u	*p;
+    int		len;
+    int		c, c2;
+    int		n;
+    int		done = FALSE;
+    int		retval = OK;
+
+    if (gap == NULL)
+    {
+	ga_init2(&drop_ga, 1, 1000);
+	gap = &drop_ga;
+    }
+    start_len = gap->ga_len;
+
+    while (!done)
+    {
+	if (typebuf.tb_len == 0)
+	{
+	    /* Wait for more characters, there are always at least
+	     * 3 * MAXMAPLEN + 3 bytes available at typebuf.tb_off. */
+	    init_typebuf();
+	    n = inchar(typebuf.tb_buf + typebuf.tb_off,
+			     typebuf.tb_buflen - typebuf.tb_off - 1, -1L,
+						       typebuf.tb_change_cnt);
+	    if (got_int || n < 0)
+	    {
+		retval = FAIL;
+		break;
+	    }
+	    while (typebuf.tb_buf[typebuf.tb_off + typebuf.tb_len] != NUL)
+		typebuf.tb_noremap[typebuf.tb_off + typebuf.tb_len++] = RM_YES;
+	    continue;
+	}
+
+	/* The text only gets shorter by removing the K_SPECIAL escapes. */
+	if (ga_grow(gap, typebuf.tb_len) == FAIL)
+	{
+	    retval = FAIL;
+	    break;
+	}
+	p = typebuf.tb_buf + typebuf.tb_off;
+	for (len = 0; len < typebuf.tb_len; )
+	{
+	    c = p[len++];
+	    if ((c == K_SPECIAL
+#ifdef FEAT_GUI
+			|| c == CSI
+#endif
+		 ) && len + 2 <= typebuf.tb_len)
+	    {
+		c2 = TO_SPECIAL(p[len], p[len + 1]);
+		len += 2;
+		if (c2 == K_SPECIAL)
+		    c = K_SPECIAL;
+		else if (c2 == K_ZERO)
+		    c = NUL;
+		else if (c2 == K_CSI)
+		    c = CSI;
+		else
+		{
+		    /* t_PE may have been recognized anyway, other keys are
+		     * ignored */
+		    if (c2 == K_PE)
+		    {
+			done = TRUE;
+			break;
+		    }
+		    continue;
+		}
+	    }
+	    ((char_u *)gap->ga_data)[gap->ga_len++] = c;
+	    --gap->ga_room;
+	    if (endlen > 0 && c == end[endlen - 1]
+		    && gap->ga_len - start_len >= endlen
+		    && STRNCMP((char_u *)gap->ga_data + gap->ga_len - endlen,
+							   end, endlen) == 0)
+	    {
+		gap->ga_len -= endlen;
+		gap->ga_room += endlen;
+		done = TRUE;
+		break;
+	    }
+	}
+	gotchars(p, len);
+	del_typebuf(len, 0);
+    }
+
+    if (gap == &drop_ga)
+	ga_clear(&drop_ga);
+    return retval;
+}
+
 /*
  * get a character:
  * 1. from the stuffbuffer
@@ -1714,6 +1915,7 @@ vgetorpeek(advance)
     mapblock_T	*mp2;
 #endif
     mapblock_T	*mp_match;
+    mapblock_T	*mp_part;
     int		mp_match_len = 0;
     int		timedout = FALSE;	    /* waited for more than 1 second
 						for mapping to complete */
@@ -1897,6 +2099,22 @@ vgetorpeek(advance)
 #else
 			mp = maphash[MAP_HASH(local_State, c1)];
 #endif
+			mp_match = NULL;
+			mp_match_len = 0;
+			mp_part = NULL;
+
+			/* Mostly the matches can be found with a trie, then
+			 * the loop below isn't needed. */
+			if (mp != NULL && map_trie_match(c1, local_State,
+				    timedout, &mp_part, &mp_match,
+					       &mp_match_len, &max_mlen) == OK)
+			{
+			    mp = NULL;
+#ifdef FEAT_LOCALMAP
+			    mp2 = NULL;
+#endif
+			}
+
 			/*
 			 * Loop until a partly matching mapping is found or
 			 * all (local) mappings have been checked.
@@ -1904,8 +2122,6 @@ vgetorpeek(advance)
 			 * A full match is only accepted if there is no partly
 			 * match, so "aa" and "aaa" can both be mapped.
 			 */
-			mp_match = NULL;
-			mp_match_len = 0;
 			for ( ; mp != NULL;
 #ifdef FEAT_LOCALMAP
 				mp->m_next == NULL ? (mp = mp2, mp2 = NULL) :
@@ -2009,6 +2225,13 @@ vgetorpeek(advance)
 			    }
 			}
 
+			if (mp_part != NULL)
+			{
+			    /* partly match found in a trie */
+			    mp = mp_part;
+			    keylen = KL_PART_MAP;
+			}
+
 			/* If no partly match found, use the longest full
 			 * match. */
 			if (keylen != KL_PART_MAP)
@@ -2723,7 +2946,16 @@ inchar(buf, maxlen, wait_time, tb_change_cnt)
 	 * Fill up to a third of the buffer, because each character may be
 	 * tripled below.
 	 */
+#ifdef FEAT_PROFILE
+	/* Time spent waiting for the user is not counted. */
+	if (do_profiling == PROF_YES && wait_time != 0)
+	    prof_inchar_enter();
+#endif
 	len = ui_inchar(buf, maxlen / 3, wait_time, tb_change_cnt);
+#ifdef FEAT_PROFILE
+	if (do_profiling == PROF_YES && wait_time != 0)
+	    prof_inchar_exit();
+#endif
     }
 
     if (typebuf_changed(tb_change_cnt))
@@ -3348,6 +3580,7 @@ do_map(maptype, arg, mode, abbrev)
     }
 
 theend:
+    ++map_tick;			/* mapping tries must be built again */
     vim_free(keys_buf);
     vim_free(arg_buf);
     return retval;
@@ -3383,6 +3616,341 @@ validate_maphash()
     }
 }
 
+/*
+ * Find the mappings that match the keys in typebuf with the tries for the
+ * maphash[] lists, instead of the loop in vgetorpeek().  The result is the
+ * same: the first partly matching mapping in "*mp_part" when "timedout" is
+ * FALSE, the longest full match in "*mp_match" and "*mp_match_len", and
+ * "*max_mlen" for the longest match of a mapping that doesn't match.
+ * "c1" is the first typed key, after applying 'langmap'.
+ * Returns FAIL when the loop must be used.
+ */
+    static int
+map_trie_match(c1, local_State, timedout, mp_part, mp_match, mp_match_len,
+								    max_mlen)
+    int		c1;
+    int		local_State;
+    int		timedout;
+    mapblock_T	**mp_part;
+    mapblock_T	**mp_match;
+    int		*mp_match_len;
+    int		*max_mlen;
+{
+    int		hash = MAP_HASH(local_State, c1);
+    maptrie_T	*mt;
+#ifdef FEAT_LOCALMAP
+    int		i;
+#endif
+
+#ifdef FEAT_MBYTE
+    /* The check for mapping the first byte(s) of a multi-byte character is
+     * only done in the loop. */
+    if (has_mbyte && MB_BYTE2LEN(c1) > 1)
+	return FAIL;
+#endif
+
+#ifdef FEAT_LOCALMAP
+    /* First try buffer-local mappings. */
+    if (curbuf->b_maphash[hash] != NULL)
+    {
+	if (b_maptrie_fnum != curbuf->b_fnum)
+	{
+	    for (i = 0; i < 256; ++i)
+		map_trie_free(&b_maptrie[i]);
+	    b_maptrie_fnum = curbuf->b_fnum;
+	}
+	mt = map_trie_get(&b_maptrie[hash], curbuf->b_maphash[hash]);
+	if (mt == NULL)
+	    return FAIL;
+	*mp_part = map_trie_find(mt, c1, local_State, timedout,
+					     mp_match, mp_match_len, max_mlen);
+	if (*mp_part != NULL)
+	    return OK;
+    }
+#endif
+    if (maphash[hash] != NULL)
+    {
+	mt = map_trie_get(&maptrie[hash], maphash[hash]);
+	if (mt == NULL)
+	    return FAIL;
+	*mp_part = map_trie_find(mt, c1, local_State, timedout,
+					     mp_match, mp_match_len, max_mlen);
+    }
+    return OK;
+}
+
+/*
+ * Get the trie for maphash[] list "list", build it when needed.
+ * "*mtp" is where the trie is remembered.
+ * Returns NULL when out of memory.
+ */
+    static maptrie_T *
+map_trie_get(mtp, list)
+    maptrie_T	**mtp;
+    mapblock_T	*list;
+{
+    maptrie_T	*mt = *mtp;
+    mapblock_T	*mp;
+
+    if (mt != NULL && mt->mt_tick == map_tick)
+	return mt;
+    map_trie_free(mtp);
+
+    mt = (maptrie_T *)alloc((unsigned)sizeof(maptrie_T));
+    if (mt == NULL)
+	return NULL;
+    mt->mt_tick = map_tick;
+    ga_init2(&mt->mt_nodes, (int)sizeof(mapnode_T), 50);
+    ga_init2(&mt->mt_ends, (int)sizeof(mapend_T), 20);
+    *mtp = mt;
+
+    /* The root node. */
+    if (ga_grow(&mt->mt_nodes, 1) == FAIL)
+    {
+	map_trie_free(mtp);
+	return NULL;
+    }
+    vim_memset(&MT_NODE(mt, 0), 0, sizeof(mapnode_T));
+    MT_NODE(mt, 0).mn_end = -1;
+    ++mt->mt_nodes.ga_len;
+    --mt->mt_nodes.ga_room;
+
+    for (mp = list; mp != NULL; mp = mp->m_next)
+	if (map_trie_add(mt, mp) == FAIL)
+	{
+	    map_trie_free(mtp);
+	    return NULL;
+	}
+    return mt;
+}
+
+/*
+ * Add mapping "mp" to trie "mt", after the mappings that were added before.
+ * Returns FAIL when out of memory.
+ */
+    static int
+map_trie_add(mt, mp)
+    maptrie_T	*mt;
+    mapblock_T	*mp;
+{
+    mapnode_T	*np;
+    int		idx = 0;
+    int		i;
+    int		e;
+    int		k;
+
+    for (k = 0; ; ++k)
+    {
+	np = &MT_NODE(mt, idx);
+	np->mn_modes |= mp->m_mode;
+	if ((mp->m_mode & LANGMAP) == 0)
+	    np->mn_nolmodes |= mp->m_mode;
+	if (k == mp->m_keylen)
+	    break;
+
+	for (i = np->mn_child; i != 0; i = MT_NODE(mt, i).mn_next)
+	    if (MT_NODE(mt, i).mn_byte == mp->m_keys[k])
+		break;
+	if (i == 0)
+	{
+	    /* Add a node for this key. */
+	    if (ga_grow(&mt->mt_nodes, 1) == FAIL)
+		return FAIL;
+	    i = mt->mt_nodes.ga_len++;
+	    --mt->mt_nodes.ga_room;
+	    np = &MT_NODE(mt, i);
+	    np->mn_byte = mp->m_keys[k];
+	    np->mn_child = 0;
+	    np->mn_end = -1;
+	    np->mn_modes = 0;
+	    np->mn_nolmodes = 0;
+	    np->mn_next = MT_NODE(mt, idx).mn_child;
+	    MT_NODE(mt, idx).mn_child = i;
+	}
+	idx = i;
+    }
+
+    /* Append to the mappings for this node, so that the order of the list is
+     * kept. */
+    if (ga_grow(&mt->mt_ends, 1) == FAIL)
+	return FAIL;
+    e = mt->mt_ends.ga_len++;
+    --mt->mt_ends.ga_room;
+    MT_END(mt, e).me_mp = mp;
+    MT_END(mt, e).me_next = -1;
+    np = &MT_NODE(mt, idx);
+    if (np->mn_end < 0)
+	np->mn_end = e;
+    else
+    {
+	for (i = np->mn_end; MT_END(mt, i).me_next >= 0;
+						  i = MT_END(mt, i).me_next)
+	    ;
+	MT_END(mt, i).me_next = e;
+    }
+    return OK;
+}
+
+/*
+ * Free the trie "*mtp" and set it to NULL.
+ */
+    static void
+map_trie_free(mtp)
+    maptrie_T	**mtp;
+{
+    if (*mtp != NULL)
+    {
+	ga_clear(&(*mtp)->mt_nodes);
+	ga_clear(&(*mtp)->mt_ends);
+	vim_free(*mtp);
+	*mtp = NULL;
+    }
+}
+
+/*
+ * Follow the keys in typebuf down trie "mt".  See map_trie_match() for the
+ * arguments.
+ * Returns a partly matching mapping, NULL if there is none.
+ */
+    static mapblock_T *
+map_trie_find(mt, c1, local_State, timedout, mp_match, mp_match_len,
+								    max_mlen)
+    maptrie_T	*mt;
+    int		c1;
+    int		local_State;
+    int		timedout;
+    mapblock_T	**mp_match;
+    int		*mp_match_len;
+    int		*max_mlen;
+{
+    static char_u snr[3] = {K_SPECIAL, KS_EXTRA, (int)KE_SNR};
+    mapnode_T	*np;
+    mapblock_T	*mp;
+    char_u	*s = typebuf.tb_noremap + typebuf.tb_off;
+    int		script = (*s == RM_SCRIPT);
+    int		snr_path = TRUE;    /* keys so far are the start of <SNR> */
+    int		can_remap = TRUE;   /* the keys so far may be remapped */
+    int		mlen;
+    int		c = c1;
+    int		idx = 0;
+    int		i;
+#ifdef FEAT_LANGMAP
+    int		nomap = (c1 == K_SPECIAL) ? 2 : 0;
+#endif
+
+    for (mlen = 1; ; ++mlen)
+    {
+	/* Only look at the noremap flags of the keys that are used, the
+	 * typeahead may be very long. */
+	if (s[mlen - 1] & (RM_NONE|RM_ABBR))
+	    can_remap = FALSE;
+
+	/* "idx" is the node for the first "mlen - 1" keys, "c" is the next
+	 * key.  Find the node for it. */
+	np = &MT_NODE(mt, idx);
+	for (i = np->mn_child; i != 0; i = MT_NODE(mt, i).mn_next)
+	    if (MT_NODE(mt, i).mn_byte == c)
+		break;
+
+	/* The mappings in the other subtrees match "mlen - 1" keys. */
+	if (mlen > 1 && *max_mlen < mlen - 1)
+	{
+	    int		j;
+
+	    for (j = np->mn_child; j != 0; j = MT_NODE(mt, j).mn_next)
+		if (j != i && (MT_MODES(&MT_NODE(mt, j)) & local_State))
+		{
+		    *max_mlen = mlen - 1;
+		    break;
+		}
+	}
+	if (i == 0)
+	    break;
+	idx = i;
+	np = &MT_NODE(mt, idx);
+	if (mlen <= 3 && c != snr[mlen - 1])
+	    snr_path = FALSE;
+
+	/* The mappings ending here match fully. */
+	if (can_remap && mlen > *mp_match_len)
+	    for (i = np->mn_end; i >= 0; i = MT_END(mt, i).me_next)
+	    {
+		mp = MT_END(mt, i).me_mp;
+		if ((mp->m_mode & local_State)
+			&& ((mp->m_mode & LANGMAP) == 0
+			    || typebuf.tb_maplen == 0)
+			&& (!script || (mlen >= 3 && snr_path)))
+		{
+		    *mp_match = mp;
+		    *mp_match_len = mlen;
+		    break;
+		}
+	    }
+
+	if (mlen == typebuf.tb_len)
+	{
+	    /* The mappings below this node match partly. */
+	    if (!timedout && can_remap && (!script || snr_path))
+		for (i = np->mn_child; i != 0; i = MT_NODE(mt, i).mn_next)
+		{
+		    mp = map_trie_first(mt, i, mlen + 1, local_State, script);
+		    if (mp != NULL)
+			return mp;
+		}
+	    break;
+	}
+
+	/* Get the next typed key. */
+	c = typebuf.tb_buf[typebuf.tb_off + mlen];
+#ifdef FEAT_LANGMAP
+	if (nomap > 0)
+	    --nomap;
+	else if (c == K_SPECIAL)
+	    nomap = 2;
+	else
+	    LANGMAP_ADJUST(c, TRUE);
+#endif
+    }
+    return NULL;
+}
+
+/*
+ * Return the first mapping in the subtree of node "idx" that can be used in
+ * "local_State".  "depth" is the number of keys for the node.  When "script"
+ * is TRUE the mapping must start with <SNR>.
+ */
+    static mapblock_T *
+map_trie_first(mt, idx, depth, local_State, script)
+    maptrie_T	*mt;
+    int		idx;
+    int		depth;
+    int		local_State;
+    int		script;
+{
+    static char_u snr[3] = {K_SPECIAL, KS_EXTRA, (int)KE_SNR};
+    mapnode_T	*np = &MT_NODE(mt, idx);
+    mapblock_T	*mp;
+    int		i;
+
+    if ((MT_MODES(np) & local_State) == 0
+			    || (script && depth <= 3 && np->mn_byte != snr[depth - 1]))
+	return NULL;
+    for (i = np->mn_end; i >= 0; i = MT_END(mt, i).me_next)
+    {
+	mp = MT_END(mt, i).me_mp;
+	if ((mp->m_mode & local_State)
+		&& ((mp->m_mode & LANGMAP) == 0 || typebuf.tb_maplen == 0))
+	    return mp;
+    }
+    for (i = np->mn_child; i != 0; i = MT_NODE(mt, i).mn_next)
+    {
+	mp = map_trie_first(mt, i, depth + 1, local_State, script);
+	if (mp != NULL)
+	    return mp;
+    }
+    return NULL;
+}
+
 /*
  * Get the mapping mode from the command name.
  */
@@ -3472,6 +4040,7 @@ map_clear_int(buf, mode, local, abbr)
     int		new_hash;
 
     validate_maphash();
+    ++map_tick;			/* mapping tries must be built again */
 
     for (hash = 0; hash < 256; ++hash)
     {
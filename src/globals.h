@@ -201,6 +201,9 @@ EXTERN int	ex_nesting_level INIT(= 0);	/* nesting level */
 EXTERN int	debug_break_level INIT(= -1);	/* break below this level */
 EXTERN int	debug_did_msg INIT(= FALSE);	/* did "debug mode" message */
 EXTERN int	debug_tick INIT(= 0);		/* breakpoint change count */
+# ifdef FEAT_PROFILE
+EXTERN int	do_profiling INIT(= PROF_NONE);	/* PROF_ values */
+# endif
 
 /*
  * The exception currently being thrown.  Used to pass an exception to
@@ -395,6 +398,12 @@ EXTERN int	sys_menu INIT(= FALSE);
  * ('lines' and 'rows') must not be changed. */
 EXTERN int	updating_screen INIT(= FALSE);
 
+/* Counters for output written to the terminal, for ":screenstats". */
+EXTERN long	out_bytes INIT(= 0);	    /* nr of bytes written */
+EXTERN long	out_writes INIT(= 0);	    /* nr of calls to ui_write() */
+EXTERN long	out_frame_bytes INIT(= 0);  /* bytes for last screen update */
+EXTERN long	out_frame_writes INIT(= 0); /* writes for last screen update */
+
 #ifdef FEAT_GUI
 # ifdef FEAT_MENU
 /* Menu item just selected, set by check_termcode() */
@@ -780,6 +789,8 @@ EXTERN int	no_mapping INIT(= FALSE);   /* currently no mapping allowed */
 EXTERN int	no_zero_mapping INIT(= 0);  /* mapping zero not allowed */
 EXTERN int	allow_keys INIT(= FALSE);   /* allow key codes when no_mapping
 					     * is set */
+EXTERN int	allow_paste INIT(= FALSE);  /* the caller of vgetc() handles
+					     * a bracketed paste */
 EXTERN int	no_u_sync INIT(= 0);	/* Don't call u_sync() */
 
 EXTERN int	restart_edit INIT(= 0);	/* call edit when next cmd finished */
@@ -941,6 +952,9 @@ EXTERN FILE *debugfp INIT(= NULL);
 
 EXTERN int  redir_off INIT(= FALSE);	/* no redirection for a moment */
 EXTERN FILE *redir_fd INIT(= NULL);	/* message redirection file */
+#ifdef FEAT_STARTUPTIME
+EXTERN FILE *time_fd INIT(= NULL);	/* where to write startup timing */
+#endif
 #ifdef FEAT_EVAL
 EXTERN int  redir_reg INIT(= 0);	/* message redirection register */
 #endif
@@ -1040,6 +1054,13 @@ EXTERN char_u	wim_flags[4];
 EXTERN int      stl_syntax INIT(= 0);
 #endif
 
+#ifdef FEAT_STL_OPT
+/* Incremented when something may have changed that status line items depend
+ * on and that isn't remembered in the stl_cache_T: an Ex command was
+ * executed or an option set. */
+EXTERN long	stl_tick INIT(= 0);
+#endif
+
 #ifdef FEAT_SEARCH_EXTRA
 /* don't use 'hlsearch' temporarily */
 EXTERN int	no_hlsearch INIT(= FALSE);
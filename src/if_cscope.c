@@ -996,19 +996,25 @@ cs_find_common(opt, pat, forceit, verbose)
 	return FALSE;
 
     /* send query to all open connections, then count the total number
-     * of matches so we can alloc matchesp all in one swell foop
+     * of matches so we can alloc matchesp all in one swell foop.
+     * The query is sent to all connections before reading any answer, so
+     * that the cscope processes search at the same time.
      */
-    for (i = 0; i < CSCOPE_MAX_CONNECTIONS; i++)
-	nummatches[i] = 0;
-    totmatches = 0;
     for (i = 0; i < CSCOPE_MAX_CONNECTIONS; i++)
     {
+	nummatches[i] = 0;
 	if (csinfo[i].fname == NULL)
 	    continue;
 
 	/* send cmd to cscope */
 	(void)fprintf(csinfo[i].to_fp, "%s\n", cmd);
 	(void)fflush(csinfo[i].to_fp);
+    }
+    totmatches = 0;
+    for (i = 0; i < CSCOPE_MAX_CONNECTIONS; i++)
+    {
+	if (csinfo[i].fname == NULL)
+	    continue;
 
 	nummatches[i] = cs_cnt_matches(i);
 
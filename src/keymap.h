@@ -361,6 +361,9 @@ enum key_extra
 #define K_HELP		TERMCAP2KEY('%', '1')
 #define K_UNDO		TERMCAP2KEY('&', '8')
 
+#define K_PS		TERMCAP2KEY('P', 'S')	/* start of bracketed paste */
+#define K_PE		TERMCAP2KEY('P', 'E')	/* end of bracketed paste */
+
 #define K_BS		TERMCAP2KEY('k', 'b')
 
 #define K_INS		TERMCAP2KEY('k', 'I')
@@ -221,8 +221,8 @@
 
 #endif
 
-#ifdef STARTUPTIME
-# define TIME_MSG(s) time_msg(s, NULL)
+#ifdef FEAT_STARTUPTIME
+# define TIME_MSG(s) { if (time_fd != NULL) time_msg("startup", s, NULL); }
 #else
 # define TIME_MSG(s)
 #endif
@@ -46,10 +46,6 @@ static char_u *serverMakeName __ARGS((char_u *arg, char *cmd));
 #endif
 
 
-#ifdef STARTUPTIME
-static FILE *time_fd = NULL;
-#endif
-
 #define FEAT_PRECOMMANDS
 
 /*
@@ -164,9 +160,20 @@ main
     atexit(vim_mem_profile_dump);
 #endif
 
-#ifdef STARTUPTIME
-    time_fd = fopen(STARTUPTIME, "a");
-    TIME_MSG("--- VIM STARTING ---");
+#ifdef FEAT_STARTUPTIME
+    /* Need to open the file for the timing before anything else is done.
+     * The argument is skipped when the arguments are parsed below. */
+    for (i = 1; i < argc; ++i)
+    {
+	if (STRCMP(argv[i], "--") == 0)
+	    break;
+	if (STRICMP(argv[i], "--startuptime") == 0 && i + 1 < argc)
+	{
+	    time_fd = mch_fopen(argv[i + 1], "a");
+	    TIME_MSG("--- VIM STARTING ---");
+	    break;
+	}
+    }
 #endif
 
 #ifdef __EMX__
@@ -550,6 +557,7 @@ main
 				/* "--nofork" don't fork */
 				/* "--noplugin[s]" skip plugins */
 				/* "--cmd <cmd>" execute cmd before vimrc */
+				/* "--startuptime <file>" time startup */
 		if (STRICMP(argv[0] + argv_idx, "help") == 0)
 		    usage();
 		else if (STRICMP(argv[0] + argv_idx, "version") == 0)
@@ -575,6 +583,15 @@ main
 		}
 		else if (STRNICMP(argv[0] + argv_idx, "noplugin", 8) == 0)
 		    p_lpl = FALSE;
+		else if (STRICMP(argv[0] + argv_idx, "startuptime") == 0)
+		{
+		    /* already processed -- snatch the following arg */
+		    if (argc > 1)
+		    {
+			--argc;
+			++argv;
+		    }
+		}
 #ifdef FEAT_PRECOMMANDS
 		else if (STRNICMP(argv[0] + argv_idx, "cmd", 3) == 0)
 		{
@@ -1994,6 +2011,14 @@ scripterror:
 #endif
 
     TIME_MSG("before starting main loop");
+#ifdef FEAT_STARTUPTIME
+    if (time_fd != NULL)
+    {
+	TIME_MSG("--- VIM STARTED ---");
+	fclose(time_fd);
+	time_fd = NULL;
+    }
+#endif
 
     /*
      * Call the main command loop.  This never returns.
@@ -2059,6 +2084,10 @@ main_loop(cmdwin)
 	    did_check_timestamps = FALSE;
 	    if (need_check_timestamps)
 		check_timestamps(FALSE);
+#ifdef UNIX
+	    if (bgwrite_busy(NULL))	/* report finished background writes */
+		(void)bgwrite_check(NULL, FALSE);
+#endif
 	    if (need_wait_return)	/* if wait_return still needed ... */
 		wait_return(FALSE);	/* ... call it now */
 	    if (need_start_insertmode && goto_im()
@@ -2119,6 +2148,8 @@ main_loop(cmdwin)
 	    update_topline();
 	    validate_cursor();
 
+	    /* Write the screen update, messages and cursor position at once. */
+	    out_frame_start();
 #ifdef FEAT_VISUAL
 	    if (VIsual_active)
 		update_curbuf(INVERTED);/* update inverted part */
@@ -2159,6 +2190,7 @@ main_loop(cmdwin)
 
 	    setcursor();
 	    cursor_on();
+	    out_frame_end();
 
 	    do_redraw = FALSE;
 	}
@@ -2226,6 +2258,17 @@ getout(exitval)
 #endif
 	windgoto((int)Rows - 1, 0);
 
+#ifdef UNIX
+    /* Wait for background writes to finish.  When one failed keep the swap
+     * files, the text can be recovered from them. */
+    if (bgwrite_busy(NULL) && bgwrite_check(NULL, TRUE) == FAIL)
+    {
+	ml_close_notmod();
+	ml_sync_all(FALSE, FALSE);
+	ml_close_all(FALSE);
+    }
+#endif
+
 #ifdef FEAT_GUI
     msg_didany = FALSE;
 #endif
@@ -2267,6 +2310,10 @@ getout(exitval)
     apply_autocmds(EVENT_VIMLEAVE, NULL, NULL, FALSE, curbuf);
 #endif
 
+#ifdef FEAT_PROFILE
+    profile_dump();
+#endif
+
     if (did_emsg
 #ifdef FEAT_GUI
 	    || (gui.in_use && msg_didany && p_verbose > 0)
@@ -2304,6 +2351,10 @@ getout(exitval)
 #ifdef FEAT_NETBEANS_INTG
     netbeans_end();
 #endif
+#if defined(MEM_PROFILE) && defined(FEAT_SYN_HL)
+    /* Don't report the cached syntax patterns as not freed. */
+    free_regcache();
+#endif
 
     mch_exit(exitval);
 }
@@ -2570,6 +2621,9 @@ usage()
 #endif
 #ifdef FEAT_VIMINFO
     main_msg(_("-i <viminfo>\t\tUse <viminfo> instead of .viminfo"));
+#endif
+#ifdef FEAT_STARTUPTIME
+    main_msg(_("--startuptime <file>\tWrite startup timing to <file>"));
 #endif
     main_msg(_("-h  or  --help\tPrint Help (this message) and exit"));
     main_msg(_("--version\t\tPrint version information and exit"));
@@ -2651,7 +2705,7 @@ check_swap_exists_action()
 }
 #endif
 
-#if defined(STARTUPTIME) || defined(PROTO)
+#if defined(FEAT_STARTUPTIME) || defined(PROTO)
 static void time_diff __ARGS((struct timeval *then, struct timeval *now));
 
 static struct timeval	prev_timeval;
@@ -2711,14 +2765,27 @@ time_diff(then, now)
     fprintf(time_fd, "%03ld.%03ld", msec, usec >= 0 ? usec : usec + 1000L);
 }
 
+/*
+ * Write one line to the startup timing file.  It has five fields separated
+ * by a Tab, so that it is easy to process and to compare between runs:
+ *	clock	time since Vim started
+ *	total	time since "tv_start", including nested items; "-" when
+ *		"tv_start" is NULL
+ *	self	time since the previous line
+ *	kind	"startup", "source", "autocmd", "runtime" or "viminfo"
+ *	name	what was done: a startup step, file name, event, etc.
+ * Times are in msec.  A Tab or line break in "msg" is written as a space.
+ */
     void
-time_msg(msg, tv_start)
+time_msg(kind, msg, tv_start)
+    char	*kind;
     char	*msg;
-    void	*tv_start;  /* only for do_source: start time; actually
+    void	*tv_start;  /* start time of nested item or NULL; actually
 			       (struct timeval *) */
 {
     static struct timeval	start;
     struct timeval		now;
+    char			*p;
 
     if (time_fd != NULL)
     {
@@ -2726,21 +2793,23 @@ time_msg(msg, tv_start)
 	{
 	    gettimeofday(&start, NULL);
 	    prev_timeval = start;
-	    fprintf(time_fd, "\n\ntimes in msec\n");
-	    fprintf(time_fd, " clock   self+sourced   self:  sourced script\n");
-	    fprintf(time_fd, " clock   elapsed:              other lines\n\n");
+	    fprintf(time_fd, "# Vim startup times in msec\n");
+	    fprintf(time_fd, "# clock\ttotal\tself\tkind\tname\n");
 	}
 	gettimeofday(&now, NULL);
 	time_diff(&start, &now);
+	fputc('\t', time_fd);
 	if (((struct timeval *)tv_start) != NULL)
-	{
-	    fprintf(time_fd, "  ");
 	    time_diff(((struct timeval *)tv_start), &now);
-	}
-	fprintf(time_fd, "  ");
+	else
+	    fputc('-', time_fd);
+	fputc('\t', time_fd);
 	time_diff(&prev_timeval, &now);
 	prev_timeval = now;
-	fprintf(time_fd, ": %s\n", msg);
+	fprintf(time_fd, "\t%s\t", kind);
+	for (p = msg; *p != NUL; ++p)
+	    fputc(*p == '\t' || *p == '\n' || *p == '\r' ? ' ' : *p, time_fd);
+	fputc('\n', time_fd);
     }
 }
 
@@ -78,6 +78,47 @@ extern int dos2;			/* this is in os_amiga.c */
 static long_u	total_mem_used = 0;	/* total memory used for memfiles */
 static int	dont_release = FALSE;	/* don't release blocks */
 
+/* A dirty block that mf_sync() is to write with "flags". */
+#define MF_SYNC_BLOCK(hp, flags) \
+	(((flags) & MFS_ALL || (hp)->bh_bnum >= 0) \
+	 && ((hp)->bh_flags & BH_DIRTY) \
+	 && (!((flags) & MFS_ZERO) || (hp)->bh_bnum == 0))
+
+#ifdef HAVE_WRITEV
+/* Maximum number of blocks written with one writev() call. */
+# if defined(IOV_MAX) && IOV_MAX < 64
+#  define MF_IOV_MAX IOV_MAX
+# else
+#  define MF_IOV_MAX 64
+# endif
+#endif
+
+/*
+ * Statistics for ":swapstats".
+ */
+#if defined(HAVE_GETTIMEOFDAY) && defined(HAVE_SYS_TIME_H)
+# define MF_TIMING
+typedef struct timeval mf_time_T;
+#else
+typedef int mf_time_T;
+#endif
+
+typedef struct
+{
+    long	st_count;	/* number of times done */
+    long	st_last;	/* microseconds used the last time */
+    long	st_max;		/* maximum microseconds used */
+    long	st_sec;		/* total seconds used */
+    long	st_usec;	/* total microseconds used, below 1000000 */
+} mfstat_T;
+
+static mfstat_T	mf_write_stat;		/* writing blocks by mf_sync() */
+static mfstat_T	mf_flush_stat;		/* mf_flush() calls */
+static long	mf_stat_blocks = 0;	/* number of blocks written */
+static long	mf_stat_writes = 0;	/* number of write() calls */
+static long	mf_stat_files = 0;	/* number of memfiles flushed */
+static long	mf_stat_flushes = 0;	/* number of fsync() and sync() calls */
+
 static void mf_ins_hash __ARGS((memfile_T *, bhdr_T *));
 static void mf_rem_hash __ARGS((memfile_T *, bhdr_T *));
 static bhdr_T *mf_find_hash __ARGS((memfile_T *, blocknr_T));
@@ -90,6 +131,16 @@ static void mf_ins_free __ARGS((memfile_T *, bhdr_T *));
 static bhdr_T *mf_rem_free __ARGS((memfile_T *));
 static int  mf_read __ARGS((memfile_T *, bhdr_T *));
 static int  mf_write __ARGS((memfile_T *, bhdr_T *));
+#ifdef HAVE_WRITEV
+static int  mf_write_run __ARGS((memfile_T *, bhdr_T **, int));
+#endif
+static int
+# ifdef __BORLANDC__
+    _RTLENTRYF
+# endif
+	    mf_bnum_cmp __ARGS((const void *, const void *));
+static void mf_stat_start __ARGS((mf_time_T *));
+static void mf_stat_end __ARGS((mf_time_T *, mfstat_T *));
 static int  mf_trans_add __ARGS((memfile_T *, bhdr_T *));
 static void mf_do_open __ARGS((memfile_T *, char_u *, int));
 
@@ -104,6 +155,7 @@ static void mf_do_open __ARGS((memfile_T *, char_u *, int));
  * mf_put()	    unlock a block, may be marked for writing
  * mf_free()	    remove a block
  * mf_sync()	    sync changed parts of memfile to disk
+ * mf_flush()	    flush memfiles written with mf_sync() to disk
  * mf_release_all() release as much memory as possible
  * mf_trans_del()   may translate negative to positive block number
  * mf_fullname()    make file name full path (use before first :cd)
@@ -548,9 +600,14 @@ mf_sync(mfp, flags)
 {
     int		status;
     bhdr_T	*hp;
-#if defined(SYNC_DUP_CLOSE) && !defined(MSDOS)
-    int		fd;
-#endif
+    bhdr_T	**list = NULL;
+    int		count;
+    int		done;
+    int		i;
+    int		n;
+    int		len;
+    long	blocks_save = mf_stat_blocks;
+    mf_time_T	tm;
     int		got_int_save = got_int;
 
     if (mfp->mf_fd < 0)	    /* there is no file, nothing to do */
@@ -562,49 +619,164 @@ mf_sync(mfp, flags)
     /* Only a CTRL-C while writing will break us here, not one typed
      * previously. */
     got_int = FALSE;
+    mf_stat_start(&tm);
 
-    /*
-     * sync from last to first (may reduce the probability of an inconsistent
-     * file) If a write fails, it is very likely caused by a full filesystem.
-     * Then we only try to write blocks within the existing file. If that also
-     * fails then we give up.
-     */
     status = OK;
+    count = 0;
     for (hp = mfp->mf_used_last; hp != NULL; hp = hp->bh_prev)
-	if (((flags & MFS_ALL) || hp->bh_bnum >= 0)
-		&& (hp->bh_flags & BH_DIRTY)
-		&& (status == OK || (hp->bh_bnum >= 0
-		    && hp->bh_bnum < mfp->mf_infile_count)))
+	if (MF_SYNC_BLOCK(hp, flags))
+	    ++count;
+    if (count > 1)
+	list = (bhdr_T **)lalloc((long_u)(count * sizeof(bhdr_T *)), FALSE);
+
+    if (list != NULL)
+    {
+	/*
+	 * Give the dirty blocks with negative numbers a place in the file and
+	 * sort all of them on block number.  Then the file is written from
+	 * start to end and blocks that are next to each other can be written
+	 * with one system call.
+	 */
+	n = 0;
+	for (hp = mfp->mf_used_last; hp != NULL; hp = hp->bh_prev)
+	    if (MF_SYNC_BLOCK(hp, flags))
+	    {
+		if (hp->bh_bnum < 0 && mf_trans_add(mfp, hp) == FAIL)
+		    status = FAIL;
+		else
+		    list[n++] = hp;
+	    }
+	qsort((void *)list, (size_t)n, sizeof(bhdr_T *), mf_bnum_cmp);
+
+	/*
+	 * If a write fails, it is very likely caused by a full filesystem.
+	 * Then we only try to write blocks within the existing file, one at a
+	 * time.  If that also fails then we give up.
+	 */
+	done = TRUE;
+	for (i = 0; i < n; i += len)
 	{
-	    if ((flags & MFS_ZERO) && hp->bh_bnum != 0)
+	    hp = list[i];
+	    len = 1;
+	    if (status == FAIL && hp->bh_bnum >= mfp->mf_infile_count)
 		continue;
-	    if (mf_write(mfp, hp) == FAIL)
+#ifdef HAVE_WRITEV
+	    if (status == OK)
+		len = mf_write_run(mfp, list + i, n - i);
+	    if (len == 0)
+#endif
 	    {
-		if (status == FAIL)	/* double error: quit syncing */
-		    break;
-		status = FAIL;
+		len = 1;
+		if (mf_write(mfp, hp) == FAIL)
+		{
+		    if (status == FAIL)	/* double error: quit syncing */
+		    {
+			done = FALSE;
+			break;
+		    }
+		    status = FAIL;
+		}
 	    }
 	    if (flags & MFS_STOP)
 	    {
 		/* Stop when char available now. */
-		if (ui_char_avail())
+		if (i + len < n && ui_char_avail())
+		{
+		    done = FALSE;
 		    break;
+		}
 	    }
 	    else
 		ui_breakcheck();
 	    if (got_int)
+	    {
+		done = (i + len >= n);
 		break;
+	    }
 	}
+	vim_free(list);
+    }
+    else
+    {
+	/*
+	 * Writing one block or out of memory: sync from last to first.
+	 * If a write fails, it is very likely caused by a full filesystem.
+	 * Then we only try to write blocks within the existing file. If that
+	 * also fails then we give up.
+	 */
+	for (hp = mfp->mf_used_last; hp != NULL; hp = hp->bh_prev)
+	    if (MF_SYNC_BLOCK(hp, flags)
+		    && (status == OK || (hp->bh_bnum >= 0
+			&& hp->bh_bnum < mfp->mf_infile_count)))
+	    {
+		if (mf_write(mfp, hp) == FAIL)
+		{
+		    if (status == FAIL)	/* double error: quit syncing */
+			break;
+		    status = FAIL;
+		}
+		if (flags & MFS_STOP)
+		{
+		    /* Stop when char available now. */
+		    if (ui_char_avail())
+			break;
+		}
+		else
+		    ui_breakcheck();
+		if (got_int)
+		    break;
+	    }
+	done = (hp == NULL);
+    }
+    if (mf_stat_blocks != blocks_save)
+	mf_stat_end(&tm, &mf_write_stat);
 
     /*
      * If the whole list is flushed, the memfile is not dirty anymore.
      * In case of an error this flag is also set, to avoid trying all the time.
      */
-    if (hp == NULL || status == FAIL)
+    if (done || status == FAIL)
 	mfp->mf_dirty = FALSE;
 
-    if ((flags & MFS_FLUSH) && *p_sws != NUL)
+    if ((flags & MFS_FLUSH) && mf_flush(&mfp, 1) == FAIL)
+	status = FAIL;
+
+    got_int |= got_int_save;
+
+    return status;
+}
+
+/*
+ * Flush memfiles "mfps[count]" to disk, so that they will survive a system
+ * crash.  Used after writing them with mf_sync() without MFS_FLUSH.
+ * When 'swapsync' is "sync" one sync() call is sufficient for all of them.
+ *
+ * Return FAIL for failure, OK otherwise
+ */
+    int
+mf_flush(mfps, count)
+    memfile_T	**mfps;
+    int		count;
+{
+    int		status = OK;
+    memfile_T	*mfp;
+    int		i;
+    int		did_sync = FALSE;
+#if defined(SYNC_DUP_CLOSE) && !defined(MSDOS)
+    int		fd;
+#endif
+    mf_time_T	tm;
+
+    if (*p_sws == NUL || count == 0)
+	return OK;
+    mf_stat_start(&tm);
+
+    for (i = 0; i < count; ++i)
     {
+	mfp = mfps[i];
+	if (mfp->mf_fd < 0)
+	    continue;
+	++mf_stat_files;
 #if defined(UNIX)
 # ifdef HAVE_FSYNC
 	/*
@@ -621,11 +793,23 @@ mf_sync(mfp, flags)
 #  endif
 	if (STRCMP(p_sws, "fsync") == 0)
 	{
+	    /* Only the data matters, fdatasync() also flushes the file size
+	     * but not the times and is often faster. */
+	    ++mf_stat_flushes;
+#  ifdef HAVE_FDATASYNC
+	    if (fdatasync(mfp->mf_fd))
+#  else
 	    if (fsync(mfp->mf_fd))
+#  endif
 		status = FAIL;
 	}
 	else
 # endif
+	if (!did_sync)
+	{
+	    /* sync() flushes all files, once is sufficient. */
+	    did_sync = TRUE;
+	    ++mf_stat_flushes;
 	    /* OpenNT is strictly POSIX (Benzinger) */
 	    /* Tandem/Himalaya NSK-OSS doesn't have sync() */
 # if defined(__OPENNT) || defined(__TANDEM)
@@ -633,6 +817,7 @@ mf_sync(mfp, flags)
 # else
 	    sync();
 # endif
+	}
 #endif
 #ifdef VMS
 	if (STRCMP(p_sws, "fsync") == 0)
@@ -694,8 +879,7 @@ mf_sync(mfp, flags)
 # endif
 #endif /* AMIGA */
     }
-
-    got_int |= got_int_save;
+    mf_stat_end(&tm, &mf_flush_stat);
 
     return status;
 }
@@ -1087,8 +1271,12 @@ mf_write(mfp, hp)
 	    return FAIL;
 	}
 	did_swapwrite_msg = FALSE;
+	++mf_stat_writes;
 	if (hp2 != NULL)		    /* written a non-dummy block */
+	{
 	    hp2->bh_flags &= ~BH_DIRTY;
+	    ++mf_stat_blocks;
+	}
 					    /* appended to the file */
 	if (nr + (blocknr_T)page_count > mfp->mf_infile_count)
 	    mfp->mf_infile_count = nr + page_count;
@@ -1098,6 +1286,118 @@ mf_write(mfp, hp)
     return OK;
 }
 
+#if defined(HAVE_WRITEV) || defined(PROTO)
+/*
+ * Write the blocks "list[count]", which are sorted on block number, starting
+ * with "list[0]" as far as they are next to each other in the file, with one
+ * writev() call.
+ * Returns the number of blocks written.  Zero when this is not possible or
+ * failed, then mf_write() is to be used for "list[0]".
+ */
+    static int
+mf_write_run(mfp, list, count)
+    memfile_T	*mfp;
+    bhdr_T	**list;
+    int		count;
+{
+    struct iovec    iov[MF_IOV_MAX];
+    bhdr_T	    *hp;
+    blocknr_T	    nr;
+    off_t	    offset;
+    size_t	    size = 0;
+    int		    n;
+
+    /* A block beyond the end of the file needs the gap to be filled. */
+    nr = list[0]->bh_bnum;
+    if (nr < 0 || nr > mfp->mf_infile_count)
+	return 0;
+
+    for (n = 0; n < count && n < MF_IOV_MAX; ++n)
+    {
+	hp = list[n];
+	if (hp->bh_bnum != nr)
+	    break;
+	iov[n].iov_base = (void *)hp->bh_data;
+	iov[n].iov_len = mfp->mf_page_size * hp->bh_page_count;
+	size += iov[n].iov_len;
+	nr += hp->bh_page_count;
+    }
+    if (n < 2)
+	return 0;
+
+    offset = (off_t)mfp->mf_page_size * list[0]->bh_bnum;
+    if (lseek(mfp->mf_fd, offset, SEEK_SET) != offset
+	    || writev(mfp->mf_fd, iov, n) != (ssize_t)size)
+	return 0;
+
+    did_swapwrite_msg = FALSE;
+    ++mf_stat_writes;
+    mf_stat_blocks += n;
+    for (count = 0; count < n; ++count)
+	list[count]->bh_flags &= ~BH_DIRTY;
+    if (nr > mfp->mf_infile_count)	    /* appended to the file */
+	mfp->mf_infile_count = nr;
+    return n;
+}
+#endif
+
+/*
+ * Compare function for sorting blocks on block number.
+ */
+    static int
+#ifdef __BORLANDC__
+_RTLENTRYF
+#endif
+mf_bnum_cmp(s1, s2)
+    const void	*s1;
+    const void	*s2;
+{
+    blocknr_T	n1 = (*(bhdr_T **)s1)->bh_bnum;
+    blocknr_T	n2 = (*(bhdr_T **)s2)->bh_bnum;
+
+    return n1 < n2 ? -1 : n1 > n2 ? 1 : 0;
+}
+
+/*
+ * Remember the time for the statistics of ":swapstats".
+ */
+/*ARGSUSED*/
+    static void
+mf_stat_start(tm)
+    mf_time_T	*tm;
+{
+#ifdef MF_TIMING
+    gettimeofday(tm, NULL);
+#endif
+}
+
+/*
+ * Count an action that was started at "tm" in "st".
+ */
+/*ARGSUSED*/
+    static void
+mf_stat_end(tm, st)
+    mf_time_T	*tm;
+    mfstat_T	*st;
+{
+#ifdef MF_TIMING
+    struct timeval  now;
+    long	    usec;
+
+    gettimeofday(&now, NULL);
+    usec = (now.tv_sec - tm->tv_sec) * 1000000L + now.tv_usec - tm->tv_usec;
+    if (usec < 0)		/* clock was set back */
+	usec = 0;
+    st->st_last = usec;
+    if (usec > st->st_max)
+	st->st_max = usec;
+    st->st_usec += usec;
+    st->st_sec += st->st_usec / 1000000L;
+    st->st_usec %= 1000000L;
+#endif
+    ++st->st_count;
+}
+
 /*
  * Make block number for *hp positive and add it to the translation list
  *
@@ -1310,3 +1610,37 @@ mf_do_open(mfp, fname, flags)
     else
 	mch_hide(mfp->mf_fname);    /* try setting the 'hidden' flag */
 }
+
+/*
+ * ":swapstats": list statistics about writing swap files.
+ * ":swapstats!": reset them.
+ */
+    void
+ex_swapstats(eap)
+    exarg_T	*eap;
+{
+    static mfstat_T	zero_stat;
+
+    if (eap->forceit)
+    {
+	mf_write_stat = zero_stat;
+	mf_flush_stat = zero_stat;
+	mf_stat_blocks = 0;
+	mf_stat_writes = 0;
+	mf_stat_files = 0;
+	mf_stat_flushes = 0;
+	return;
+    }
+    smsg((char_u *)_("Swap syncs: %ld, %ld blocks in %ld writes"),
+		    mf_write_stat.st_count, mf_stat_blocks, mf_stat_writes);
+    smsg((char_u *)_("Flushes: %ld, %ld files with %ld sync calls"),
+		    mf_flush_stat.st_count, mf_stat_files, mf_stat_flushes);
+#ifdef MF_TIMING
+    smsg((char_u *)_("Sync time: last %ld usec, max %ld usec, total %ld.%03ld sec"),
+		    mf_write_stat.st_last, mf_write_stat.st_max,
+		    mf_write_stat.st_sec, mf_write_stat.st_usec / 1000L);
+    smsg((char_u *)_("Flush time: last %ld usec, max %ld usec, total %ld.%03ld sec"),
+		    mf_flush_stat.st_last, mf_flush_stat.st_max,
+		    mf_flush_stat.st_sec, mf_flush_stat.st_usec / 1000L);
+#endif
+}
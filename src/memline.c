@@ -190,7 +190,9 @@ static linenr_T	lowest_marked = 0;
 static void set_b0_fname __ARGS((ZERO_BL *, buf_T *buf));
 static time_t swapfile_info __ARGS((char_u *));
 static int recov_file_names __ARGS((char_u **, char_u *, int prepend_dot));
-static int ml_append_int __ARGS((buf_T *, linenr_T, char_u *, colnr_T, int, int));
+static int ml_append_int __ARGS((buf_T *, linenr_T, char_u *, colnr_T, int, int,
+						  char_u **, colnr_T *, long *));
+static long ml_fill_block __ARGS((DATA_BL *dp, long *line_countp, char_u **lines, colnr_T *lens, long count, int reserve, long *sizep));
 static int ml_delete_int __ARGS((buf_T *, linenr_T, int));
 static char_u *findswapname __ARGS((buf_T *, char_u **, char_u *));
 static void ml_flush_line __ARGS((buf_T *));
@@ -210,7 +212,7 @@ static long char_to_long __ARGS((char_u *));
 static char_u *make_percent_swname __ARGS((char_u *dir, char_u *name));
 #endif
 #ifdef FEAT_BYTEOFF
-static void ml_updatechunk __ARGS((buf_T *buf, long line, long len, int updtype));
+static void ml_updatechunk __ARGS((buf_T *buf, long line, long len, long nlines, int updtype));
 #endif
 
 /*
@@ -1695,6 +1697,9 @@ end:
  * If 'check_file' is TRUE, check if original file exists and was not changed.
  * If 'check_char' is TRUE, stop syncing when character becomes available, but
  * always sync at least one block.
+ *
+ * The swap files of changed buffers are flushed to disk after writing all of
+ * them, instead of waiting for the disk after each one.
  */
     void
 ml_sync_all(check_file, check_char)
@@ -1703,7 +1708,10 @@ ml_sync_all(check_file, check_char)
 {
     buf_T		*buf;
     struct stat		st;
+    garray_T		flush_ga;
+    memfile_T		*mfp;
 
+    ga_init2(&flush_ga, (int)sizeof(memfile_T *), 10);
     for (buf = firstbuf; buf != NULL; buf = buf->b_next)
     {
 	if (buf->b_ml.ml_mfp == NULL || buf->b_ml.ml_mfp->mf_fname == NULL)
@@ -1730,12 +1738,24 @@ ml_sync_all(check_file, check_char)
 	}
 	if (buf->b_ml.ml_mfp->mf_dirty)
 	{
-	    (void)mf_sync(buf->b_ml.ml_mfp, (check_char ? MFS_STOP : 0)
-					| (bufIsChanged(buf) ? MFS_FLUSH : 0));
+	    mfp = buf->b_ml.ml_mfp;
+	    if (!bufIsChanged(buf))
+		(void)mf_sync(mfp, check_char ? MFS_STOP : 0);
+	    else if (ga_grow(&flush_ga, 1) == OK)
+	    {
+		(void)mf_sync(mfp, check_char ? MFS_STOP : 0);
+		((memfile_T **)flush_ga.ga_data)[flush_ga.ga_len++] = mfp;
+		--flush_ga.ga_room;
+	    }
+	    else
+		(void)mf_sync(mfp, (check_char ? MFS_STOP : 0) | MFS_FLUSH);
 	    if (check_char && ui_char_avail())	/* character available now */
 		break;
 	}
     }
+
+    (void)mf_flush((memfile_T **)flush_ga.ga_data, flush_ga.ga_len);
+    ga_clear(&flush_ga);
 }
 
 /*
@@ -1966,19 +1986,77 @@ ml_append(lnum, line, len, newfile)
 
     if (curbuf->b_ml.ml_line_lnum != 0)
 	ml_flush_line(curbuf);
-    return ml_append_int(curbuf, lnum, line, len, newfile, FALSE);
+    return ml_append_int(curbuf, lnum, line, len, newfile, FALSE,
+							     NULL, NULL, NULL);
 }
 
+/*
+ * Append "count" lines after lnum (may be 0 to insert in front of the file).
+ * "lines[i]" is the text of a line, "lens[i]" its length including the NUL,
+ * or 0.  "lens" may be NULL.  Like for ml_append() the text can't be in a
+ * buffer.
+ * This is much faster than calling ml_append() for every line: when a new
+ * data block is needed it is filled with as many lines as fit before it is
+ * linked into the tree.
+ *
+ * return FAIL for failure, OK otherwise
+ */
+    int
+ml_append_lines(lnum, lines, lens, count, newfile)
+    linenr_T	lnum;		/* append after this line (can be 0) */
+    char_u	**lines;	/* text of the new lines */
+    colnr_T	*lens;		/* lengths of the new lines or NULL */
+    long	count;		/* number of lines */
+    int		newfile;	/* flag, see ml_append() */
+{
+    long	done;
+
+    /* When starting up, we might still need to create the memfile */
+    if (curbuf->b_ml.ml_mfp == NULL && open_buffer(FALSE, NULL) == FAIL)
+	return FAIL;
+
+    if (curbuf->b_ml.ml_line_lnum != 0)
+	ml_flush_line(curbuf);
+    while (count > 0)
+    {
+	/* "done" is set to the number of lines appended after the first one */
+	done = count - 1;
+	if (ml_append_int(curbuf, lnum, lines[0],
+		    lens == NULL ? (colnr_T)0 : lens[0], newfile, FALSE,
+		    lines + 1, lens == NULL ? NULL : lens + 1, &done) == FAIL)
+	    return FAIL;
+	++done;
+	lnum += done;
+	lines += done;
+	if (lens != NULL)
+	    lens += done;
+	count -= done;
+    }
+    return OK;
+}
+
+/*
+ * Append one line after "lnum".  When "more" is not NULL, "*more_count"
+ * lines in "more[]" (with lengths in "more_len[]", if not NULL) may be
+ * appended after it, when a new data block is started for the line and they
+ * fit in it.  "*more_count" is set to the number of these lines that were
+ * appended.
+ */
     static int
-ml_append_int(buf, lnum, line, len, newfile, mark)
+ml_append_int(buf, lnum, line, len, newfile, mark, more, more_len, more_count)
     buf_T	*buf;
     linenr_T	lnum;		/* append after this line (can be 0) */
     char_u	*line;		/* text of the new line */
     colnr_T	len;		/* length of line, including NUL, or 0 */
     int		newfile;	/* flag, see above */
     int		mark;		/* mark the new line */
+    char_u	**more;		/* text of following lines or NULL */
+    colnr_T	*more_len;	/* their lengths or NULL */
+    long	*more_count;	/* IN: size of "more", OUT: nr of lines used */
 {
     int		i;
+    long	extra = 0;	/* nr of lines from "more" appended */
+    long	extra_size = 0;	/* their total length */
     int		line_count;	/* number of indexes in current block */
     int		offset;
     int		from, to;
@@ -2058,12 +2136,37 @@ ml_append_int(buf, lnum, line, len, newfile, mark)
 
     if ((int)dp->db_free >= space_needed)	/* enough room in data block */
     {
+	colnr_T	mlen;
+	int	total;
+
 /*
  * Insert new line in existing data block, or in data block allocated above.
+ * Lines from "more" that also fit are inserted together with it.
  */
-	dp->db_txt_start -= len;
+	if (more != NULL)
+	    for ( ; extra < *more_count; ++extra)
+	    {
+		mlen = (more_len == NULL || more_len[extra] == 0)
+			? (colnr_T)STRLEN(more[extra]) + 1 : more_len[extra];
+		if ((int)dp->db_free < space_needed + mlen + (int)INDEX_SIZE)
+		    break;
+		space_needed += mlen + INDEX_SIZE;
+		extra_size += mlen;
+	    }
+	total = len + extra_size;
+
+	dp->db_txt_start -= total;
 	dp->db_free -= space_needed;
-	++(dp->db_line_count);
+	dp->db_line_count += extra + 1;
+
+	/*
+	 * Offset is the start of the previous line.
+	 * This will become the character just after the new lines.
+	 */
+	if (db_idx < 0)
+	    offset = dp->db_txt_end;
+	else
+	    offset = ((dp->db_index[db_idx]) & DB_INDEX_MASK);
 
 	/*
 	 * move the text of the lines that follow to the front
@@ -2071,31 +2174,37 @@ ml_append_int(buf, lnum, line, len, newfile, mark)
 	 */
 	if (line_count > db_idx + 1)	    /* if there are following lines */
 	{
-	    /*
-	     * Offset is the start of the previous line.
-	     * This will become the character just after the new line.
-	     */
-	    if (db_idx < 0)
-		offset = dp->db_txt_end;
-	    else
-		offset = ((dp->db_index[db_idx]) & DB_INDEX_MASK);
 	    mch_memmove((char *)dp + dp->db_txt_start,
-					  (char *)dp + dp->db_txt_start + len,
-				 (size_t)(offset - (dp->db_txt_start + len)));
+					(char *)dp + dp->db_txt_start + total,
+			       (size_t)(offset - (dp->db_txt_start + total)));
 	    for (i = line_count - 1; i > db_idx; --i)
-		dp->db_index[i + 1] = dp->db_index[i] - len;
-	    dp->db_index[db_idx + 1] = offset - len;
+		dp->db_index[i + 1 + extra] = dp->db_index[i] - total;
 	}
-	else				    /* add line at the end */
-	    dp->db_index[db_idx + 1] = dp->db_txt_start;
 
 	/*
 	 * copy the text into the block
 	 */
-	mch_memmove((char *)dp + dp->db_index[db_idx + 1], line, (size_t)len);
+	for (i = 0; i <= extra; ++i)
+	{
+	    if (i > 0)
+		mlen = (more_len == NULL || more_len[i - 1] == 0)
+			? (colnr_T)STRLEN(more[i - 1]) + 1 : more_len[i - 1];
+	    else
+		mlen = len;
+	    offset -= mlen;
+	    dp->db_index[db_idx + 1 + i] = offset;
+	    mch_memmove((char *)dp + offset, i == 0 ? line : more[i - 1],
+							       (size_t)mlen);
+	}
 	if (mark)
 	    dp->db_index[db_idx + 1] |= DB_MARKED;
 
+	/* The pointer blocks are updated for the extra lines later, like for
+	 * the one found by ml_find_line(). */
+	buf->b_ml.ml_line_count += extra;
+	buf->b_ml.ml_locked_high += extra;
+	buf->b_ml.ml_locked_lineadd += extra;
+
 	/*
 	 * Mark the block dirty.
 	 */
@@ -2212,6 +2321,12 @@ ml_append_int(buf, lnum, line, len, newfile, mark)
 	    mch_memmove((char *)dp_right + dp_right->db_txt_start,
 							   line, (size_t)len);
 	    ++line_count_right;
+
+	    /* Following lines can go after it, in front of the moved lines. */
+	    if (more != NULL)
+		extra = ml_fill_block(dp_right, &line_count_right, more,
+			       more_len, *more_count, lines_moved ? total_moved : 0,
+								 &extra_size);
 	}
 	/*
 	 * may move lines from the left/old block to the right/new one.
@@ -2252,8 +2367,15 @@ ml_append_int(buf, lnum, line, len, newfile, mark)
 	    mch_memmove((char *)dp_left + dp_left->db_txt_start,
 							   line, (size_t)len);
 	    ++line_count_left;
+
+	    /* Following lines can go after it, the moved lines are gone. */
+	    if (more != NULL)
+		extra = ml_fill_block(dp_left, &line_count_left, more,
+				  more_len, *more_count, 0, &extra_size);
 	}
 
+	buf->b_ml.ml_line_count += extra;
+
 	if (db_idx < 0)		/* left block is new */
 	{
 	    lnum_left = lnum + 1;
@@ -2263,7 +2385,7 @@ ml_append_int(buf, lnum, line, len, newfile, mark)
 	{
 	    lnum_left = 0;
 	    if (in_left)
-		lnum_right = lnum + 2;
+		lnum_right = lnum + 2 + extra;
 	    else
 		lnum_right = lnum + 1;
 	}
@@ -2287,7 +2409,7 @@ ml_append_int(buf, lnum, line, len, newfile, mark)
 	 * set ml_locked_lineadd to 0, because the updating of the
 	 * pointer blocks is done below
 	 */
-	lineadd = buf->b_ml.ml_locked_lineadd;
+	lineadd = buf->b_ml.ml_locked_lineadd + extra;
 	buf->b_ml.ml_locked_lineadd = 0;
 	ml_find_line(buf, (linenr_T)0, ML_FLUSH);   /* flush data block */
 
@@ -2452,21 +2574,67 @@ ml_append_int(buf, lnum, line, len, newfile, mark)
     }
 
 #ifdef FEAT_BYTEOFF
-    /* The line was inserted below 'lnum' */
-    ml_updatechunk(buf, lnum + 1, (long)len, ML_CHNK_ADDLINE);
+    /* The lines were inserted below 'lnum' */
+    ml_updatechunk(buf, lnum + 1, (long)len + extra_size, extra + 1,
+							     ML_CHNK_ADDLINE);
 #endif
 #ifdef FEAT_NETBEANS_INTG
     if (usingNetbeans)
     {
-	if (STRLEN(line) > 0)
-	    netbeans_inserted(buf, lnum+1, (colnr_T)0, 0, line, STRLEN(line));
-	netbeans_inserted(buf, lnum+1, (colnr_T)STRLEN(line), 0,
+	for (i = 0; i <= extra; ++i)
+	{
+	    if (i > 0)
+		line = more[i - 1];
+	    if (STRLEN(line) > 0)
+		netbeans_inserted(buf, lnum + 1 + i, (colnr_T)0, 0,
+							   line, STRLEN(line));
+	    netbeans_inserted(buf, lnum + 1 + i, (colnr_T)STRLEN(line), 0,
 							   (char_u *)"\n", 1);
+	}
     }
 #endif
+    if (more_count != NULL)
+	*more_count = extra;
     return OK;
 }
 
+/*
+ * Add lines from "lines[count]" after the "*line_countp" lines in data block
+ * "dp", as many as fit while leaving "reserve" bytes free.  "lens" has their
+ * lengths, may be NULL.
+ * Returns the number of lines added, their total length is added to "*sizep".
+ */
+    static long
+ml_fill_block(dp, line_countp, lines, lens, count, reserve, sizep)
+    DATA_BL	*dp;
+    long	*line_countp;
+    char_u	**lines;
+    colnr_T	*lens;
+    long	count;
+    int		reserve;
+    long	*sizep;
+{
+    long	n;
+    colnr_T	len;
+
+    for (n = 0; n < count; ++n)
+    {
+	if (lens == NULL || lens[n] == 0)
+	    len = (colnr_T)STRLEN(lines[n]) + 1;
+	else
+	    len = lens[n];
+	if ((int)dp->db_free - reserve < len + (int)INDEX_SIZE)
+	    break;
+	dp->db_txt_start -= len;
+	dp->db_free -= len + INDEX_SIZE;
+	dp->db_index[*line_countp] = dp->db_txt_start;
+	mch_memmove((char *)dp + dp->db_txt_start, lines[n], (size_t)len);
+	++*line_countp;
+	*sizep += len;
+    }
+    return n;
+}
+
 /*
  * replace line lnum, with buffering, in current buffer
  *
@@ -2684,7 +2852,7 @@ ml_delete_int(buf, lnum, message)
     }
 
 #ifdef FEAT_BYTEOFF
-    ml_updatechunk(buf, lnum, line_size, ML_CHNK_DELLINE);
+    ml_updatechunk(buf, lnum, line_size, 1L, ML_CHNK_DELLINE);
 #endif
     return OK;
 }
@@ -2898,7 +3066,7 @@ ml_flush_line(buf)
 		buf->b_ml.ml_flags |= (ML_LOCKED_DIRTY | ML_LOCKED_POS);
 #ifdef FEAT_BYTEOFF
 		/* The else case is already covered by the insert and delete */
-		ml_updatechunk(buf, lnum, (long)extra, ML_CHNK_UPDLINE);
+		ml_updatechunk(buf, lnum, (long)extra, 1L, ML_CHNK_UPDLINE);
 #endif
 	    }
 	    else
@@ -2912,7 +3080,7 @@ ml_flush_line(buf)
 		 */
 		/* How about handling errors??? */
 		(void)ml_append_int(buf, lnum, new_line, new_len, FALSE,
-					     (dp->db_index[idx] & DB_MARKED));
+			       (dp->db_index[idx] & DB_MARKED), NULL, NULL, NULL);
 		(void)ml_delete_int(buf, lnum, FALSE);
 	    }
 	}
@@ -3984,15 +4152,17 @@ ml_setdirty(buf, flag)
 /*
  * Keep information for finding byte offset of a line, updtytpe may be one of:
  * ML_CHNK_ADDLINE: Add len to parent chunk, possibly splitting it
+ *	   "nlines" lines were added, "len" is their total length.
  *	   Careful: ML_CHNK_ADDLINE may cause ml_find_line() to be called.
  * ML_CHNK_DELLINE: Subtract len from parent chunk, possibly deleting it
  * ML_CHNK_UPDLINE: Add len to parent chunk, as a signed entity.
  */
     static void
-ml_updatechunk(buf, line, len, updtype)
+ml_updatechunk(buf, line, len, nlines, updtype)
     buf_T	*buf;
     linenr_T	line;
     long	len;
+    long	nlines;		/* nr of lines for ML_CHNK_ADDLINE */
     int		updtype;
 {
     static buf_T	*ml_upd_lastbuf = NULL;
@@ -4066,8 +4236,9 @@ ml_updatechunk(buf, line, len, updtype)
     curchnk->mlcs_totalsize += len;
     if (updtype == ML_CHNK_ADDLINE)
     {
-	curchnk->mlcs_numlines++;
+	curchnk->mlcs_numlines += nlines;
 
+split_again:
 	/* May resize here so we don't have to do it in both cases below */
 	if (buf->b_ml.ml_usedchunks + 1 >= buf->b_ml.ml_numchunks)
 	{
@@ -4089,6 +4260,7 @@ ml_updatechunk(buf, line, len, updtype)
 	    int	    idx;
 	    int	    text_end;
 	    int	    linecnt;
+	    linenr_T chunk_start = curline;
 
 	    mch_memmove(buf->b_ml.ml_chunksize + curix + 1,
 			buf->b_ml.ml_chunksize + curix,
@@ -4134,6 +4306,15 @@ ml_updatechunk(buf, line, len, updtype)
 	    buf->b_ml.ml_chunksize[curix + 1].mlcs_totalsize -= size;
 	    buf->b_ml.ml_usedchunks++;
 	    ml_upd_lastbuf = NULL;   /* Force recalc of curix & curline */
+
+	    /* When many lines were added the rest may still be too big */
+	    if (linecnt > 0 && buf->b_ml.ml_chunksize[curix + 1].mlcs_numlines
+								 >= MLCS_MAXL)
+	    {
+		curline = chunk_start + linecnt;
+		++curix;
+		goto split_again;
+	    }
 	    return;
 	}
 	else if (buf->b_ml.ml_chunksize[curix].mlcs_numlines >= MLCS_MINL
@@ -4216,7 +4397,7 @@ ml_updatechunk(buf, line, len, updtype)
 	return;
     }
     ml_upd_lastbuf = buf;
-    ml_upd_lastline = line;
+    ml_upd_lastline = line + nlines - 1;
     ml_upd_lastcurline = curline;
     ml_upd_lastcurix = curix;
 }
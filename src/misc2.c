@@ -1849,6 +1849,8 @@ static struct key_name_entry
 
     {K_HELP,		(char_u *)"Help"},
     {K_UNDO,		(char_u *)"Undo"},
+    {K_PS,		(char_u *)"PasteStart"},
+    {K_PE,		(char_u *)"PasteEnd"},
     {K_INS,		(char_u *)"Insert"},
     {K_INS,		(char_u *)"Ins"},	/* Alternative name */
     {K_KINS,		(char_u *)"kInsert"},
@@ -2613,6 +2615,11 @@ call_shell(cmd, opt)
 #endif
 	/* The external command may update a tags file, clear cached tags. */
 	tag_freematch();
+#ifdef UNIX
+	/* The command may use a file that is being written in the
+	 * background.  Only wait for files that appear in the command. */
+	bgwrite_wait_cmd(cmd);
+#endif
 
 	if (cmd == NULL || *p_sxq == NUL)
 	    retval = mch_call_shell(cmd, opt);
@@ -375,6 +375,8 @@ static const struct nv_cmd
     {K_IGNORE,	nv_ignore,	0,			0},
     {K_INS,	nv_edit,	0,			0},
     {K_KINS,	nv_edit,	0,			0},
+    {K_PS,	nv_edit,	0,			0},
+    {K_PE,	nv_ignore,	0,			0},
     {K_BS,	nv_ctrlh,	0,			0},
     {K_UP,	nv_up,		NV_SSS|NV_STS,		FALSE},
     {K_S_UP,	nv_page,	NV_SS,			BACKWARD},
@@ -602,7 +604,9 @@ normal_cmd(oap, toplevel)
     /*
      * Get the command character from the user.
      */
+    allow_paste = TRUE;
     c = safe_vgetc();
+    allow_paste = FALSE;
 
 #ifdef FEAT_LANGMAP
     LANGMAP_ADJUST(c, TRUE);
@@ -8064,6 +8068,19 @@ nv_edit(cap)
     if (cap->cmdchar == K_INS || cap->cmdchar == K_KINS)
 	cap->cmdchar = 'i';
 
+    /* A bracketed paste inserts the text once, at the cursor. */
+    if (cap->cmdchar == K_PS)
+    {
+	cap->count1 = 1;
+#ifdef FEAT_VISUAL
+	if (VIsual_active)
+	{
+	    end_visual_mode();
+	    redraw_curbuf_later(INVERTED);
+	}
+#endif
+    }
+
 #ifdef FEAT_VISUAL
     /* in Visual mode "A" and "I" are an operator */
     if (VIsual_active && (cap->cmdchar == 'A' || cap->cmdchar == 'I'))
@@ -8090,8 +8107,15 @@ nv_edit(cap)
 	/* Only give this error when 'insertmode' is off. */
 	EMSG(_(e_modifiable));
 	clearop(cap->oap);
+	if (cap->cmdchar == K_PS)
+	    (void)get_bracketed_paste(NULL);	/* drop the pasted text */
     }
-    else if (!checkclearopq(cap->oap))
+    else if (checkclearopq(cap->oap))
+    {
+	if (cap->cmdchar == K_PS)
+	    (void)get_bracketed_paste(NULL);	/* drop the pasted text */
+    }
+    else
     {
 	switch (cap->cmdchar)
 	{
@@ -3508,6 +3508,19 @@ do_put(regname, dir, count, flags)
 		    i = 1;
 		}
 
+		if (!(flags & PUT_FIXINDENT))
+		{
+		    /* Append all the lines at once, that is a lot faster.
+		     * With MCHAR the last line was inserted above. */
+		    j = y_size - i - (y_type == MCHAR ? 1 : 0);
+		    if (j > 0 && ml_append_lines(lnum, y_array + i, NULL,
+							  j, FALSE) == FAIL)
+			goto error;
+		    lnum += y_size - i;
+		    nr_lines += y_size - i;
+		    i = y_size;
+		}
+
 		for (; i < y_size; ++i)
 		{
 		    if ((y_type != MCHAR || i < y_size - 1)
@@ -368,6 +368,13 @@ static struct vimoption
 			    {(char_u *)0L, (char_u *)0L}
 #endif
 			    },
+    {"asyncwrite",  "asw",  P_BOOL|P_VI_DEF|P_VIM,
+#ifdef UNIX
+			    (char_u *)&p_asw, PV_NONE,
+#else
+			    (char_u *)NULL, PV_NONE,
+#endif
+			    {(char_u *)FALSE, (char_u *)0L}},
 #if defined(FEAT_NETBEANS_INTG) || defined(FEAT_SUN_WORKSHOP)
     {"autochdir",  "acd",   P_BOOL|P_VI_DEF,
 			    (char_u *)&p_acd, PV_NONE,
@@ -2331,6 +2338,9 @@ static struct vimoption
     p_term("t_AL", T_CAL)
     p_term("t_al", T_AL)
     p_term("t_bc", T_BC)
+    p_term("t_BD", T_BD)
+    p_term("t_BE", T_BE)
+    p_term("t_BU", T_BSU)
     p_term("t_cd", T_CD)
     p_term("t_ce", T_CE)
     p_term("t_cl", T_CL)
@@ -2346,6 +2356,7 @@ static struct vimoption
     p_term("t_db", T_DB)
     p_term("t_DL", T_CDL)
     p_term("t_dl", T_DL)
+    p_term("t_EU", T_ESU)
     p_term("t_fs", T_FS)
     p_term("t_IE", T_CIE)
     p_term("t_IS", T_CIS)
@@ -3300,6 +3311,9 @@ do_set(arg, opt_flags)
     int		cp_val = 0;
     char_u	key_name[2];
 
+#ifdef FEAT_STL_OPT
+    ++stl_tick;		/* status line items may show option values */
+#endif
     if (*arg == NUL)
     {
 	showoptions(0, opt_flags);
@@ -5959,6 +5973,8 @@ check_stl_option(s)
 	    groupdepth++;
 	    continue;
 	}
+	if (*s == STL_EXPR_CACHED && s[1] == STL_VIM_EXPR)
+	    s++;
 	if (vim_strchr(STL_ALL, *s) == NULL)
 	{
 	    return illegal_char(errbuf, *s);
@@ -6182,7 +6198,7 @@ set_bool_option(opt_idx, varp, value, opt_flags)
     /* when 'ignorecase' is set or reset and 'hlsearch' is set, redraw */
     else if ((int *)varp == &p_ic && p_hls)
     {
-	redraw_all_later(NOT_VALID);
+	redraw_all_lines_later();
     }
 
 #ifdef FEAT_SEARCH_EXTRA
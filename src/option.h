@@ -261,6 +261,7 @@
 #define STL_ARGLISTSTAT	'a'		/* argument list status as (x of y) */
 #define STL_PAGENUM	'N'		/* page number (when printing)*/
 #define STL_VIM_EXPR	'{'		/* start of expression to substitute */
+#define STL_EXPR_CACHED	'!'		/* before '{': remember the value */
 #define STL_MIDDLEMARK	'='		/* separation between left and right */
 #define STL_TRUNCMARK	'<'		/* truncation mark if line is too long*/
 #define STL_HIGHLIGHT	'*'		/* highlight from (User)1..9 or 0 */
@@ -295,6 +296,9 @@ EXTERN char_u	*p_ambw;	/* 'ambiwidth' */
 EXTERN int	*p_antialias;	/* 'antialias' */
 #endif
 EXTERN int	p_ar;		/* 'autoread' */
+#ifdef UNIX
+EXTERN int	p_asw;		/* 'asyncwrite' */
+#endif
 EXTERN int	p_aw;		/* 'autowrite' */
 EXTERN int	p_awa;		/* 'autowriteall' */
 EXTERN char_u	*p_bs;		/* 'backspace' */
@@ -379,8 +379,21 @@ mch_inchar(buf, maxlen, wtime, tb_change_cnt)
 	    handle_resize();
 	/*
 	 * we want to be interrupted by the winch signal
+	 * When a background write is busy check every 100 msec if it
+	 * finished, to report the result while waiting in Normal mode.
 	 */
-	WaitForChar(-1L);
+	if (State == NORMAL && bgwrite_busy(NULL))
+	{
+	    if (WaitForChar(100L) == 0)
+	    {
+		(void)bgwrite_check(NULL, FALSE);
+		setcursor();
+		out_flush();
+		continue;
+	    }
+	}
+	else
+	    WaitForChar(-1L);
 	if (do_resize)	    /* interrupted by SIGWINCH signal */
 	    continue;
 
@@ -3174,6 +3187,56 @@ mch_set_shellsize()
 
 #endif /* VMS */
 
+/*
+ * Exit status of children that wait() in mch_call_shell() returned while
+ * waiting for the shell.  mch_write_bg_done() can't get it from waitpid()
+ * then.  The oldest entry is overwritten when the table is full.
+ */
+#define REAPED_MAX 10
+static struct
+{
+    pid_t	pid;		/* zero for an unused entry */
+    int		code;		/* exit code, -1 when it didn't exit */
+} reaped[REAPED_MAX];
+static int reaped_next = 0;
+
+static void reaped_add __ARGS((pid_t pid, int code));
+static int reaped_find __ARGS((pid_t pid, int *codep));
+
+/*
+ * Remember that child "pid" exited with "code".
+ */
+    static void
+reaped_add(pid, code)
+    pid_t	pid;
+    int		code;
+{
+    reaped[reaped_next].pid = pid;
+    reaped[reaped_next].code = code;
+    reaped_next = (reaped_next + 1) % REAPED_MAX;
+}
+
+/*
+ * Find the exit code of child "pid" that was remembered by reaped_add() and
+ * forget about it.  Returns FAIL when it isn't found.
+ */
+    static int
+reaped_find(pid, codep)
+    pid_t	pid;
+    int		*codep;
+{
+    int		i;
+
+    for (i = 0; i < REAPED_MAX; ++i)
+	if (reaped[i].pid == pid)
+	{
+	    *codep = reaped[i].code;
+	    reaped[i].pid = 0;
+	    return OK;
+	}
+    return FAIL;
+}
+
 /*
  * Rows and/or Columns has changed.
  */
@@ -3895,6 +3958,11 @@ finished:
 # endif
 		   )
 		    break;
+		/* Another child, e.g. a write in the background: keep its exit
+		 * status for mch_write_bg_done(). */
+		if (wait_pid > 0 && wait_pid != pid)
+		    reaped_add(wait_pid,
+			    WIFEXITED(status) ? WEXITSTATUS(status) : -1);
 	    }
 
 	    /*
@@ -3945,6 +4013,136 @@ error:
 #endif /* USE_SYSTEM */
 }
 
+/*
+ * Write "len" bytes of "text" to file descriptor "fd", sync and close it,
+ * then rename "tmpname" to "fname".  "fd" must be open for "tmpname".
+ * Used by the child process of mch_write_bg() and when a write can't be done
+ * in the background after all.
+ * Returns BGW_OK or the BGW_ value for the step that failed, "tmpname" is
+ * removed then.
+ */
+    int
+mch_write_tmp(fd, text, len, tmpname, fname)
+    int		fd;
+    char_u	*text;
+    long	len;
+    char_u	*tmpname;
+    char_u	*fname;
+{
+    long	wlen;
+    int		retval = BGW_OK;
+
+    /* The text is in one piece, write it with as few calls as possible. */
+    while (len > 0)
+    {
+	wlen = vim_write(fd, text, len);
+	if (wlen <= 0)
+	{
+	    if (wlen < 0 && errno == EINTR)
+		continue;
+	    retval = BGW_WRITE;
+	    break;
+	}
+	text += wlen;
+	len -= wlen;
+    }
+#ifdef HAVE_FSYNC
+    if (retval == BGW_OK && fsync(fd) != 0)
+	retval = BGW_FSYNC;
+#endif
+    if (close(fd) != 0 && retval == BGW_OK)
+	retval = BGW_CLOSE;
+    if (retval == BGW_OK && rename((char *)tmpname, (char *)fname) != 0)
+	retval = BGW_RENAME;
+    if (retval != BGW_OK)
+	unlink((char *)tmpname);
+    return retval;
+}
+
+/*
+ * Start writing "len" bytes of "text" to "fd" in a child process, which then
+ * syncs the file and renames "tmpname" to "fname".  The child gets a copy of
+ * "text", the caller may change or free it right away.  "fd" is closed.
+ * When a process was started "*pidp" is set to its ID and BGW_OK is
+ * returned.  When fork() fails the text is written here, "*pidp" is set to
+ * zero and the result is returned.
+ */
+    int
+mch_write_bg(fd, text, len, tmpname, fname, pidp)
+    int		fd;
+    char_u	*text;
+    long	len;
+    char_u	*tmpname;
+    char_u	*fname;
+    long	*pidp;
+{
+    pid_t	pid;
+
+    out_flush();
+    pid = fork();
+    if (pid == 0)
+    {
+	/* child: only write the file and exit */
+	reset_signals();
+	/* Finish the write when the terminal goes away. */
+	signal(SIGHUP, SIG_IGN);
+	signal(SIGINT, SIG_IGN);
+	_exit(mch_write_tmp(fd, text, len, tmpname, fname));
+    }
+
+    if (pid < 0)
+    {
+	*pidp = 0;
+	return mch_write_tmp(fd, text, len, tmpname, fname);
+    }
+    close(fd);
+    *pidp = (long)pid;
+    return BGW_OK;
+}
+
+/*
+ * Check if the process "pid" started by mch_write_bg() for "tmpname" has
+ * finished.  When "wait" is TRUE wait for it.
+ * Returns -1 when it is still busy, the BGW_ result otherwise.
+ */
+/*ARGSUSED*/
+    int
+mch_write_bg_done(pid, tmpname, wait)
+    long	pid;
+    char_u	*tmpname;
+    int		wait;
+{
+    pid_t	wait_pid;
+    int		code;
+# ifdef HAVE_UNION_WAIT
+    union wait	status;
+# else
+    int		status = -1;
+# endif
+
+    for (;;)
+    {
+	wait_pid = waitpid((pid_t)pid, &status, wait ? 0 : WNOHANG);
+	if (wait_pid == 0)
+	    return -1;
+	if (wait_pid == (pid_t)pid)
+	{
+	    if (WIFEXITED(status))
+		return WEXITSTATUS(status);
+	    return BGW_KILLED;
+	}
+	if (errno != EINTR)
+	    break;
+    }
+
+    /* Somebody else already waited for the process, wait() in
+     * mch_call_shell() remembers the exit code.  Otherwise the result is
+     * unknown, it's not possible to tell whether the file was written. */
+    if (reaped_find((pid_t)pid, &code) == OK)
+	return code < 0 ? BGW_KILLED : code;
+    return BGW_UNKNOWN;
+}
+
 /*
  * Check for CTRL-C typed by reading all available characters.
  * In cooked mode we should get SIGINT, no need to check.
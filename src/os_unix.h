@@ -524,7 +524,20 @@ int mch_rename __ARGS((const char *src, const char *dest));
 # endif
 #endif
 
+#ifdef HAVE_WRITEV
+# include <sys/uio.h>		/* for writev() */
+#endif
+
 #define HAVE_DUP		/* have dup() */
+
+/* Result of a write done in the background, see mch_write_bg(). */
+#define BGW_OK		0	/* file was written and renamed */
+#define BGW_WRITE	1	/* write() failed */
+#define BGW_FSYNC	2	/* fsync() failed */
+#define BGW_CLOSE	3	/* close() failed */
+#define BGW_RENAME	4	/* rename() failed */
+#define BGW_KILLED	5	/* process did not exit normally */
+#define BGW_UNKNOWN	6	/* exit status was lost */
 #define HAVE_ST_MODE		/* have stat.st_mode */
 
 /* We have three kinds of ACL support. */
@@ -18,6 +18,7 @@ extern buf_T *buflist_findname __ARGS((char_u *ffname));
 extern int buflist_findpat __ARGS((char_u *pattern, char_u *pattern_end, int unlisted, int diffmode));
 extern int ExpandBufnames __ARGS((char_u *pat, int *num_file, char_u ***file, int options));
 extern buf_T *buflist_findnr __ARGS((int nr));
+extern void buf_hash_update __ARGS((buf_T *buf));
 extern char_u *buflist_nr2name __ARGS((int n, int fullname, int helptail));
 extern void get_winopts __ARGS((buf_T *buf));
 extern pos_T *buflist_findfpos __ARGS((buf_T *buf));
@@ -37,7 +38,8 @@ extern void fileinfo __ARGS((int fullname, int shorthelp, int dont_truncate));
 extern void col_print __ARGS((char_u *buf, int col, int vcol));
 extern void maketitle __ARGS((void));
 extern void resettitle __ARGS((void));
-extern int build_stl_str_hl __ARGS((win_T *wp, char_u *out, size_t outlen, char_u *fmt, int fillchar, int maxwidth, struct stl_hlrec *hl));
+extern void stl_clear_cache __ARGS((stl_cache_T *cache));
+extern int build_stl_str_hl __ARGS((win_T *wp, char_u *out, size_t outlen, char_u *fmt, int fillchar, int maxwidth, struct stl_hlrec *hl, stl_cache_T *cache));
 extern void get_rel_pos __ARGS((win_T *wp, char_u *str));
 extern int append_arg_number __ARGS((win_T *wp, char_u *buf, int add_file, int maxlen));
 extern char_u *fix_fname __ARGS((char_u *fname));
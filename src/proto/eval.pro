@@ -52,6 +52,12 @@ extern char_u *get_return_cmd __ARGS((void *retvar));
 extern char_u *get_func_line __ARGS((int c, void *cookie, int indent));
 extern int func_has_ended __ARGS((void *cookie));
 extern int func_has_abort __ARGS((void *cookie));
+extern void prof_child_enter __ARGS((proftime_T *tm));
+extern void prof_child_exit __ARGS((proftime_T *tm));
+extern void func_line_start __ARGS((void *cookie));
+extern void func_line_exec __ARGS((void *cookie));
+extern void func_line_end __ARGS((void *cookie));
+extern void func_dump_profile __ARGS((FILE *fd));
 extern int read_viminfo_varlist __ARGS((vir_T *virp, int writing));
 extern void write_viminfo_varlist __ARGS((FILE *fp));
 extern int store_session_globals __ARGS((FILE *fd));
@@ -8,7 +8,23 @@ extern void ex_debuggreedy __ARGS((exarg_T *eap));
 extern void ex_breakdel __ARGS((exarg_T *eap));
 extern void ex_breaklist __ARGS((exarg_T *eap));
 extern linenr_T dbg_find_breakpoint __ARGS((int file, char_u *fname, linenr_T after));
+extern int has_profiling __ARGS((int file, char_u *fname, int *fp));
 extern void dbg_breakpoint __ARGS((char_u *name, linenr_T lnum));
+extern void profile_zero __ARGS((proftime_T *tm));
+extern void profile_start __ARGS((proftime_T *tm));
+extern void profile_end __ARGS((proftime_T *tm));
+extern void profile_sub __ARGS((proftime_T *tm, proftime_T *tm2));
+extern void profile_add __ARGS((proftime_T *tm, proftime_T *tm2));
+extern void profile_self __ARGS((proftime_T *self, proftime_T *total, proftime_T *children));
+extern void profile_get_wait __ARGS((proftime_T *tm));
+extern void profile_sub_wait __ARGS((proftime_T *tm, proftime_T *tma));
+extern int profile_equal __ARGS((proftime_T *tm1, proftime_T *tm2));
+extern int profile_cmp __ARGS((proftime_T *tm1, proftime_T *tm2));
+extern char *profile_msg __ARGS((proftime_T *tm));
+extern void ex_profile __ARGS((exarg_T *eap));
+extern void profile_dump __ARGS((void));
+extern void prof_inchar_enter __ARGS((void));
+extern void prof_inchar_exit __ARGS((void));
 extern int autowrite __ARGS((buf_T *buf, int forceit));
 extern void autowrite_all __ARGS((void));
 extern int check_changed __ARGS((buf_T *buf, int checkaw, int mult_win, int forceit, int allbuf));
@@ -43,6 +59,12 @@ extern int *source_dbg_tick __ARGS((void *cookie));
 extern int source_level __ARGS((void *cookie));
 extern int do_source __ARGS((char_u *fname, int check_other, int is_vimrc));
 extern void ex_scriptnames __ARGS((exarg_T *eap));
+extern void script_prof_save __ARGS((proftime_T *tm));
+extern void script_prof_restore __ARGS((proftime_T *tm));
+extern void script_line_start __ARGS((void));
+extern void script_line_exec __ARGS((void));
+extern void script_line_end __ARGS((void));
+extern int prof_def_func __ARGS((void));
 extern void scriptnames_slash_adjust __ARGS((void));
 extern char_u *get_scriptname __ARGS((scid_T id));
 extern char *fgets_cr __ARGS((char *s, int n, FILE *stream));
@@ -3,6 +3,10 @@ extern void filemess __ARGS((buf_T *buf, char_u *name, char_u *s, int attr));
 extern int readfile __ARGS((char_u *fname, char_u *sfname, linenr_T from, linenr_T lines_to_skip, linenr_T lines_to_read, exarg_T *eap, int flags));
 extern int prep_exarg __ARGS((exarg_T *eap, buf_T *buf));
 extern int buf_write __ARGS((buf_T *buf, char_u *fname, char_u *sfname, linenr_T start, linenr_T end, exarg_T *eap, int append, int forceit, int reset_changed, int filtering));
+extern int bgwrite_busy __ARGS((buf_T *buf));
+extern int bgwrite_check __ARGS((buf_T *buf, int wait));
+extern void bgwrite_wait_file __ARGS((char_u *fname));
+extern void bgwrite_wait_cmd __ARGS((char_u *cmd));
 extern char_u *shorten_fname __ARGS((char_u *full_path, char_u *dir_name));
 extern void shorten_fnames __ARGS((int force));
 extern void shorten_filenames __ARGS((char_u **fnames, int count));
@@ -33,7 +37,7 @@ extern char_u *get_augroup_name __ARGS((expand_T *xp, int idx));
 extern char_u *set_context_in_autocmd __ARGS((expand_T *xp, char_u *arg, int doautocmd));
 extern char_u *get_event_name __ARGS((expand_T *xp, int idx));
 extern int au_exists __ARGS((char_u *name, char_u *name_end, char_u *pattern));
-extern int match_file_pat __ARGS((char_u *pattern, char_u *fname, char_u *sfname, char_u *tail, int allow_dirs));
+extern int match_file_pat __ARGS((char_u *pattern, regprog_T **prog, char_u *fname, char_u *sfname, char_u *tail, int allow_dirs));
 extern int match_file_list __ARGS((char_u *list, char_u *sfname, char_u *ffname));
 extern char_u *file_pat_to_reg_pat __ARGS((char_u *pat, char_u *pat_end, char *allow_dirs, int no_bslash));
 /* vim: set ft=c : */
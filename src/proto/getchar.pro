@@ -40,6 +40,7 @@ extern int vpeekc_nomap __ARGS((void));
 extern int vpeekc_any __ARGS((void));
 extern int char_avail __ARGS((void));
 extern void vungetc __ARGS((int c));
+extern int get_bracketed_paste __ARGS((garray_T *gap));
 extern int inchar __ARGS((char_u *buf, int maxlen, long wait_time, int tb_change_cnt));
 extern int fix_input_buffer __ARGS((char_u *buf, int len, int script));
 extern int input_available __ARGS((void));
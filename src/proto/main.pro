@@ -6,7 +6,7 @@ extern int process_env __ARGS((char_u *env, int is_viminit));
 extern void mainerr_arg_missing __ARGS((char_u *str));
 extern void time_push __ARGS((void *tv_rel, void *tv_start));
 extern void time_pop __ARGS((void *tp));
-extern void time_msg __ARGS((char *msg, void *tv_start));
+extern void time_msg __ARGS((char *kind, char *msg, void *tv_start));
 extern void server_to_input_buf __ARGS((char_u *str));
 extern char_u *eval_client_expr_to_string __ARGS((char_u *expr));
 extern int toF_TyA __ARGS((int c));
@@ -9,9 +9,11 @@ extern bhdr_T *mf_get __ARGS((memfile_T *mfp, blocknr_T nr, int page_count));
 extern void mf_put __ARGS((memfile_T *mfp, bhdr_T *hp, int dirty, int infile));
 extern void mf_free __ARGS((memfile_T *mfp, bhdr_T *hp));
 extern int mf_sync __ARGS((memfile_T *mfp, int flags));
+extern int mf_flush __ARGS((memfile_T **mfps, int count));
 extern int mf_release_all __ARGS((void));
 extern blocknr_T mf_trans_del __ARGS((memfile_T *mfp, blocknr_T old_nr));
 extern void mf_set_ffname __ARGS((memfile_T *mfp));
 extern void mf_fullname __ARGS((memfile_T *mfp));
 extern int mf_need_trans __ARGS((memfile_T *mfp));
+extern void ex_swapstats __ARGS((exarg_T *eap));
 /* vim: set ft=c : */
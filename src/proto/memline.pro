@@ -19,6 +19,7 @@ extern char_u *ml_get_cursor __ARGS((void));
 extern char_u *ml_get_buf __ARGS((buf_T *buf, linenr_T lnum, int will_change));
 extern int ml_line_alloced __ARGS((void));
 extern int ml_append __ARGS((linenr_T lnum, char_u *line, colnr_T len, int newfile));
+extern int ml_append_lines __ARGS((linenr_T lnum, char_u **lines, colnr_T *lens, long count, int newfile));
 extern int ml_replace __ARGS((linenr_T lnum, char_u *line, int copy));
 extern int ml_delete __ARGS((linenr_T lnum, int message));
 extern void ml_setmarked __ARGS((linenr_T lnum));
@@ -50,6 +50,9 @@ extern int mch_get_shellsize __ARGS((void));
 extern void mch_set_shellsize __ARGS((void));
 extern void mch_new_shellsize __ARGS((void));
 extern int mch_call_shell __ARGS((char_u *cmd, int options));
+extern int mch_write_tmp __ARGS((int fd, char_u *text, long len, char_u *tmpname, char_u *fname));
+extern int mch_write_bg __ARGS((int fd, char_u *text, long len, char_u *tmpname, char_u *fname, long *pidp));
+extern int mch_write_bg_done __ARGS((long pid, char_u *tmpname, int wait));
 extern void mch_breakcheck __ARGS((void));
 extern int mch_expandpath __ARGS((garray_T *gap, char_u *path, int flags));
 extern int mch_expand_wildcards __ARGS((int num_pat, char_u **pat, int *num_file, char_u ***file, int flags));
@@ -4,6 +4,8 @@ extern int re_lookbehind __ARGS((regprog_T *prog));
 extern char_u *skip_regexp __ARGS((char_u *startp, int dirc, int magic, char_u **newp));
 extern regprog_T *vim_regcomp __ARGS((char_u *expr, int re_flags));
 extern int vim_regcomp_had_eol __ARGS((void));
+extern void free_regcache __ARGS((void));
+extern regprog_T *vim_regcomp_cached __ARGS((char_u *expr, int re_flags));
 extern int vim_regexec __ARGS((regmatch_T *rmp, char_u *line, colnr_T col));
 extern int vim_regexec_nl __ARGS((regmatch_T *rmp, char_u *line, colnr_T col));
 extern long vim_regexec_multi __ARGS((regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum, colnr_T col));
@@ -5,11 +5,14 @@ extern void redraw_later_clear __ARGS((void));
 extern void redraw_all_later __ARGS((int type));
 extern void redraw_curbuf_later __ARGS((int type));
 extern void redraw_buf_later __ARGS((buf_T *buf, int type));
+extern void redraw_win_range __ARGS((win_T *wp, linenr_T top, linenr_T bot));
+extern void redraw_all_lines_later __ARGS((void));
 extern void redrawWinline __ARGS((linenr_T lnum, int invalid));
 extern void update_curbuf __ARGS((int type));
 extern void update_screen __ARGS((int type));
 extern void update_debug_sign __ARGS((buf_T *buf, linenr_T lnum));
 extern void updateWindow __ARGS((win_T *wp));
+extern void ex_screenstats __ARGS((exarg_T *eap));
 extern void status_redraw_all __ARGS((void));
 extern void status_redraw_curbuf __ARGS((void));
 extern void redraw_statuslines __ARGS((void));
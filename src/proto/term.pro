@@ -9,6 +9,8 @@ extern int term_is_gui __ARGS((char_u *name));
 extern char_u *tltoa __ARGS((unsigned long i));
 extern void termcapinit __ARGS((char_u *name));
 extern void out_flush __ARGS((void));
+extern void out_frame_start __ARGS((void));
+extern void out_frame_end __ARGS((void));
 extern void out_flush_check __ARGS((void));
 extern void out_trash __ARGS((void));
 extern void out_char __ARGS((unsigned c));
@@ -16,6 +18,8 @@ extern void out_str_nf __ARGS((char_u *s));
 extern void out_str __ARGS((char_u *s));
 extern void term_windgoto __ARGS((int row, int col));
 extern void term_cursor_right __ARGS((int i));
+extern int term_windgoto_len __ARGS((int row, int col));
+extern int term_cursor_right_len __ARGS((int i));
 extern void term_append_lines __ARGS((int line_count));
 extern void term_delete_lines __ARGS((int line_count));
 extern void term_set_winpos __ARGS((int x, int y));
@@ -6,8 +6,10 @@ extern int u_inssub __ARGS((linenr_T lnum));
 extern int u_savedel __ARGS((linenr_T lnum, long nlines));
 extern void u_undo __ARGS((int count));
 extern void u_redo __ARGS((int count));
+extern void u_undo_to __ARGS((long target));
 extern void u_sync __ARGS((void));
 extern void u_unchanged __ARGS((buf_T *buf));
+extern void ex_undolist __ARGS((exarg_T *eap));
 extern void u_clearall __ARGS((buf_T *buf));
 extern void u_saveline __ARGS((linenr_T lnum));
 extern void u_clearline __ARGS((void));
@@ -1737,20 +1737,12 @@ qf_win_pos_update(old_qf_index)
 
 	curwin = win;
 	curbuf = win->w_buffer;
-	if (qf_index > old_qf_index)
-	{
-	    curwin->w_redraw_top = old_qf_index;
-	    curwin->w_redraw_bot = qf_index;
-	}
-	else
-	{
-	    curwin->w_redraw_top = qf_index;
-	    curwin->w_redraw_bot = old_qf_index;
-	}
+	/* Only the old and the new current line change highlighting. */
+	redraw_win_range(curwin, old_qf_index, old_qf_index);
+	redraw_win_range(curwin, qf_index, qf_index);
 	curwin->w_cursor.lnum = qf_index;
 	curwin->w_cursor.col = 0;
 	update_topline();		/* scroll to show the line */
-	redraw_later(VALID);
 	curwin->w_redr_status = TRUE;	/* update ruler */
 	curwin = old_curwin;
 	curbuf = curwin->w_buffer;
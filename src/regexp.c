@@ -626,6 +626,7 @@ static long	brace_max[10];	/* Maximums for complex brace repeats */
 static int	brace_count[10]; /* Current counts for complex brace repeats */
 #if defined(FEAT_SYN_HL) || defined(PROTO)
 static int	had_eol;	/* TRUE when EOL found by vim_regcomp() */
+static int	had_prev_sub;	/* TRUE when "~" used by vim_regcomp() */
 #endif
 static int	one_exactly = FALSE;	/* only do one char for EXACTLY */
 
@@ -964,6 +965,7 @@ regcomp_start(expr, re_flags)
     regflags = 0;
 #if defined(FEAT_SYN_HL) || defined(PROTO)
     had_eol = FALSE;
+    had_prev_sub = FALSE;
 #endif
 }
 
@@ -977,6 +979,187 @@ vim_regcomp_had_eol()
 {
     return had_eol;
 }
+
+/*
+ * Cache of compiled programs for syntax patterns.  Every buffer has its own
+ * syntax items, thus each buffer with the same filetype sources the same
+ * syntax file and compiles the same patterns again; compiling is most of the
+ * time spent on sourcing a syntax file.  A compiled program is one block of
+ * memory, a copy of it can be used instead of compiling again.
+ * The cache is only kept in memory.  Script lines are not cached on disk:
+ * reading and splitting them is only a tiny part of sourcing a script.
+ * The result of compiling also depends on "re_flags", reg_do_extmatch, the
+ * 'l' flag in 'cpoptions' and 'encoding'.  Patterns using "~" are not cached,
+ * they depend on the previous substitute string.  When the cache gets too
+ * big it is cleared.
+ */
+typedef struct regcache_S regcache_T;
+
+struct regcache_S
+{
+    regcache_T	*rc_next;	/* next entry with the same hash */
+    unsigned	rc_hash;	/* hash of rc_expr */
+    int		rc_flags;	/* "re_flags" argument of vim_regcomp() */
+    int		rc_extmatch;	/* reg_do_extmatch when compiled */
+    int		rc_cpo_lit;	/* 'cpoptions' contained 'l' when compiled */
+    int		rc_had_eol;	/* had_eol after compiling */
+    long	rc_size;	/* size of rc_prog */
+    char_u	*rc_expr;	/* the pattern */
+    regprog_T	*rc_prog;	/* the compiled program */
+};
+
+#define REGCACHE_SIZE	512		/* nr of hash buckets, power of two */
+#define REGCACHE_MAXMEM	(1024L * 1024L)	/* max bytes used for programs */
+
+static regcache_T	**regcache = NULL;
+static long		regcache_mem = 0;	/* bytes used by the cache */
+static char_u		*regcache_enc = NULL;	/* 'encoding' of the cache */
+
+static regprog_T *regcache_copy __ARGS((regprog_T *prog, long size));
+static void regcache_clear __ARGS((void));
+
+/*
+ * Return an allocated copy of compiled program "prog" of "size" bytes.
+ */
+    static regprog_T *
+regcache_copy(prog, size)
+    regprog_T	*prog;
+    long	size;
+{
+    regprog_T	*r;
+
+    r = (regprog_T *)lalloc(size, TRUE);
+    if (r != NULL)
+    {
+	mch_memmove(r, prog, (size_t)size);
+	/* regmust points into the program */
+	if (prog->regmust != NULL)
+	    r->regmust = r->program + (prog->regmust - prog->program);
+    }
+    return r;
+}
+
+/*
+ * Free all entries in the cache of compiled syntax patterns.
+ */
+    static void
+regcache_clear()
+{
+    int		i;
+    regcache_T	*rc;
+
+    if (regcache == NULL)
+	return;
+    for (i = 0; i < REGCACHE_SIZE; ++i)
+	while (regcache[i] != NULL)
+	{
+	    rc = regcache[i];
+	    regcache[i] = rc->rc_next;
+	    vim_free(rc->rc_prog);
+	    vim_free(rc);
+	}
+    regcache_mem = 0;
+}
+
+/*
+ * Free the cache of compiled syntax patterns and the memory it uses.
+ */
+    void
+free_regcache()
+{
+    regcache_clear();
+    vim_free(regcache);
+    regcache = NULL;
+    vim_free(regcache_enc);
+    regcache_enc = NULL;
+}
+
+/*
+ * Like vim_regcomp(), but use the cache of compiled syntax patterns.
+ * Also sets what vim_regcomp_had_eol() returns, like vim_regcomp().
+ */
+    regprog_T *
+vim_regcomp_cached(expr, re_flags)
+    char_u	*expr;
+    int		re_flags;
+{
+    unsigned	hash = 0;
+    char_u	*p;
+    regcache_T	*rc;
+    regprog_T	*prog;
+    long	size;
+    int		len;
+    int		cpo_lit;
+
+    if (expr == NULL)
+	return vim_regcomp(expr, re_flags);
+    cpo_lit = (!reg_syn && vim_strchr(p_cpo, CPO_LITERAL) != NULL);
+
+    /* The compiled program depends on the encoding. */
+    if (regcache_enc == NULL || STRCMP(regcache_enc, p_enc) != 0)
+    {
+	regcache_clear();
+	vim_free(regcache_enc);
+	regcache_enc = vim_strsave(p_enc);
+	if (regcache_enc == NULL)
+	    return vim_regcomp(expr, re_flags);
+    }
+    if (regcache == NULL)
+    {
+	regcache = (regcache_T **)alloc_clear(
+			       (unsigned)(REGCACHE_SIZE * sizeof(regcache_T *)));
+	if (regcache == NULL)
+	    return vim_regcomp(expr, re_flags);
+    }
+
+    for (p = expr; *p != NUL; ++p)
+	hash = hash * 33 + *p;
+    len = (int)(p - expr);
+
+    for (rc = regcache[hash & (REGCACHE_SIZE - 1)]; rc != NULL;
+							       rc = rc->rc_next)
+	if (rc->rc_hash == hash
+		&& rc->rc_flags == re_flags
+		&& rc->rc_extmatch == reg_do_extmatch
+		&& rc->rc_cpo_lit == cpo_lit
+		&& STRCMP(rc->rc_expr, expr) == 0)
+	{
+	    had_eol = rc->rc_had_eol;
+	    return regcache_copy(rc->rc_prog, rc->rc_size);
+	}
+
+    prog = vim_regcomp(expr, re_flags);
+    if (prog == NULL || had_prev_sub)
+	return prog;
+
+    /* Remember a copy of the program.  regcode points to the end of the
+     * emitted code. */
+    size = (long)sizeof(regprog_T) + (long)(regcode - prog->program);
+    if (regcache_mem + size + len > REGCACHE_MAXMEM)
+	regcache_clear();
+    rc = (regcache_T *)alloc((unsigned)(sizeof(regcache_T) + len + 1));
+    if (rc == NULL)
+	return prog;
+    rc->rc_prog = regcache_copy(prog, size);
+    if (rc->rc_prog == NULL)
+    {
+	vim_free(rc);
+	return prog;
+    }
+    rc->rc_expr = (char_u *)(rc + 1);
+    STRCPY(rc->rc_expr, expr);
+    rc->rc_hash = hash;
+    rc->rc_flags = re_flags;
+    rc->rc_extmatch = reg_do_extmatch;
+    rc->rc_cpo_lit = cpo_lit;
+    rc->rc_had_eol = had_eol;
+    rc->rc_size = size;
+    rc->rc_next = regcache[hash & (REGCACHE_SIZE - 1)];
+    regcache[hash & (REGCACHE_SIZE - 1)] = rc;
+    regcache_mem += size + len;
+
+    return prog;
+}
 #endif
 
 /*
@@ -1540,6 +1723,9 @@ regatom(flagp)
 	/* NOTREACHED */
 
       case Magic('~'):		/* previous substitute pattern */
+#ifdef FEAT_SYN_HL
+	    had_prev_sub = TRUE;
+#endif
 	    if (reg_prev_sub)
 	    {
 		char_u	    *lp;
@@ -61,6 +61,10 @@
  * can remain displayed as it is.  Text after the change may need updating for
  * scrolling, folding and syntax highlighting.
  *
+ * Commands that only change how some lines are highlighted, without changing
+ * the number of screen lines they take, call redraw_win_range() for those
+ * lines.  Only these lines are drawn again, the rest of the window is kept.
+ *
  * Commands that change how a window is displayed (e.g., setting 'list') or
  * invalidate the contents of a window in another way (e.g., change fold
  * settings), must call redraw_later(NOT_VALID) to have the whole window
@@ -94,6 +98,13 @@ static int	screen_attr = 0;
  */
 static int	screen_cur_row, screen_cur_col;	/* last known cursor position */
 
+/*
+ * Counters for screen updating, reported by ":screenstats".
+ */
+static long	stat_updates = 0;	/* nr of times update_screen() drew */
+static long	stat_rows = 0;		/* total nr of screen rows drawn */
+static long	stat_last_rows = 0;	/* rows drawn by last update_screen() */
+
 #ifdef FEAT_SEARCH_EXTRA
 /*
  * Struct used for highlighting 'hlsearch' matches for the last use search
@@ -156,6 +167,9 @@ static void prepare_search_hl __ARGS((win_T *wp, linenr_T lnum));
 static void next_search_hl __ARGS((win_T *win, match_T *shl, linenr_T lnum, colnr_T mincol));
 #endif
 static void screen_start_highlight __ARGS((int attr));
+static int attr_parts __ARGS((int attr, int *flags, int *fg, int *bg));
+static int hl_flags_len __ARGS((int flags));
+static int screen_delta_highlight __ARGS((int attr));
 static void screen_char __ARGS((unsigned off, int row, int col));
 #ifdef FEAT_MBYTE
 static void screen_char_2 __ARGS((unsigned off, int row, int col));
@@ -266,6 +280,81 @@ redraw_buf_later(buf, type)
     }
 }
 
+/*
+ * Mark buffer lines "top" to "bot" in window "wp" to be drawn again later,
+ * without anything else changing: the number of screen lines each of them
+ * occupies stays the same and nothing has to be scrolled.  Other lines in the
+ * window are left alone, also when they are in between two ranges.  Use
+ * MAXLNUM for "bot" to include all lines from "top" until the end.
+ */
+    void
+redraw_win_range(wp, top, bot)
+    win_T	*wp;
+    linenr_T	top;
+    linenr_T	bot;
+{
+    damage_T	*dp;
+    int		i;
+
+    /* Merge with a range that overlaps or touches the new one. */
+    for (i = 0; i < wp->w_damage_len; ++i)
+    {
+	dp = &wp->w_damage[i];
+	if (top <= dp->dr_bot + 1 && (bot == MAXLNUM || bot + 1 >= dp->dr_top))
+	    break;
+    }
+    if (i == wp->w_damage_len && wp->w_damage_len < DAMAGE_LEN)
+    {
+	dp = &wp->w_damage[wp->w_damage_len++];
+	dp->dr_top = top;
+	dp->dr_bot = bot;
+    }
+    else
+    {
+	/* When out of entries extend the last range to include the new one,
+	 * the lines in between are drawn as well. */
+	dp = &wp->w_damage[i < wp->w_damage_len ? i : DAMAGE_LEN - 1];
+	if (dp->dr_top > top)
+	    dp->dr_top = top;
+	if (dp->dr_bot < bot)
+	    dp->dr_bot = bot;
+    }
+    redraw_win_later(wp, VALID);
+}
+
+/*
+ * Mark the text in all windows to be drawn again later, keeping the window
+ * layout.  Used when highlighting changed in a way that doesn't change the
+ * size of lines, e.g., for 'hlsearch'.
+ */
+    void
+redraw_all_lines_later()
+{
+    win_T	*wp;
+
+    FOR_ALL_WINDOWS(wp)
+	redraw_win_range(wp, (linenr_T)1, MAXLNUM);
+}
+
+/*
+ * Return TRUE if any of buffer lines "top" to "bot" is in one of the "len"
+ * damaged ranges at "dp".
+ */
+    static int
+lines_damaged(dp, len, top, bot)
+    damage_T	*dp;
+    int		len;
+    linenr_T	top;
+    linenr_T	bot;
+{
+    int		i;
+
+    for (i = 0; i < len; ++i)
+	if (dp[i].dr_top <= bot && dp[i].dr_bot >= top)
+	    return TRUE;
+    return FALSE;
+}
+
 /*
  * Changed something in the current window, at buffer line "lnum", that
  * requires that line and possibly other lines to be redrawn.
@@ -284,21 +373,25 @@ redrawWinline(lnum, invalid)
     int		i;
 #endif
 
-    if (curwin->w_redraw_top == 0 || curwin->w_redraw_top > lnum)
-	curwin->w_redraw_top = lnum;
-    if (curwin->w_redraw_bot == 0 || curwin->w_redraw_bot < lnum)
-	curwin->w_redraw_bot = lnum;
-    redraw_later(VALID);
-
 #ifdef FEAT_FOLDING
     if (invalid)
     {
+	/* The line may take a different number of screen lines now, let
+	 * win_update() find out if the lines below it need to move. */
+	if (curwin->w_redraw_top == 0 || curwin->w_redraw_top > lnum)
+	    curwin->w_redraw_top = lnum;
+	if (curwin->w_redraw_bot == 0 || curwin->w_redraw_bot < lnum)
+	    curwin->w_redraw_bot = lnum;
+	redraw_later(VALID);
+
 	/* A w_lines[] entry for this lnum has become invalid. */
 	i = find_wl_entry(curwin, lnum);
 	if (i >= 0)
 	    curwin->w_lines[i].wl_valid = FALSE;
     }
+    else
 #endif
+	redraw_win_range(curwin, lnum, lnum);
 }
 
 /*
@@ -356,6 +449,11 @@ update_screen(type)
     ++display_tick;	    /* let syntax code know we're in a next round of
 			     * display updating */
 #endif
+    FOR_ALL_WINDOWS(wp)
+	wp->w_drawn_rows = 0;
+
+    /* Collect the output, to write it all at once at the end. */
+    out_frame_start();
 
     /*
      * if the screen was scrolled up when displaying a message, scroll it down
@@ -517,6 +615,12 @@ update_screen(type)
     end_search_hl();
 #endif
 
+    ++stat_updates;
+    stat_last_rows = 0;
+    FOR_ALL_WINDOWS(wp)
+	stat_last_rows += wp->w_drawn_rows;
+    stat_rows += stat_last_rows;
+
 #ifdef FEAT_WINDOWS
     /* Reset b_mod_set flags.  Going through all windows is probably faster
      * than going through all buffers (there could be many buffers). */
@@ -557,6 +661,8 @@ update_screen(type)
 	gui_update_scrollbars(FALSE);
     }
 #endif
+
+    out_frame_end();
 }
 
 #if defined(FEAT_SIGNS) || defined(FEAT_GUI)
@@ -632,13 +738,7 @@ update_debug_sign(buf, lnum)
 	{
 	    if (wp->w_buffer == buf && lnum >= wp->w_topline
 						      && lnum < wp->w_botline)
-	    {
-		if (wp->w_redraw_top == 0 || wp->w_redraw_top > lnum)
-		    wp->w_redraw_top = lnum;
-		if (wp->w_redraw_bot == 0 || wp->w_redraw_bot < lnum)
-		    wp->w_redraw_bot = lnum;
-		redraw_win_later(wp, VALID);
-	    }
+		redraw_win_range(wp, lnum, lnum);
 	}
 	else
 	    redraw_win_later(wp, VALID);
@@ -703,6 +803,42 @@ updateWindow(wp)
 }
 #endif
 
+/*
+ * ":screenstats": list how many screen rows were drawn.
+ * ":screenstats!": reset the counters.
+ */
+    void
+ex_screenstats(eap)
+    exarg_T	*eap;
+{
+    win_T	*wp;
+    int		nr = 0;
+
+    if (eap->forceit)
+    {
+	stat_updates = 0;
+	stat_rows = 0;
+	stat_last_rows = 0;
+	out_bytes = 0;
+	out_writes = 0;
+	out_frame_bytes = 0;
+	out_frame_writes = 0;
+	return;
+    }
+    smsg((char_u *)_("Screen updates: %ld, rows drawn: %ld"),
+						      stat_updates, stat_rows);
+    smsg((char_u *)_("Output: %ld bytes in %ld writes"),
+						       out_bytes, out_writes);
+    smsg((char_u *)_("Last update: %ld rows, %ld bytes in %ld writes"),
+			  stat_last_rows, out_frame_bytes, out_frame_writes);
+    FOR_ALL_WINDOWS(wp)
+    {
+	if (got_int)
+	    break;
+	smsg((char_u *)_("  window %d: %d rows"), ++nr, wp->w_drawn_rows);
+    }
+}
+
 /*
  * Update a single window.
  *
@@ -722,6 +858,8 @@ updateWindow(wp)
  *		     b_mod_top and b_mod_bot.
  *		   - if wp->w_redraw_top non-zero, redraw lines between
  *		     wp->w_redraw_top and wp->w_redr_bot.
+ *		   - redraw lines in the wp->w_damage[] ranges, without
+ *		     scrolling anything.
  *		   - continue redrawing when syntax status is invalid.
  *		4. if scrolled up, update lines at the bottom.
  * This results in three areas that may need updating:
@@ -776,12 +914,21 @@ win_update(wp)
 #endif
     linenr_T	mod_top = 0;
     linenr_T	mod_bot = 0;
+    damage_T	damage[DAMAGE_LEN];	/* copy of wp->w_damage[] */
+    int		damage_len;
+    linenr_T	lastlnum;
 #if defined(FEAT_SYN_HL) || defined(FEAT_SEARCH_EXTRA)
     int		save_got_int;
 #endif
 
     type = wp->w_redr_type;
 
+    /* Take over the damaged lines, new ones may be added while redrawing. */
+    damage_len = wp->w_damage_len;
+    if (damage_len > 0)
+	mch_memmove(damage, wp->w_damage, damage_len * sizeof(damage_T));
+    wp->w_damage_len = 0;
+
     if (type == NOT_VALID)
     {
 #ifdef FEAT_WINDOWS
@@ -822,14 +969,18 @@ win_update(wp)
     search_hl.first_lnum = 0;
 #endif
 
-    if (buf->b_mod_set && buf->b_mod_xlines != 0 && wp->w_redraw_top != 0)
+    if (buf->b_mod_set && buf->b_mod_xlines != 0
+				   && (wp->w_redraw_top != 0 || damage_len > 0))
     {
 	/*
 	 * When there are both inserted/deleted lines and specific lines to be
-	 * redrawn, w_redraw_top and w_redraw_bot may be invalid, just redraw
-	 * everything (only happens when redrawing is off for while).
+	 * redrawn, w_redraw_top, w_redraw_bot and w_damage[] may be invalid,
+	 * just redraw everything (only happens when redrawing is off for
+	 * while).
 	 */
 	type = NOT_VALID;
+	wp->w_redraw_top = 0;
+	wp->w_redraw_bot = 0;
     }
     else
     {
@@ -1408,6 +1559,14 @@ win_update(wp)
 	 * with.  It is used further down when the line doesn't fit. */
 	srow = row;
 
+	/* Last buffer line displayed in this row, for a closed fold. */
+	lastlnum = lnum;
+#ifdef FEAT_FOLDING
+	if (idx < wp->w_lines_valid && wp->w_lines[idx].wl_valid
+					    && wp->w_lines[idx].wl_lnum == lnum)
+	    lastlnum = wp->w_lines[idx].wl_lastlnum;
+#endif
+
 	/*
 	 * Update a line when it is in an area that needs updating, when it
 	 * has changes or w_lines[idx] is invalid.
@@ -1424,6 +1583,8 @@ win_update(wp)
 #endif
 		|| idx >= wp->w_lines_valid
 		|| (row + wp->w_lines[idx].wl_size > bot_start)
+		|| (damage_len > 0
+		    && lines_damaged(damage, damage_len, lnum, lastlnum))
 		|| (mod_top != 0
 		    && (lnum == mod_top
 			|| (lnum >= mod_top
@@ -1625,6 +1786,7 @@ win_update(wp)
 	    {
 		fold_line(wp, fold_count, &win_foldinfo, lnum, row);
 		++row;
+		++wp->w_drawn_rows;
 		--fold_count;
 		wp->w_lines[idx].wl_folded = TRUE;
 		wp->w_lines[idx].wl_lastlnum = lnum + fold_count;
@@ -1665,6 +1827,20 @@ win_update(wp)
 		 * Display one line.
 		 */
 		row = win_line(wp, lnum, srow, wp->w_height);
+		wp->w_drawn_rows += row - srow;
+
+		/* A damaged line is only expected to be drawn again.  If it
+		 * now takes a different number of screen lines, the lines
+		 * below it have moved: redraw them all. */
+		if (idx < wp->w_lines_valid
+			&& wp->w_lines[idx].wl_valid
+			&& wp->w_lines[idx].wl_lnum == lnum
+			&& row - srow != wp->w_lines[idx].wl_size
+			&& dollar_vcol == 0)
+		{
+		    mid_start = row;
+		    mid_end = wp->w_height;
+		}
 
 #ifdef FEAT_FOLDING
 		wp->w_lines[idx].wl_folded = FALSE;
@@ -5283,15 +5459,18 @@ win_redr_custom(wp, Ruler)
     char_u	buf[MAXPATHL];
     char_u	*p;
     struct	stl_hlrec hl[STL_MAX_ITEM];
+    stl_cache_T	*cache;
 
     /* setup environment for the task at hand */
     row = W_WINROW(wp) + wp->w_height;
     fillchar = fillchar_status(&attr, wp == curwin);
     maxwidth = W_WIDTH(wp);
     p = p_stl;
+    cache = &wp->w_stl_cache;
     if (Ruler)
     {
 	p = p_ruf;
+	cache = &wp->w_ruf_cache;
 	/* advance past any leading group spec - implicit in ru_col */
 	if (*p == '%')
 	{
@@ -5329,7 +5508,8 @@ win_redr_custom(wp, Ruler)
     col += W_WINCOL(wp);
 #endif
 
-    width = build_stl_str_hl(wp, buf, sizeof(buf), p, fillchar, maxwidth, hl);
+    width = build_stl_str_hl(wp, buf, sizeof(buf), p, fillchar, maxwidth, hl,
+									cache);
     len = STRLEN(buf);
 
     while (width < maxwidth && len < sizeof(buf) - 1)
@@ -5919,6 +6099,158 @@ screen_start_highlight(attr)
     }
 }
 
+/*
+ * Get the mode flags and the cterm colors used for highlight attribute
+ * "attr".  Colors are one more than the color number, zero for the terminal
+ * default; for zero the Normal color is used.
+ * Returns FAIL when "attr" is set with other codes, e.g., the start and stop
+ * strings of a term attribute.
+ */
+    static int
+attr_parts(attr, flags, fg, bg)
+    int		attr;
+    int		*flags;
+    int		*fg;
+    int		*bg;
+{
+    attrentry_T	*aep;
+
+    *fg = 0;
+    *bg = 0;
+    if (attr < 0)			/* unknown */
+	return FAIL;
+    if (attr <= HL_ALL)
+	*flags = attr;
+    else
+    {
+	if (t_colors <= 1)
+	    return FAIL;
+	aep = syn_cterm_attr2entry(attr);
+	if (aep == NULL)
+	    return FAIL;
+	*flags = aep->ae_attr;
+	*fg = aep->ae_u.cterm.fg_color;
+	*bg = aep->ae_u.cterm.bg_color;
+    }
+    if (*fg == 0)
+	*fg = cterm_normal_fg_color;
+    if (*bg == 0)
+	*bg = cterm_normal_bg_color;
+    return OK;
+}
+
+/*
+ * Return the number of bytes used to start the highlight mode "flags".
+ */
+    static int
+hl_flags_len(flags)
+    int		flags;
+{
+    int		len = 0;
+
+    if (flags & HL_BOLD)
+	len += (int)STRLEN(T_MD);
+    if (flags & HL_STANDOUT)
+	len += (int)STRLEN(T_SO);
+    if (flags & HL_UNDERLINE)
+	len += (int)STRLEN(T_US);
+    if (flags & HL_ITALIC)
+	len += (int)STRLEN(T_CZH);
+    if (flags & HL_INVERSE)
+	len += (int)STRLEN(T_MR);
+    return len;
+}
+
+#define COLOR_COST  5	/* assume setting a color takes 5 chars */
+
+/*
+ * Change highlighting from "screen_attr" to "attr" by only outputting what
+ * is different, instead of stopping all highlighting and starting the new
+ * one.  Often only the foreground color changes, then only that is output.
+ * Only possible when "attr" has the same or more mode flags, turning them
+ * off requires t_me, which also resets the colors.  Only done when it's
+ * cheaper than t_me followed by the codes for "attr".
+ * Returns FAIL when not done, nothing was output then.
+ */
+    static int
+screen_delta_highlight(attr)
+    int		attr;
+{
+    int		old_flags, old_fg, old_bg;
+    int		new_flags, new_fg, new_bg;
+    int		add;
+    int		do_op;
+    int		cost;
+    int		full_cost;
+
+    if (screen_attr == 0
+#ifdef FEAT_GUI
+	    || gui.in_use
+#endif
+	    || !full_screen
+	    || cterm_normal_fg_bold
+	    || attr_parts(screen_attr, &old_flags, &old_fg, &old_bg) == FAIL
+	    || attr_parts(attr, &new_flags, &new_fg, &new_bg) == FAIL
+	    || (old_flags & ~new_flags) != 0)
+	return FAIL;
+
+    /* Going back to the terminal default color needs t_op, it resets both
+     * colors. */
+    do_op = (old_fg != new_fg && new_fg == 0)
+				       || (old_bg != new_bg && new_bg == 0);
+    if (do_op && *T_OP == NUL)
+	return FAIL;
+
+    add = new_flags & ~old_flags;
+
+    /* When the terminal lacks the code for a mode, let the normal way of
+     * changing highlighting handle it. */
+    if (((add & HL_BOLD) && *T_MD == NUL)
+	    || ((add & HL_STANDOUT) && *T_SO == NUL)
+	    || ((add & HL_UNDERLINE) && *T_US == NUL)
+	    || ((add & HL_ITALIC) && *T_CZH == NUL)
+	    || ((add & HL_INVERSE) && *T_MR == NUL))
+	return FAIL;
+
+    /* Compare the cost with stopping and starting highlighting. */
+    full_cost = (int)STRLEN(T_ME) + hl_flags_len(new_flags)
+		  + (new_fg != 0 ? COLOR_COST : 0) + (new_bg != 0 ? COLOR_COST : 0);
+    cost = hl_flags_len(add);
+    if (do_op)
+	cost += (int)STRLEN(T_OP) + (new_fg != 0 ? COLOR_COST : 0)
+					       + (new_bg != 0 ? COLOR_COST : 0);
+    else
+	cost += (new_fg != old_fg || (add != 0 && new_fg != 0) ? COLOR_COST : 0)
+	      + (new_bg != old_bg || (add != 0 && new_bg != 0) ? COLOR_COST : 0);
+    if (cost >= full_cost)
+	return FAIL;
+    if (add & HL_BOLD)
+	out_str(T_MD);
+    if (add & HL_STANDOUT)
+	out_str(T_SO);
+    if (add & HL_UNDERLINE)
+	out_str(T_US);
+    if (add & HL_ITALIC)
+	out_str(T_CZH);
+    if (add & HL_INVERSE)
+	out_str(T_MR);
+
+    if (do_op)
+    {
+	out_str(T_OP);
+	old_fg = 0;
+	old_bg = 0;
+    }
+    /* Output colors after bold etc., in case these override the color. */
+    if (new_fg != 0 && (new_fg != old_fg || add != 0))
+	term_fg_color(new_fg - 1);
+    if (new_bg != 0 && (new_bg != old_bg || add != 0))
+	term_bg_color(new_bg - 1);
+
+    screen_attr = attr;
+    return OK;
+}
+
       void
 screen_stop_highlight()
 {
@@ -6070,7 +6402,9 @@ screen_char(off, row, col)
     }
 
     /*
-     * Stop highlighting first, so it's easier to move the cursor.
+     * Stop highlighting first, so it's easier to move the cursor.  Not when
+     * the cursor can stay in highlight mode and the change can be done with
+     * fewer codes.
      */
 #if defined(FEAT_CLIPBOARD) || defined(FEAT_VERTSPLIT)
     if (screen_char_attr != 0)
@@ -6078,7 +6412,10 @@ screen_char(off, row, col)
     else
 #endif
 	attr = ScreenAttrs[off];
-    if (screen_attr != attr)
+    if (screen_attr != attr
+	    && ((*T_MS == NUL && (row != screen_cur_row
+						   || col != screen_cur_col))
+		|| screen_delta_highlight(attr) == FAIL))
 	screen_stop_highlight();
 
     windgoto(row, col);
@@ -6737,6 +7074,9 @@ screenclear2()
 	    )
 	return;
 
+#ifdef FEAT_STL_OPT
+    ++stl_tick;			/* compute status line items again */
+#endif
 #ifdef FEAT_GUI
     if (!gui.in_use)
 #endif
@@ -6904,13 +7244,15 @@ windgoto(row, col)
     int		    goto_cost;
     int		    attr;
 
-#define GOTO_COST   7	/* asssume a term_windgoto() takes about 7 chars */
 #define HIGHL_COST  5	/* assume unhighlight takes 5 chars */
 
 #define PLAN_LE	    1
 #define PLAN_CR	    2
 #define PLAN_NL	    3
 #define PLAN_WRITE  4
+#define PLAN_RI	    5	/* cursor right with t_RI */
+#define PLAN_CR_RI  6	/* CR, then t_RI */
+#define PLAN_NL_RI  7	/* NL, then t_RI */
     /* Can't use ScreenLines unless initialized */
     if (ScreenLines == NULL)
 	return;
@@ -6930,7 +7272,7 @@ windgoto(row, col)
 	    noinvcurs = HIGHL_COST;
 	else
 	    noinvcurs = 0;
-	goto_cost = GOTO_COST + noinvcurs;
+	goto_cost = term_windgoto_len(row, col) + noinvcurs;
 
 	/*
 	 * Plan how to do the positioning:
@@ -7129,9 +7471,53 @@ windgoto(row, col)
 	{
 	    if (noinvcurs)
 		screen_stop_highlight();
-	    if (row == screen_cur_row && (col > screen_cur_col) &&
-								*T_CRI != NUL)
+
+	    /*
+	     * Find the cheapest of:
+	     * - absolute positioning with t_cm
+	     * - moving right in the same row with t_RI
+	     * - CR or NLs to get to column zero, then t_RI
+	     */
+	    plan = 0;
+	    goto_cost -= noinvcurs;
+	    if (*T_CRI != NUL)
+	    {
+		if (row == screen_cur_row && col > screen_cur_col)
+		{
+		    cost = term_cursor_right_len(col - screen_cur_col);
+		    if (cost <= goto_cost)
+		    {
+			plan = PLAN_RI;
+			goto_cost = cost;
+		    }
+		}
+		if (row >= screen_cur_row && screen_cur_col < Columns
+								   && col > 0)
+		{
+		    cost = term_cursor_right_len(col);
+		    if (row == screen_cur_row)
+			cost += 1;			    /* CR */
+		    else
+			cost += (row - screen_cur_row) * 2; /* CR LF */
+		    if (cost < goto_cost)
+			plan = (row == screen_cur_row) ? PLAN_CR_RI : PLAN_NL_RI;
+		}
+	    }
+
+	    if (plan == PLAN_RI)
 		term_cursor_right(col - screen_cur_col);
+	    else if (plan == PLAN_CR_RI || plan == PLAN_NL_RI)
+	    {
+		if (plan == PLAN_CR_RI)
+		    out_char('\r');
+		else
+		    while (screen_cur_row < row)
+		    {
+			out_char('\n');
+			++screen_cur_row;
+		    }
+		term_cursor_right(col);
+	    }
 	    else
 		term_windgoto(row, col);
 	}
@@ -290,7 +290,7 @@ save_re_pat(idx, pat, magic)
 #ifdef FEAT_SEARCH_EXTRA
 	/* If 'hlsearch' set and search pat changed: need redraw. */
 	if (p_hls)
-	    redraw_all_later(NOT_VALID);
+	    redraw_all_lines_later();
 	no_hlsearch = FALSE;
 #endif
     }
@@ -441,7 +441,7 @@ set_last_search_pat(s, idx, magic, setlast)
 # ifdef FEAT_SEARCH_EXTRA
     /* If 'hlsearch' set and search pat changed: need redraw. */
     if (p_hls && idx == last_idx && !no_hlsearch)
-	redraw_all_later(NOT_VALID);
+	redraw_all_lines_later();
 # endif
 }
 #endif
@@ -984,7 +984,7 @@ do_search(oap, dirc, pat, count, options)
      */
     if (no_hlsearch && !(options & SEARCH_KEEP))
     {
-	redraw_all_later(NOT_VALID);
+	redraw_all_lines_later();
 	no_hlsearch = FALSE;
     }
 #endif
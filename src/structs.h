@@ -73,6 +73,12 @@ typedef struct wininfo	wininfo_T;
 typedef struct frame	frame_T;
 typedef int		scid_T;		/* script ID */
 
+#ifdef FEAT_PROFILE
+typedef struct timeval	proftime_T;	/* time used for profiling */
+#else
+typedef int		proftime_T;	/* dummy for function prototypes */
+#endif
+
 /*
  * This is here because gui.h needs the pos_T and win_T, and win_T needs gui.h
  * for scrollbar_T.
@@ -243,13 +249,37 @@ struct u_entry
     linenr_T	ue_bot;		/* number of line below undo block */
     linenr_T	ue_lcount;	/* linecount when u_save called */
     char_u	**ue_array;	/* array of lines in undo block */
+    char_u	*ue_delta;	/* when not NULL: TRUE for each line in
+				   ue_array that is stored as u_delta_T */
     long	ue_size;	/* number of lines in ue_array */
 };
 
+/*
+ * A line in an undo entry can be stored as the difference with the line that
+ * is in the buffer when the entry is used: the number of bytes at the start
+ * and at the end that are equal, plus the bytes in between.
+ */
+typedef struct u_delta
+{
+    colnr_T	ud_head;	/* nr of equal bytes at the start */
+    colnr_T	ud_tail;	/* nr of equal bytes at the end */
+    char_u	ud_text[1];	/* bytes in between, NUL terminated */
+} u_delta_T;
+
+/*
+ * The headers form a tree.  uh_next points to the parent: the change made
+ * before this one.  uh_prev points to the child that is used for redo.  Other
+ * changes made after undoing to the same state are alternates, linked with
+ * uh_alt_next and uh_alt_prev, the one used for redo is first in that list.
+ */
 struct u_header
 {
-    u_header_T	*uh_next;	/* pointer to next header in list */
-    u_header_T	*uh_prev;	/* pointer to previous header in list */
+    u_header_T	*uh_next;	/* pointer to next (older) header */
+    u_header_T	*uh_prev;	/* pointer to previous (newer) header */
+    u_header_T	*uh_alt_next;	/* pointer to next alternate branch */
+    u_header_T	*uh_alt_prev;	/* pointer to previous alternate branch */
+    long	uh_seq;		/* change number */
+    long	uh_walk;	/* used when walking the tree */
     u_entry_T	*uh_entry;	/* pointer to first entry */
     u_entry_T	*uh_getbot_entry; /* pointer to where ue_bot must be set */
     pos_T	uh_cursor;	/* cursor position before saving */
@@ -268,7 +298,6 @@ struct u_header
  * stuctures used in undo.c
  */
 #if SIZEOF_INT > 2
-# define ALIGN_LONG	/* longword alignment and use filler byte */
 # define ALIGN_SIZE (sizeof(long))
 #else
 # define ALIGN_SIZE (sizeof(short))
@@ -276,30 +305,36 @@ struct u_header
 
 #define ALIGN_MASK (ALIGN_SIZE - 1)
 
-typedef struct m_info minfo_T;
+#define MB_CLASSES  15		/* number of chunk size classes */
+#define MB_LARGE    MB_CLASSES	/* class of a block with one big chunk */
+
+typedef struct m_block mblock_T;
+typedef union m_info minfo_T;
 
 /*
- * stucture used to link chunks in one of the free chunk lists.
+ * Header in front of each chunk.
  */
-struct m_info
+union m_info
 {
-#ifdef ALIGN_LONG
-    long_u	m_size;		/* size of the chunk (including m_info) */
-#else
-    short_u	m_size;		/* size of the chunk (including m_info) */
-#endif
-    minfo_T	*m_next;	/* pointer to next free chunk in the list */
+    mblock_T	*m_block;	/* chunk in use: block it is in */
+    minfo_T	*m_next;	/* free chunk: next free chunk in the block */
+    long_u	m_align;	/* for alignment */
 };
 
 /*
- * structure used to link blocks in the list of allocated blocks.
+ * structure used to link blocks in the list of allocated blocks.  The chunks
+ * follow it.
  */
-typedef struct m_block mblock_T;
 struct m_block
 {
     mblock_T	*mb_next;	/* pointer to next allocated block */
-    size_t	mb_size;	/* total size of all chunks in this block */
-    minfo_T	mb_info;	/* head of free chuck list for this block */
+    mblock_T	*mb_prev;	/* pointer to previous allocated block */
+    mblock_T	*mb_free_next;	/* next block of this class with free chunks */
+    mblock_T	*mb_free_prev;	/* previous block with free chunks */
+    minfo_T	*mb_free;	/* list of free chunks in this block */
+    long_u	mb_size;	/* total size of all chunks in this block */
+    int		mb_class;	/* size class of the chunks or MB_LARGE */
+    int		mb_used;	/* number of chunks in use */
 };
 
 /*
@@ -889,6 +924,72 @@ struct stl_hlrec
     int		userhl;
 };
 
+/*
+ * A status line format is compiled into a list of items, so that it doesn't
+ * need to be parsed each time it is drawn.  The value of each item is
+ * remembered, it is only computed again when something it depends on
+ * changed.  See build_stl_str_hl().
+ */
+typedef struct stl_citem
+{
+    int		ci_type;	/* STL_CI_TEXT, STL_CI_ITEM, etc. */
+    int		ci_opt;		/* item character, e.g., STL_LINE */
+    int		ci_minwid;
+    int		ci_maxwid;
+    int		ci_zeropad;
+    int		ci_deps;	/* STL_DEP_ flags: what the value depends on */
+    char_u	*ci_text;	/* literal text or expression, NUL terminated */
+} stl_citem_T;
+
+#define STL_CI_TEXT	1	/* literal text */
+#define STL_CI_ITEM	2	/* %x item */
+#define STL_CI_GROUP	3	/* %( */
+#define STL_CI_GROUPEND	4	/* %) */
+#define STL_CI_MIDDLE	5	/* %= */
+#define STL_CI_TRUNC	6	/* %< */
+#define STL_CI_HIGHLIGHT 7	/* %N* */
+
+#define STL_DEP_CURSOR	1	/* cursor position or window scrolled */
+#define STL_DEP_BUFFER	2	/* buffer text, name or options */
+#define STL_DEP_MODE	4	/* State or current window */
+#define STL_DEP_OTHER	8	/* current buffer */
+#define STL_DEP_ALWAYS	16	/* always compute again */
+
+typedef struct stl_value
+{
+    char_u	*sv_str;	/* allocated string value or NULL */
+    long	sv_num;		/* number value, -1 when not used */
+    char	sv_valid;	/* sv_str and sv_num are valid */
+    char	sv_isflag;	/* item is a flag */
+    char	sv_fillable;	/* spaces may be replaced by fillchar */
+} stl_value_T;
+
+typedef struct stl_cache
+{
+    char_u	*sc_fmt;	/* copy of the compiled format */
+    char_u	*sc_strings;	/* text of all the items */
+    garray_T	sc_items;	/* compiled items, stl_citem_T */
+    stl_value_T	*sc_values;	/* value of each item */
+    int		sc_busy;	/* cache is being used */
+
+    /* State the values were computed for. */
+    pos_T	sc_cursor;
+    colnr_T	sc_virtcol;
+    linenr_T	sc_topline;
+    linenr_T	sc_botline;
+    linenr_T	sc_line_count;
+    int		sc_topfill;
+    int		sc_empty;
+    struct file_buffer *sc_buf;	/* buffer of the window */
+    struct file_buffer *sc_curbuf;
+    int		sc_changedtick;
+    int		sc_changed;
+    long	sc_tick;	/* value of stl_tick */
+    int		sc_state;	/* value of State */
+    int		sc_visual;
+    int		sc_curwin;	/* window was curwin */
+} stl_cache_T;
+
 /*
  * buffer: structure that holds information about one file
  *
@@ -925,6 +1026,17 @@ struct file_buffer
     int		b_dev;		/* device number (-1 if not set) */
     ino_t	b_ino;		/* inode number */
 #endif
+
+    /* For the hash tables in buffer.c. */
+    buf_T	*b_nr_next;	/* next buffer with same hash for b_fnum */
+    buf_T	*b_name_next;	/* next buffer with same hash for b_ffname */
+    unsigned	b_name_hash;	/* hash value used for b_ffname */
+    int		b_name_hashed;	/* in the hash table for b_ffname */
+#ifdef UNIX
+    buf_T	*b_ino_next;	/* next buffer with same hash for b_dev/b_ino */
+    unsigned	b_ino_hash;	/* hash value used for b_dev/b_ino */
+    int		b_ino_hashed;	/* in the hash table for b_dev/b_ino */
+#endif
 #ifdef FEAT_CW_EDITOR
     FSSpec	b_FSSpec;	/* MacOS File Identification */
 #endif
@@ -1027,6 +1139,7 @@ struct file_buffer
     u_header_T	*b_u_curhead;	/* pointer to current header */
     int		b_u_numhead;	/* current number of headers */
     int		b_u_synced;	/* entry lists are synced */
+    long	b_u_seq_last;	/* last used change number */
 
     /*
      * variables for "U" command in undo.c
@@ -1038,10 +1151,12 @@ struct file_buffer
     /*
      * The following only used in undo.c
      */
-    mblock_T	b_block_head;	/* head of allocated memory block list */
-    minfo_T	*b_m_search;	/* pointer to chunk before previously
-				   allocated/freed chunk */
-    mblock_T	*b_mb_current;	/* block where m_search points in */
+    mblock_T	*b_block_head;	/* head of allocated memory block list */
+    mblock_T	*b_mb_free[MB_CLASSES]; /* for each size class: list of
+				   blocks with free chunks */
+    long_u	b_mb_alloc;	/* bytes allocated for blocks */
+    long_u	b_mb_inuse;	/* bytes in chunks that are in use */
+    long	b_mb_count;	/* number of blocks */
 #ifdef FEAT_INS_EXPAND
     int		b_scanned;	/* ^N/^P have scanned this buffer */
 #endif
@@ -1306,6 +1421,19 @@ typedef struct w_line
 #endif
 } wline_T;
 
+/*
+ * Range of buffer lines in a window whose text is displayed wrong, but the
+ * number of screen lines they occupy is still right.  Kept in w_damage[],
+ * see redraw_win_range().
+ */
+typedef struct
+{
+    linenr_T	dr_top;		/* first damaged line */
+    linenr_T	dr_bot;		/* last damaged line */
+} damage_T;
+
+#define DAMAGE_LEN 8		/* max number of separate ranges in w_damage[] */
+
 /*
  * Windows are kept in a tree of frames.  Each frame has a column (FR_COL)
  * or row (FR_ROW) layout or is a leaf, which has a window.
@@ -1487,6 +1615,11 @@ struct window
 				       w_redr_type is REDRAW_TOP */
     linenr_T	w_redraw_top;	    /* when != 0: first line needing redraw */
     linenr_T	w_redraw_bot;	    /* when != 0: last line needing redraw */
+    damage_T	w_damage[DAMAGE_LEN]; /* lines that only need to be drawn
+				       again, when w_redr_type is VALID */
+    int		w_damage_len;	    /* number of used entries in w_damage[] */
+    int		w_drawn_rows;	    /* screen rows drawn for this window by
+				       the last update_screen() */
 #ifdef FEAT_WINDOWS
     int		w_redr_status;	    /* if TRUE status line must be redrawn */
 #endif
@@ -1503,6 +1636,11 @@ struct window
     char	w_ru_empty;	    /* TRUE if ruler shows 0-1 (empty line) */
 #endif
 
+#ifdef FEAT_STL_OPT
+    stl_cache_T	w_stl_cache;	    /* compiled 'statusline' */
+    stl_cache_T	w_ruf_cache;	    /* compiled 'rulerformat' */
+#endif
+
     int		w_alt_fnum;	    /* alternate file (for # and CTRL-^) */
 
 #ifdef FEAT_WINDOWS
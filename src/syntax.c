@@ -3368,6 +3368,9 @@ syn_cmd_off(eap, syncing)
     int		syncing;	/* not used */
 {
     syn_cmd_onoff(eap, "nosyntax");
+    /* No syntax files are sourced now, compiled patterns are not needed. */
+    if (!eap->skip)
+	free_regcache();
 }
 
     static void
@@ -5160,7 +5163,7 @@ get_syn_pattern(arg, ci)
     /* Make 'cpoptions' empty, to avoid the 'l' flag */
     cpo_save = p_cpo;
     p_cpo = (char_u *)"";
-    ci->sp_prog = vim_regcomp(ci->sp_pattern, RE_MAGIC);
+    ci->sp_prog = vim_regcomp_cached(ci->sp_pattern, RE_MAGIC);
     p_cpo = cpo_save;
 
     if (ci->sp_prog == NULL)
@@ -69,6 +69,9 @@ static char_u	*nofile_fname = NULL;	/* fname for NOTAGFILE error */
 
 static void taglen_advance __ARGS((int l));
 static int get_tagfname __ARGS((int first, char_u *buf));
+#ifdef FEAT_TAG_BINS
+static int get_tagfname_round __ARGS((int round, int first, char_u *buf, garray_T *gap, int *idxp));
+#endif
 
 static int jumpto_tag __ARGS((char_u *lbuf, int forceit, int keep_help));
 #ifdef FEAT_EMACS_TAGS
@@ -1054,6 +1057,439 @@ prepare_pats(pats, has_re)
 	pats->regmatch.regprog = NULL;
 }
 
+#ifdef FEAT_TAG_INDEX
+/*
+ * A tags file that is kept in memory, with an index on the tag names.
+ * The file is read into allocated memory, not mapped: when the file is
+ * truncated and written again while it is used, a mapping would cause a
+ * SIGBUS.  "ti_lines" has the offsets of the lines.
+ * First the header lines at the start of the file ("!_TAG_"), in file order.
+ * Then the tag lines, sorted on the tag name with case folded to uppercase,
+ * like tag_strnicmp() does.  Lines with the same name are in file order.
+ * Thus all lines with a tag name starting with a given string, ignoring case
+ * or not, can be found with a binary search, also when the file isn't
+ * sorted.
+ */
+typedef struct tagidx_S tagidx_T;
+
+struct tagidx_S
+{
+    tagidx_T	*ti_next;	/* next indexed tags file, most recently used
+				   first */
+    dev_t	ti_dev;		/* device and inode of the file */
+    ino_t	ti_ino;
+    time_t	ti_mtime;	/* modification time when indexed */
+    off_t	ti_size;	/* size of the file when indexed */
+    int		ti_valid;	/* FALSE when the file was indexed in the
+				   second it was modified */
+    char_u	*ti_data;	/* text of the file, NULL when the file can't
+				   be indexed */
+    off_t	*ti_lines;	/* offsets of the lines */
+    long	ti_hdr_count;	/* number of header lines in ti_lines[] */
+    long	ti_count;	/* number of lines in ti_lines[] */
+};
+
+static tagidx_T	*first_tagidx = NULL;
+
+/* Maximum number of tags files kept in memory. */
+#define TAGIDX_MAX 20
+
+/* Smaller files are quicker to read than to index. */
+#define TAGIDX_MINSIZE 65536L
+
+/* Data used by tagidx_cmp() while sorting. */
+static char_u	*tagidx_sort_data;
+static char_u	*tagidx_sort_end;
+
+/* The character at "p" of a tag name in a file ending at "e", folded to
+ * uppercase.  The end of the name is zero, so that a shorter name sorts
+ * before a longer one. */
+#ifdef FEAT_TAG_ANYWHITE
+# define TAGIDX_CHAR(p, e) \
+	((p) >= (e) || vim_iswhite(*(p)) || *(p) == '\n' || *(p) == '\r' \
+						    ? 0 : TOUPPER_ASC(*(p)))
+#else
+# define TAGIDX_CHAR(p, e) \
+	((p) >= (e) || *(p) == TAB || *(p) == '\n' || *(p) == '\r' \
+						    ? 0 : TOUPPER_ASC(*(p)))
+#endif
+
+static tagidx_T *tagidx_get __ARGS((FILE *fp));
+static int tagidx_build __ARGS((tagidx_T *tip, FILE *fp));
+static void tagidx_clear __ARGS((tagidx_T *tip));
+static int tagidx_isblank __ARGS((char_u *p, char_u *e));
+static int
+# ifdef __BORLANDC__
+    _RTLENTRYF
+# endif
+	    tagidx_cmp __ARGS((const void *s1, const void *s2));
+static int
+# ifdef __BORLANDC__
+    _RTLENTRYF
+# endif
+	    tagidx_offcmp __ARGS((const void *s1, const void *s2));
+static int tagidx_headcmp __ARGS((tagidx_T *tip, off_t off, char_u *head, int headlen));
+static int tagidx_select __ARGS((tagidx_T *tip, pat_T *pats, off_t **linesp, long *countp));
+static off_t tagidx_getline __ARGS((tagidx_T *tip, off_t off, char_u *lbuf, int size));
+
+/*
+ * Get the index for the tags file opened as "fp".  Index the file when this
+ * wasn't done yet or it changed since it was indexed.
+ * Returns NULL when the file can't be indexed.
+ */
+    static tagidx_T *
+tagidx_get(fp)
+    FILE	*fp;
+{
+    struct stat	st;
+    tagidx_T	*tip;
+    tagidx_T	**tipp;
+    int		count = 0;
+
+    if (mch_fstat(fileno(fp), &st) < 0 || !S_ISREG(st.st_mode)
+					       || st.st_size < TAGIDX_MINSIZE)
+	return NULL;
+
+    for (tipp = &first_tagidx; *tipp != NULL; tipp = &(*tipp)->ti_next)
+    {
+	++count;
+	if ((*tipp)->ti_dev == st.st_dev && (*tipp)->ti_ino == st.st_ino)
+	    break;
+    }
+    tip = *tipp;
+    if (tip != NULL)
+    {
+	/* Move it to the front of the list. */
+	*tipp = tip->ti_next;
+	tip->ti_next = first_tagidx;
+	first_tagidx = tip;
+	if (tip->ti_valid && tip->ti_mtime == st.st_mtime
+						  && tip->ti_size == st.st_size)
+	    return tip->ti_data == NULL ? NULL : tip;
+	tagidx_clear(tip);
+    }
+    else
+    {
+	/* Forget about the least recently used file when there are too
+	 * many. */
+	if (count >= TAGIDX_MAX)
+	{
+	    for (tipp = &first_tagidx; (*tipp)->ti_next != NULL;
+						    tipp = &(*tipp)->ti_next)
+		;
+	    tagidx_clear(*tipp);
+	    vim_free(*tipp);
+	    *tipp = NULL;
+	}
+	tip = (tagidx_T *)alloc_clear((unsigned)sizeof(tagidx_T));
+	if (tip == NULL)
+	    return NULL;
+	tip->ti_next = first_tagidx;
+	first_tagidx = tip;
+	tip->ti_dev = st.st_dev;
+	tip->ti_ino = st.st_ino;
+    }
+
+    tip->ti_mtime = st.st_mtime;
+    tip->ti_size = st.st_size;
+    /* A change later in the same second may not change the time, index the
+     * file again next time. */
+    tip->ti_valid = (st.st_mtime < time(NULL));
+    if (tagidx_build(tip, fp) == FAIL)
+	return NULL;
+    return tip;
+}
+
+/*
+ * Read the tags file "fp" into memory and fill "tip->ti_lines".  "fp" is at
+ * the start of the file again afterwards.
+ * Returns FAIL when the file can't be indexed, "tip->ti_data" is NULL then.
+ */
+    static int
+tagidx_build(tip, fp)
+    tagidx_T	*tip;
+    FILE	*fp;
+{
+    char_u	*data;
+    char_u	*end;
+    char_u	*p;
+    char_u	*e;
+    long	count = 0;
+    long	n;
+    size_t	len;
+    int		in_hdr = TRUE;
+    int		sorted = TRUE;
+
+    /* The file must fit in memory. */
+    if ((off_t)(long_u)tip->ti_size != tip->ti_size)
+	return FAIL;
+    data = lalloc((long_u)tip->ti_size, FALSE);
+    if (data == NULL)
+	return FAIL;
+    /* When less can be read the file is being written, don't index it now.
+     * An emacs-style tags file can't be indexed. */
+    rewind(fp);
+    len = fread((char *)data, (size_t)1, (size_t)tip->ti_size, fp);
+    rewind(fp);
+    if (len != (size_t)tip->ti_size || *data == Ctrl_L)
+    {
+	vim_free(data);
+	return FAIL;
+    }
+    end = data + tip->ti_size;
+
+    /* Count the lines that are not blank. */
+    for (p = data; p < end; p = e + 1)
+    {
+	e = (char_u *)memchr(p, '\n', (size_t)(end - p));
+	if (e == NULL)
+	    e = end;
+	if (!tagidx_isblank(p, e))
+	    ++count;
+    }
+    tip->ti_lines = (off_t *)lalloc((long_u)(count * sizeof(off_t)), FALSE);
+    if (tip->ti_lines == NULL)
+    {
+	vim_free(data);
+	return FAIL;
+    }
+
+    n = 0;
+    for (p = data; p < end && n < count; p = e + 1)
+    {
+	e = (char_u *)memchr(p, '\n', (size_t)(end - p));
+	if (e == NULL)
+	    e = end;
+	if (tagidx_isblank(p, e))
+	    continue;
+	if (in_hdr)
+	{
+	    if (e - p > 6 && STRNCMP(p, "!_TAG_", 6) == 0)
+		++tip->ti_hdr_count;
+	    else
+		in_hdr = FALSE;
+	}
+	tip->ti_lines[n++] = (off_t)(p - data);
+    }
+    tip->ti_count = n;
+    tip->ti_data = data;
+
+    /* Only sort when the file isn't case-fold sorted already. */
+    tagidx_sort_data = data;
+    tagidx_sort_end = end;
+    for (n = tip->ti_hdr_count + 1; n < tip->ti_count; ++n)
+	if (tagidx_cmp(&tip->ti_lines[n - 1], &tip->ti_lines[n]) > 0)
+	{
+	    sorted = FALSE;
+	    break;
+	}
+    if (!sorted)
+	qsort((void *)(tip->ti_lines + tip->ti_hdr_count),
+		(size_t)(tip->ti_count - tip->ti_hdr_count), sizeof(off_t),
+								  tagidx_cmp);
+    return OK;
+}
+
+/*
+ * Free the memory used for "tip", except "tip" itself.
+ */
+    static void
+tagidx_clear(tip)
+    tagidx_T	*tip;
+{
+    vim_free(tip->ti_data);
+    tip->ti_data = NULL;
+    vim_free(tip->ti_lines);
+    tip->ti_lines = NULL;
+    tip->ti_hdr_count = 0;
+    tip->ti_count = 0;
+}
+
+/*
+ * Return TRUE if the line from "p" to "e" contains only white space.
+ */
+    static int
+tagidx_isblank(p, e)
+    char_u	*p;
+    char_u	*e;
+{
+    while (p < e && (vim_iswhite(*p) || *p == '\r'))
+	++p;
+    return p == e;
+}
+
+/*
+ * Compare function for sorting tag lines on the tag name, ignoring case.
+ * Lines with the same name are sorted on their offset.
+ */
+    static int
+#ifdef __BORLANDC__
+_RTLENTRYF
+#endif
+tagidx_cmp(s1, s2)
+    const void	*s1;
+    const void	*s2;
+{
+    off_t	o1 = *(off_t *)s1;
+    off_t	o2 = *(off_t *)s2;
+    char_u	*p1 = tagidx_sort_data + o1;
+    char_u	*p2 = tagidx_sort_data + o2;
+    int		c1, c2;
+
+    for (;;)
+    {
+	c1 = TAGIDX_CHAR(p1, tagidx_sort_end);
+	c2 = TAGIDX_CHAR(p2, tagidx_sort_end);
+	if (c1 != c2)
+	    return c1 - c2;
+	if (c1 == 0)
+	    break;
+	++p1;
+	++p2;
+    }
+    return o1 < o2 ? -1 : o1 > o2 ? 1 : 0;
+}
+
+/*
+ * Compare function for sorting offsets.
+ */
+    static int
+#ifdef __BORLANDC__
+_RTLENTRYF
+#endif
+tagidx_offcmp(s1, s2)
+    const void	*s1;
+    const void	*s2;
+{
+    off_t	o1 = *(off_t *)s1;
+    off_t	o2 = *(off_t *)s2;
+
+    return o1 < o2 ? -1 : o1 > o2 ? 1 : 0;
+}
+
+/*
+ * Compare the start of the tag name of the line at "off" with "head[headlen]",
+ * ignoring case.
+ * Return zero when the name starts with "head", < 0 when it sorts before it
+ * and > 0 when it sorts after it.
+ */
+    static int
+tagidx_headcmp(tip, off, head, headlen)
+    tagidx_T	*tip;
+    off_t	off;
+    char_u	*head;
+    int		headlen;
+{
+    char_u	*p = tip->ti_data + off;
+    char_u	*end = tip->ti_data + tip->ti_size;
+    int		i;
+    int		c;
+
+    for (i = 0; i < headlen; ++i)
+    {
+	c = TAGIDX_CHAR(p + i, end) - TOUPPER_ASC(head[i]);
+	if (c != 0)
+	    return c;
+    }
+    return 0;
+}
+
+/*
+ * Find the lines in "tip" with a tag name that may match "pats": the name
+ * starts with the pattern head, ignoring case.  Returns them in allocated
+ * "*linesp[*countp]", in file order.
+ * Returns FAIL when the index can't be used for "pats" or out of memory.
+ */
+    static int
+tagidx_select(tip, pats, linesp, countp)
+    tagidx_T	*tip;
+    pat_T	*pats;
+    off_t	**linesp;
+    long	*countp;
+{
+    long	lo, hi, mid;
+    long	first;
+    int		i;
+
+    /* The lines are sorted with ASCII case folding, other characters may
+     * match in another way when ignoring case. */
+    if (pats->headlen == 0)
+	return FAIL;
+    if (pats->regmatch.rm_ic)
+	for (i = 0; i < pats->headlen; ++i)
+	    if (pats->head[i] >= 0x80)
+		return FAIL;
+
+    /* Find the first line that doesn't sort before the head. */
+    lo = tip->ti_hdr_count;
+    hi = tip->ti_count;
+    while (lo < hi)
+    {
+	mid = lo + (hi - lo) / 2;
+	if (tagidx_headcmp(tip, tip->ti_lines[mid],
+					     pats->head, pats->headlen) < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    first = lo;
+
+    /* Find the first line after that which sorts after the head. */
+    hi = tip->ti_count;
+    while (lo < hi)
+    {
+	mid = lo + (hi - lo) / 2;
+	if (tagidx_headcmp(tip, tip->ti_lines[mid],
+					     pats->head, pats->headlen) <= 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    *countp = lo - first;
+    *linesp = NULL;
+    if (*countp == 0)
+	return OK;
+    *linesp = (off_t *)lalloc((long_u)(*countp * sizeof(off_t)), FALSE);
+    if (*linesp == NULL)
+	return FAIL;
+    mch_memmove(*linesp, tip->ti_lines + first,
+					    (size_t)(*countp * sizeof(off_t)));
+    /* Use the same order as when reading the file. */
+    if (*countp > 1)
+	qsort((void *)*linesp, (size_t)*countp, sizeof(off_t), tagidx_offcmp);
+    return OK;
+}
+
+/*
+ * Copy the line at "off" in "tip" to "lbuf[size]", like vim_fgets() does.
+ * Returns the offset of the next line.
+ */
+    static off_t
+tagidx_getline(tip, off, lbuf, size)
+    tagidx_T	*tip;
+    off_t	off;
+    char_u	*lbuf;
+    int		size;
+{
+    char_u	*p = tip->ti_data + off;
+    char_u	*end = tip->ti_data + tip->ti_size;
+    char_u	*e;
+    size_t	len;
+
+    e = (char_u *)memchr(p, '\n', (size_t)(end - p));
+    if (e == NULL)
+	len = end - p;
+    else
+	len = e - p + 1;
+    if (len > (size_t)size - 1)
+	len = size - 1;
+    mch_memmove(lbuf, p, len);
+    lbuf[len] = NUL;
+    return off + (off_t)len;
+}
+#endif
+
 /*
  * find_tags() - search for tags in tags files
  *
@@ -1120,6 +1556,16 @@ find_tags(pat, num_matches, matchesp, flags, mincount, buf_ffname)
     int		tagcmp;
     off_t	offset;
     int		round;
+    garray_T	tagfnames_ga;	/* names of tags files used in round 1 */
+    int		tagfnames_idx = 0; /* index in tagfnames_ga for round 2 */
+#endif
+#ifdef FEAT_TAG_INDEX
+    tagidx_T	*tip = NULL;	/* index of the current tags file */
+    off_t	*idx_lines = NULL; /* offsets of lines to use from the index */
+    long	idx_count = 0;	/* number of offsets in idx_lines[] */
+    long	idx_next = 0;	/* index in idx_lines[] of the next line */
+    int		idx_hdr = FALSE; /* using the header lines of the index */
+    off_t	idx_offset = 0;	/* offset after the last line used */
 #endif
     enum
     {
@@ -1129,6 +1575,9 @@ find_tags(pat, num_matches, matchesp, flags, mincount, buf_ffname)
 	, TS_BINARY,		/* binary searching */
 	TS_SKIP_BACK,		/* skipping backwards */
 	TS_STEP_FORWARD		/* stepping forwards */
+#endif
+#ifdef FEAT_TAG_INDEX
+	, TS_INDEX		/* using lines found with the index */
 #endif
     }	state;			/* Current search state */
 
@@ -1218,6 +1667,9 @@ find_tags(pat, num_matches, matchesp, flags, mincount, buf_ffname)
 #endif
     for (mtt = 0; mtt < MT_COUNT; ++mtt)
 	ga_init2(&ga_match[mtt], (int)sizeof(struct match_found *), 100);
+#ifdef FEAT_TAG_BINS
+    ga_init2(&tagfnames_ga, (int)sizeof(char_u *), 10);
+#endif
 
     /* check for out of memory situation */
     if (lbuf == NULL || tag_fname == NULL
@@ -1294,7 +1746,13 @@ find_tags(pat, num_matches, matchesp, flags, mincount, buf_ffname)
 #ifdef FEAT_CSCOPE
 	    use_cscope ||
 #endif
-		get_tagfname(first_file, tag_fname) == OK; first_file = FALSE)
+#ifdef FEAT_TAG_BINS
+		get_tagfname_round(round, first_file, tag_fname,
+					&tagfnames_ga, &tagfnames_idx) == OK;
+#else
+		get_tagfname(first_file, tag_fname) == OK;
+#endif
+							    first_file = FALSE)
       {
 	/*
 	 * A file that doesn't exist is silently ignored.  Only when not a
@@ -1469,6 +1927,39 @@ find_tags(pat, num_matches, matchesp, flags, mincount, buf_ffname)
 		}
 	    }
 
+# ifdef FEAT_TAG_INDEX
+	    /*
+	     * Using the index: First the header lines, then the lines with a
+	     * tag name that starts with the pattern head.  Those are found
+	     * after using the header lines, because a "!_TAG_FILE_ENCODING"
+	     * line may change the pattern.
+	     */
+	    else if (state == TS_INDEX)
+	    {
+		if (idx_next >= idx_count)
+		{
+		    if (!idx_hdr)
+			break;		/* no more lines */
+		    idx_hdr = FALSE;
+		    idx_next = 0;
+		    if (tagidx_select(tip, pats, &idx_lines, &idx_count)
+								      == FAIL)
+		    {
+			/* Can't use the index, read the file. */
+			idx_lines = NULL;
+			idx_count = 0;
+			rewind(fp);
+			state = TS_LINEAR;
+			continue;
+		    }
+		    if (idx_count == 0)
+			break;
+		}
+		idx_offset = tagidx_getline(tip, idx_lines[idx_next++],
+								 lbuf, LSIZE);
+	    }
+# endif
+
 	    /*
 	     * Not jumping around in the file: Read the next line.
 	     */
@@ -1619,6 +2110,27 @@ line_read_in:
 		state = TS_LINEAR;
 #endif
 
+#ifdef FEAT_TAG_INDEX
+		/*
+		 * Instead of a linear search use the index of the file, when
+		 * there is a tag name to look for.  It finds the lines that may
+		 * match directly, no matter how the file is sorted.
+		 */
+		if (state == TS_LINEAR && pats->headlen > 0
+# ifdef FEAT_CSCOPE
+			&& !use_cscope
+# endif
+			&& (tip = tagidx_get(fp)) != NULL)
+		{
+		    state = TS_INDEX;
+		    idx_hdr = TRUE;
+		    idx_lines = tip->ti_lines;
+		    idx_count = tip->ti_hdr_count;
+		    idx_next = 0;
+		    continue;
+		}
+#endif
+
 #ifdef FEAT_TAG_BINS
 		/*
 		 * When starting a binary search, get the size of the file and
@@ -1740,7 +2252,11 @@ line_read_in:
 		    cmplen = p_tl;
 		if (has_re && pats->headlen < cmplen)
 		    cmplen = pats->headlen;
-		else if (state == TS_LINEAR && pats->headlen != cmplen)
+		else if ((state == TS_LINEAR
+#ifdef FEAT_TAG_INDEX
+			    || state == TS_INDEX
+#endif
+			    ) && pats->headlen != cmplen)
 		    continue;
 
 #ifdef FEAT_TAG_BINS
@@ -2201,6 +2717,11 @@ line_read_in:
 	if (line_error)
 	{
 	    EMSG2(_("E431: Format error in tags file \"%s\""), tag_fname);
+#ifdef FEAT_TAG_INDEX
+	    if (state == TS_INDEX)
+		EMSGN(_("Before byte %ld"), (long)idx_offset);
+	    else
+#endif
 #ifdef FEAT_CSCOPE
 	    if (!use_cscope)
 #endif
@@ -2213,6 +2734,14 @@ line_read_in:
 	if (!use_cscope)
 #endif
 	    fclose(fp);
+#ifdef FEAT_TAG_INDEX
+	if (!idx_hdr)
+	    vim_free(idx_lines);
+	idx_lines = NULL;
+	idx_count = 0;
+	idx_hdr = FALSE;
+	tip = NULL;
+#endif
 #ifdef FEAT_EMACS_TAGS
 	while (incstack_idx)
 	{
@@ -2285,6 +2814,9 @@ findtag_end:
     vim_free(lbuf);
     vim_free(pats->regmatch.regprog);
     vim_free(tag_fname);
+#ifdef FEAT_TAG_BINS
+    ga_clear_strings(&tagfnames_ga);
+#endif
 #ifdef FEAT_EMACS_TAGS
     vim_free(ebuf);
 #endif
@@ -2489,6 +3021,60 @@ get_tagfname(first, buf)
     return OK;
 }
 
+#ifdef FEAT_TAG_BINS
+/*
+ * Get the next name of a tag file for round "round" of find_tags().
+ * In the first round the names are found with get_tagfname() and remembered
+ * in "gap".  The second round takes them from "gap", with index "*idxp", to
+ * avoid searching directories again for "**" and ";" in 'tags'.  The second
+ * round is only done when the first round went through all the files.
+ *
+ * Return FAIL if no more tag file names, OK otherwise.
+ */
+    static int
+get_tagfname_round(round, first, buf, gap, idxp)
+    int		round;
+    int		first;	/* TRUE when first file name is wanted */
+    char_u	*buf;	/* pointer to buffer of MAXPATHL chars */
+    garray_T	*gap;
+    int		*idxp;
+{
+    char_u	*p;
+
+    /* "*idxp" is -1 when the names could not be remembered. */
+    if (round > 1 && *idxp >= 0)
+    {
+	if (first)
+	    *idxp = 0;
+	if (*idxp >= gap->ga_len)
+	    return FAIL;
+	STRCPY(buf, ((char_u **)(gap->ga_data))[(*idxp)++]);
+	return OK;
+    }
+
+    if (round == 1 && first)
+    {
+	ga_clear_strings(gap);
+	*idxp = 0;
+    }
+    if (get_tagfname(first, buf) == FAIL)
+	return FAIL;
+    if (round > 1 || *idxp < 0)
+	return OK;
+    if (ga_grow(gap, 1) == FAIL || (p = vim_strsave(buf)) == NULL)
+    {
+	/* Out of memory: Don't remember the names, the second round finds
+	 * them again. */
+	ga_clear_strings(gap);
+	*idxp = -1;
+	return OK;
+    }
+    ((char_u **)(gap->ga_data))[gap->ga_len++] = p;
+    --gap->ga_room;
+    return OK;
+}
+#endif
+
 /*
  * Parse one line from the tags file. Find start/end of tag name, start/end of
  * file name and start of search pattern.
@@ -3510,6 +4096,8 @@ expand_tags(tagnames, pat, num_file, file)
 	tagnmflag = TAG_NAMES;
     else
 	tagnmflag = 0;
+    /* Note: Each call finds the tags files again, they are only remembered
+     * within one call of find_tags(). */
     if (pat[0] == '/')
 	ret = find_tags(pat + 1, num_file, file,
 		TAG_REGEXP | tagnmflag | TAG_VERBOSE,
@@ -3540,3 +4128,722 @@ expand_tags(tagnames, pat, num_file, file)
     return ret;
 }
 #endif
+
+#if defined(FEAT_TAG_XREF) || defined(PROTO)
+/*
+ * Code for ":mkxref": make a tags file with a line for each identifier used
+ * in a list of files.  It is an index from a name to the places where it is
+ * used, like cscope finds with "find s".  A line looks like this:
+ *	name<Tab>file<Tab>lnum
+ * The file names are relative to the directory of the tags file when
+ * possible.  The header has a line for each file that was scanned, so that
+ * the tags file can be updated when one of the files is written.
+ */
+#define XREF_PROGRAM	"!_TAG_PROGRAM_NAME\tVim :mkxref\t//"
+#define XREF_FILE	"!_TAG_XREF_FILE\t"
+#define XREF_FILE_LEN	16
+
+/*
+ * A tags file that ":mkxref" made or updated in this session, with the full
+ * names of the files in it.  Only these tags files are updated when a file
+ * is written.
+ */
+typedef struct xref_S xref_T;
+
+struct xref_S
+{
+    xref_T	*xr_next;
+    char_u	*xr_tagfname;	/* full name of the tags file */
+    garray_T	xr_files;	/* full names of the files in it, sorted */
+};
+
+static xref_T	*first_xref = NULL;
+
+static char_u *xref_read __ARGS((char_u *fname));
+static char_u *xref_dir __ARGS((char_u *tagfname));
+static char_u *xref_relname __ARGS((char_u *dir, char_u *fname));
+static int xref_scan __ARGS((char_u *fname, char_u *relname, garray_T *gap));
+static void xref_remember __ARGS((char_u *tagfname, char_u *dir, garray_T *files));
+static void xref_forget __ARGS((xref_T *xp));
+static int xref_update __ARGS((char_u *tagfname, int fcount, char_u **fnames, int forceit, int report));
+static int
+# ifdef __BORLANDC__
+    _RTLENTRYF
+# endif
+	    xref_cmp __ARGS((const void *s1, const void *s2));
+static int
+# ifdef __BORLANDC__
+    _RTLENTRYF
+# endif
+	    xref_strcmp __ARGS((const void *s1, const void *s2));
+
+/*
+ * Read file "fname" into allocated memory, with a NUL appended.
+ * Returns NULL when it can't be read.
+ */
+    static char_u *
+xref_read(fname)
+    char_u	*fname;
+{
+    FILE	*fd;
+    long	len;
+    char_u	*data = NULL;
+
+    if (mch_isdir(fname))
+	return NULL;
+    fd = mch_fopen((char *)fname, READBIN);
+    if (fd == NULL)
+	return NULL;
+    if (fseek(fd, 0L, SEEK_END) == 0 && (len = ftell(fd)) >= 0
+					   && fseek(fd, 0L, SEEK_SET) == 0)
+    {
+	data = lalloc((long_u)(len + 1), TRUE);
+	if (data != NULL)
+	{
+	    if ((long)fread(data, 1, (size_t)len, fd) != len)
+	    {
+		vim_free(data);
+		data = NULL;
+	    }
+	    else
+		data[len] = NUL;
+	}
+    }
+    fclose(fd);
+    return data;
+}
+
+/*
+ * Return the full name of the directory of tags file "tagfname", ending in a
+ * path separator, in allocated memory.
+ */
+    static char_u *
+xref_dir(tagfname)
+    char_u	*tagfname;
+{
+    char_u	*dir;
+
+    dir = FullName_save(tagfname, TRUE);
+    if (dir != NULL)
+	*gettail(dir) = NUL;
+    return dir;
+}
+
+/*
+ * Return the name of file "fname" as used in a tags file in directory "dir":
+ * relative to "dir" when it is below it, the full name otherwise.
+ * Returns allocated memory, NULL when out of memory.
+ */
+    static char_u *
+xref_relname(dir, fname)
+    char_u	*dir;
+    char_u	*fname;
+{
+    char_u	*full;
+    char_u	*p;
+    size_t	len = STRLEN(dir);
+
+    full = FullName_save(fname, FALSE);
+    if (full == NULL || len == 0 || fnamencmp(full, dir, len) != 0)
+	return full;
+    p = vim_strsave(full + len);
+    vim_free(full);
+    return p;
+}
+
+/*
+ * Scan file "fname" for identifiers and add a line for each one to "gap",
+ * using "relname" for the file name.  Words are recognized with 'iskeyword'.
+ * Numbers and words of one character are skipped, each name is added only
+ * once for a line.
+ * Returns FAIL when the file can't be read.
+ */
+    static int
+xref_scan(fname, relname, gap)
+    char_u	*fname;
+    char_u	*relname;
+    garray_T	*gap;
+{
+    char_u	*data;
+    char_u	*line;
+    char_u	*next;
+    char_u	*p;
+    char_u	*s;
+    char_u	*e;
+    linenr_T	lnum = 0;
+    size_t	fnamelen = STRLEN(relname);
+    int		len;
+    int		first = gap->ga_len;
+    int		i;
+
+    data = xref_read(fname);
+    if (data == NULL)
+	return FAIL;
+
+    for (line = data; *line != NUL && !got_int; line = next)
+    {
+	++lnum;
+	next = vim_strchr(line, '\n');
+	if (next == NULL)
+	    next = line + STRLEN(line);
+	else
+	    *next++ = NUL;
+	first = gap->ga_len;
+
+	for (p = line; *p != NUL; )
+	{
+	    if (!vim_iswordp(p))
+	    {
+#ifdef FEAT_MBYTE
+		if (has_mbyte)
+		    p += (*mb_ptr2len_check)(p);
+		else
+#endif
+		    ++p;
+		continue;
+	    }
+	    s = p;
+	    while (*p != NUL && vim_iswordp(p))
+	    {
+#ifdef FEAT_MBYTE
+		if (has_mbyte)
+		    p += (*mb_ptr2len_check)(p);
+		else
+#endif
+		    ++p;
+	    }
+	    len = (int)(p - s);
+	    if (len < 2 || VIM_ISDIGIT(*s))
+		continue;
+
+	    /* Skip a name that was already found in this line. */
+	    for (i = first; i < gap->ga_len; ++i)
+	    {
+		e = ((char_u **)gap->ga_data)[i];
+		if (STRNCMP(e, s, len) == 0 && e[len] == TAB)
+		    break;
+	    }
+	    if (i < gap->ga_len)
+		continue;
+
+	    /* Grow the array by its size, there can be many lines. */
+	    if (gap->ga_growsize < gap->ga_len)
+		gap->ga_growsize = gap->ga_len;
+	    if (ga_grow(gap, 1) == FAIL)
+		break;
+	    e = alloc((unsigned)(len + fnamelen + 15));
+	    if (e == NULL)
+		break;
+	    mch_memmove(e, s, (size_t)len);
+	    sprintf((char *)e + len, "\t%s\t%ld", relname, (long)lnum);
+	    ((char_u **)gap->ga_data)[gap->ga_len++] = e;
+	    --gap->ga_room;
+	}
+	line_breakcheck();
+    }
+
+    vim_free(data);
+    return OK;
+}
+
+/*
+ * Compare function for sorting the lines of a cross-reference tags file:
+ * on name, file name and line number.
+ */
+    static int
+#ifdef __BORLANDC__
+_RTLENTRYF
+#endif
+xref_cmp(s1, s2)
+    const void	*s1;
+    const void	*s2;
+{
+    char_u	*l1 = *(char_u **)s1;
+    char_u	*l2 = *(char_u **)s2;
+    char_u	*t1 = vim_strrchr(l1, TAB);
+    char_u	*t2 = vim_strrchr(l2, TAB);
+    long	n1, n2;
+
+    /* Compare line numbers as numbers when the rest is equal. */
+    if (t1 != NULL && t2 != NULL && t1 - l1 == t2 - l2
+					   && STRNCMP(l1, l2, t1 - l1) == 0)
+    {
+	n1 = atol((char *)t1 + 1);
+	n2 = atol((char *)t2 + 1);
+	return n1 < n2 ? -1 : n1 > n2 ? 1 : 0;
+    }
+    return STRCMP(l1, l2);
+}
+
+/*
+ * Compare function for sorting and searching file names.
+ */
+    static int
+#ifdef __BORLANDC__
+_RTLENTRYF
+#endif
+xref_strcmp(s1, s2)
+    const void	*s1;
+    const void	*s2;
+{
+    return STRCMP(*(char_u **)s1, *(char_u **)s2);
+}
+
+/*
+ * Update tags file "tagfname" made with ":mkxref" for the files
+ * "fnames[fcount]": Remove the lines for them and scan them again.
+ * When "fcount" is zero all files in the tags file are scanned again.
+ * When "forceit" is TRUE an existing tags file is replaced, otherwise the
+ * lines for other files are kept.
+ * When "report" is TRUE give error messages and a message about the result.
+ * Returns FAIL when the tags file was not written.
+ */
+    static int
+xref_update(tagfname, fcount, fnames, forceit, report)
+    char_u	*tagfname;
+    int		fcount;
+    char_u	**fnames;
+    int		forceit;
+    int		report;
+{
+    char_u	*dir;
+    char_u	*data = NULL;
+    char_u	*line;
+    char_u	*next;
+    char_u	*p;
+    char_u	*q;
+    char_u	*fname;
+    garray_T	old_files;	/* files in the tags file, into "data" */
+    garray_T	old_lines;	/* lines kept from the tags file */
+    garray_T	scan_files;	/* files to be scanned, allocated */
+    garray_T	files;		/* files for the new header */
+    garray_T	new_lines;	/* lines for the scanned files, allocated */
+    FILE	*fd;
+    char_u	*tmpname = NULL;
+    int		tmpfd;
+    long	perm;
+    int		is_xref = FALSE;
+    int		retval = FAIL;
+    int		i, j;
+    long	count = 0;
+
+    dir = xref_dir(tagfname);
+    if (dir == NULL)
+	return FAIL;
+    ga_init2(&old_files, (int)sizeof(char_u *), 100);
+    ga_init2(&old_lines, (int)sizeof(char_u *), 1000);
+    ga_init2(&scan_files, (int)sizeof(char_u *), 100);
+    ga_init2(&files, (int)sizeof(char_u *), 100);
+    ga_init2(&new_lines, (int)sizeof(char_u *), 1000);
+
+    /*
+     * Read the existing tags file, unless it is to be replaced.
+     */
+    if (!forceit && mch_getperm(tagfname) >= 0)
+    {
+	data = xref_read(tagfname);
+	if (data == NULL)
+	{
+	    if (report)
+		EMSG2(_(e_notread), tagfname);
+	    goto theend;
+	}
+	for (line = data; *line != NUL; line = next)
+	{
+	    next = vim_strchr(line, '\n');
+	    if (next == NULL)
+		next = line + STRLEN(line);
+	    else
+		*next++ = NUL;
+	    if (STRNCMP(line, "!_TAG_", 6) == 0)
+	    {
+		if (STRCMP(line, XREF_PROGRAM) == 0)
+		    is_xref = TRUE;
+		else if (STRNCMP(line, XREF_FILE, XREF_FILE_LEN) == 0
+			&& (p = vim_strchr(line + XREF_FILE_LEN, TAB)) != NULL
+			&& ga_grow(&old_files, 1) == OK)
+		{
+		    *p = NUL;
+		    ((char_u **)old_files.ga_data)[old_files.ga_len++] =
+							 line + XREF_FILE_LEN;
+		    --old_files.ga_room;
+		}
+	    }
+	    else if (*line != NUL)
+	    {
+		if (old_lines.ga_growsize < old_lines.ga_len)
+		    old_lines.ga_growsize = old_lines.ga_len;
+		if (ga_grow(&old_lines, 1) == FAIL)
+		    goto theend;
+		((char_u **)old_lines.ga_data)[old_lines.ga_len++] = line;
+		--old_lines.ga_room;
+	    }
+	}
+	if (!is_xref)
+	{
+	    /* Don't overwrite a tags file made by another program. */
+	    if (report)
+		EMSG(_(e_exists));
+	    goto theend;
+	}
+    }
+
+    /*
+     * Make the sorted list of files to scan.
+     */
+    if (fcount == 0)
+	for (i = 0; i < old_files.ga_len; ++i)
+	{
+	    if (ga_grow(&scan_files, 1) == FAIL
+		    || (fname = vim_strsave(
+				((char_u **)old_files.ga_data)[i])) == NULL)
+		goto theend;
+	    ((char_u **)scan_files.ga_data)[scan_files.ga_len++] = fname;
+	    --scan_files.ga_room;
+	}
+    else
+	for (i = 0; i < fcount; ++i)
+	{
+	    if (ga_grow(&scan_files, 1) == FAIL
+			      || (fname = xref_relname(dir, fnames[i])) == NULL)
+		goto theend;
+	    /* A file name with a Tab or line break can't be in a tags file. */
+	    if (vim_strpbrk(fname, (char_u *)"\t\r\n") != NULL)
+	    {
+		vim_free(fname);
+		continue;
+	    }
+	    ((char_u **)scan_files.ga_data)[scan_files.ga_len++] = fname;
+	    --scan_files.ga_room;
+	}
+    if (scan_files.ga_len > 1)
+    {
+	qsort(scan_files.ga_data, (size_t)scan_files.ga_len,
+					    sizeof(char_u *), xref_strcmp);
+	for (i = j = 1; i < scan_files.ga_len; ++i)
+	    if (STRCMP(((char_u **)scan_files.ga_data)[i],
+				((char_u **)scan_files.ga_data)[j - 1]) == 0)
+		vim_free(((char_u **)scan_files.ga_data)[i]);
+	    else
+		((char_u **)scan_files.ga_data)[j++] =
+					    ((char_u **)scan_files.ga_data)[i];
+	scan_files.ga_room += scan_files.ga_len - j;
+	scan_files.ga_len = j;
+    }
+
+    /*
+     * Keep the files and lines of the tags file for files that are not
+     * scanned.
+     */
+    for (i = 0; i < old_files.ga_len; ++i)
+	if (bsearch(&((char_u **)old_files.ga_data)[i], scan_files.ga_data,
+		    (size_t)scan_files.ga_len, sizeof(char_u *),
+							 xref_strcmp) == NULL)
+	{
+	    if (ga_grow(&files, 1) == FAIL)
+		goto theend;
+	    ((char_u **)files.ga_data)[files.ga_len++] =
+					    ((char_u **)old_files.ga_data)[i];
+	    --files.ga_room;
+	}
+    for (i = j = 0; i < old_lines.ga_len; ++i)
+    {
+	line = ((char_u **)old_lines.ga_data)[i];
+	p = vim_strchr(line, TAB);
+	q = p == NULL ? NULL : vim_strchr(p + 1, TAB);
+	if (q == NULL)
+	    continue;
+	++p;
+	*q = NUL;
+	if (bsearch(&p, scan_files.ga_data, (size_t)scan_files.ga_len,
+					sizeof(char_u *), xref_strcmp) == NULL)
+	    ((char_u **)old_lines.ga_data)[j++] = line;
+	*q = TAB;
+    }
+    old_lines.ga_room += old_lines.ga_len - j;
+    old_lines.ga_len = j;
+
+    /*
+     * Scan the files.  Names relative to the tags file are used from its
+     * directory.  A file that can't be read is removed from the tags file.
+     */
+    for (i = 0; i < scan_files.ga_len && !got_int; ++i)
+    {
+	p = ((char_u **)scan_files.ga_data)[i];
+	if (vim_isAbsName(p))
+	    fname = vim_strsave(p);
+	else
+	    fname = concat_fnames(dir, p, FALSE);
+	if (fname == NULL)
+	    goto theend;
+	if (report && p_verbose > 0)
+	{
+	    smsg((char_u *)_("Scanning %s"), fname);
+	    out_flush();
+	}
+	if (xref_scan(fname, p, &new_lines) == OK && ga_grow(&files, 1) == OK)
+	{
+	    ((char_u **)files.ga_data)[files.ga_len++] = p;
+	    --files.ga_room;
+	}
+	vim_free(fname);
+    }
+    if (got_int)
+    {
+	if (report)
+	    EMSG(_(e_interr));
+	goto theend;
+    }
+
+    qsort(files.ga_data, (size_t)files.ga_len, sizeof(char_u *), xref_strcmp);
+    qsort(new_lines.ga_data, (size_t)new_lines.ga_len, sizeof(char_u *),
+								    xref_cmp);
+
+    /*
+     * Write the tags file: the header, then the kept lines merged with the
+     * new ones.  Write a temp file in the same directory and rename it, so
+     * that a failure or interrupt doesn't destroy the tags file.
+     */
+    tmpname = modname(tagfname, (char_u *)".tmp", FALSE);
+    if (tmpname == NULL)
+	goto theend;
+    perm = mch_getperm(tagfname);
+    tmpfd = mch_open((char *)tmpname, O_WRONLY | O_CREAT | O_EXCL | O_EXTRA,
+						   perm < 0 ? 0644 : perm);
+    if (tmpfd < 0 || (fd = fdopen(tmpfd, WRITEBIN)) == NULL)
+    {
+	if (tmpfd >= 0)
+	{
+	    close(tmpfd);
+	    mch_remove(tmpname);
+	}
+	if (report)
+	    EMSG2(_(e_notcreate), tmpname);
+	goto theend;
+    }
+    fprintf(fd, "!_TAG_FILE_FORMAT\t1\t//\n");
+    fprintf(fd, "!_TAG_FILE_SORTED\t1\t/0=unsorted, 1=sorted, 2=foldcase/\n");
+    fprintf(fd, "%s\n", XREF_PROGRAM);
+    for (i = 0; i < files.ga_len; ++i)
+	fprintf(fd, "%s%s\t//\n", XREF_FILE, ((char_u **)files.ga_data)[i]);
+    line = NULL;
+    for (i = j = 0; i < old_lines.ga_len || j < new_lines.ga_len; )
+    {
+	if (j >= new_lines.ga_len || (i < old_lines.ga_len
+		    && xref_cmp(&((char_u **)old_lines.ga_data)[i],
+				&((char_u **)new_lines.ga_data)[j]) <= 0))
+	    p = ((char_u **)old_lines.ga_data)[i++];
+	else
+	    p = ((char_u **)new_lines.ga_data)[j++];
+	if (line == NULL || STRCMP(line, p) != 0)
+	{
+	    fprintf(fd, "%s\n", p);
+	    ++count;
+	}
+	line = p;
+    }
+    if (ferror(fd) | fclose(fd) || got_int
+				      || vim_rename(tmpname, tagfname) != 0)
+    {
+	mch_remove(tmpname);
+	if (report)
+	    EMSG(got_int ? _(e_interr) : _(e_write));
+	goto theend;
+    }
+    if (perm >= 0)
+	(void)mch_setperm(tagfname, perm);
+    retval = OK;
+    xref_remember(tagfname, dir, &files);
+    if (report)
+	smsg((char_u *)_("\"%s\" %ld references in %d files"),
+					tagfname, count, files.ga_len);
+
+theend:
+    ga_clear_strings(&new_lines);
+    ga_clear(&files);
+    ga_clear_strings(&scan_files);
+    ga_clear(&old_lines);
+    ga_clear(&old_files);
+    vim_free(tmpname);
+    vim_free(data);
+    vim_free(dir);
+    return retval;
+}
+
+/*
+ * ":mkxref[!] {tagsfile} [file ...]"
+ * Make or update tags file {tagsfile} with the identifiers used in the files.
+ * Without a file the files already in {tagsfile} are scanned again.
+ */
+    void
+ex_mkxref(eap)
+    exarg_T	*eap;
+{
+    char_u	*tagfname = eap->arg;
+    char_u	*arg;
+    garray_T	ga;
+    int		fcount = 0;
+    char_u	**fnames = NULL;
+
+    arg = do_one_arg(tagfname);
+    if (*tagfname == NUL)
+    {
+	EMSG(_(e_argreq));
+	return;
+    }
+
+    /* Collect the file arguments and expand wildcards. */
+    if (*arg != NUL)
+    {
+	ga_init2(&ga, (int)sizeof(char_u *), 20);
+	while (*arg != NUL)
+	{
+	    if (ga_grow(&ga, 1) == FAIL)
+	    {
+		ga_clear(&ga);
+		return;
+	    }
+	    ((char_u **)ga.ga_data)[ga.ga_len++] = arg;
+	    --ga.ga_room;
+	    arg = do_one_arg(arg);
+	}
+	if (expand_wildcards(ga.ga_len, (char_u **)ga.ga_data,
+					 &fcount, &fnames, EW_FILE) == FAIL)
+	    fcount = 0;
+	ga_clear(&ga);
+	if (fcount == 0)
+	{
+	    EMSG(_(e_nomatch));
+	    return;
+	}
+    }
+    else if (eap->forceit)
+    {
+	EMSG(_(e_argreq));
+	return;
+    }
+    else if (mch_getperm(tagfname) < 0)
+    {
+	EMSG2(_(e_notopen), tagfname);
+	return;
+    }
+
+    (void)xref_update(tagfname, fcount, fnames, eap->forceit, TRUE);
+    if (fcount > 0)
+	FreeWild(fcount, fnames);
+}
+
+/*
+ * Remember that tags file "tagfname" in directory "dir" was written with
+ * the files "files", relative to "dir".
+ */
+    static void
+xref_remember(tagfname, dir, files)
+    char_u	*tagfname;
+    char_u	*dir;
+    garray_T	*files;
+{
+    xref_T	*xp;
+    char_u	*full;
+    char_u	*p;
+    int		i;
+
+    full = FullName_save(tagfname, TRUE);
+    if (full == NULL)
+	return;
+    for (xp = first_xref; xp != NULL; xp = xp->xr_next)
+	if (fnamecmp(xp->xr_tagfname, full) == 0)
+	    break;
+    if (xp == NULL)
+    {
+	xp = (xref_T *)alloc_clear((unsigned)sizeof(xref_T));
+	if (xp == NULL)
+	{
+	    vim_free(full);
+	    return;
+	}
+	xp->xr_tagfname = full;
+	xp->xr_next = first_xref;
+	first_xref = xp;
+    }
+    else
+    {
+	vim_free(full);
+	ga_clear_strings(&xp->xr_files);
+    }
+
+    ga_init2(&xp->xr_files, (int)sizeof(char_u *), 100);
+    for (i = 0; i < files->ga_len; ++i)
+    {
+	p = ((char_u **)files->ga_data)[i];
+	if (vim_isAbsName(p))
+	    p = vim_strsave(p);
+	else
+	    p = concat_fnames(dir, p, FALSE);
+	if (p == NULL || ga_grow(&xp->xr_files, 1) == FAIL)
+	{
+	    /* Out of memory: Don't update this tags file. */
+	    vim_free(p);
+	    xref_forget(xp);
+	    return;
+	}
+	((char_u **)xp->xr_files.ga_data)[xp->xr_files.ga_len++] = p;
+	--xp->xr_files.ga_room;
+    }
+    qsort(xp->xr_files.ga_data, (size_t)xp->xr_files.ga_len,
+					    sizeof(char_u *), xref_strcmp);
+}
+
+/*
+ * Forget about the tags file "xp", it is no longer updated.
+ */
+    static void
+xref_forget(xp)
+    xref_T	*xp;
+{
+    xref_T	**xpp;
+
+    for (xpp = &first_xref; *xpp != NULL; xpp = &(*xpp)->xr_next)
+	if (*xpp == xp)
+	{
+	    *xpp = xp->xr_next;
+	    break;
+	}
+    ga_clear_strings(&xp->xr_files);
+    vim_free(xp->xr_tagfname);
+    vim_free(xp);
+}
+
+/*
+ * Called after file "fname" was written: Update the tags files that were made
+ * or updated with ":mkxref" in this session and include "fname".  Does
+ * nothing when ":mkxref" wasn't used.
+ */
+    void
+xref_written(fname)
+    char_u	*fname;
+{
+    xref_T	*xp;
+    xref_T	*next;
+    char_u	*full;
+
+    if (first_xref == NULL)
+	return;
+    full = FullName_save(fname, FALSE);
+    if (full == NULL)
+	return;
+    for (xp = first_xref; xp != NULL; xp = next)
+    {
+	next = xp->xr_next;
+	if (bsearch(&full, xp->xr_files.ga_data, (size_t)xp->xr_files.ga_len,
+				  sizeof(char_u *), xref_strcmp) == NULL)
+	    continue;
+	/* When the tags file was deleted or replaced by another program
+	 * stop updating it. */
+	if (mch_getperm(xp->xr_tagfname) < 0
+		|| xref_update(xp->xr_tagfname, 1, &full, FALSE, FALSE) == FAIL)
+	    xref_forget(xp);
+    }
+    vim_free(full);
+}
+#endif
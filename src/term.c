@@ -1002,6 +1002,8 @@ struct builtin_term builtin_termcaps[] =
     {(int)KS_CWP,	IF_EB("\033[3;%d;%dt", ESC_STR "[3;%d;%dt")},
 #  endif
     {(int)KS_CRV,	IF_EB("\033[>c", ESC_STR "[>c")},
+    {(int)KS_CBE,	IF_EB("\033[?2004h", ESC_STR "[?2004h")},
+    {(int)KS_CBD,	IF_EB("\033[?2004l", ESC_STR "[?2004l")},
     {K_UP,		IF_EB("\033OA", ESC_STR "OA")},
     {K_DOWN,		IF_EB("\033OB", ESC_STR "OB")},
     {K_RIGHT,		IF_EB("\033OC", ESC_STR "OC")},
@@ -1067,6 +1069,8 @@ struct builtin_term builtin_termcaps[] =
     {K_KMULTIPLY,	IF_EB("\033Oj", ESC_STR "Oj")},	/* keypad * */
     {K_KENTER,		IF_EB("\033OM", ESC_STR "OM")},	/* keypad Enter */
     {K_KDEL,		IF_EB("\033[3~", ESC_STR "[3~")},	/* keypad Del */
+    {K_PS,		IF_EB("\033[200~", ESC_STR "[200~")},
+    {K_PE,		IF_EB("\033[201~", ESC_STR "[201~")},
 
     {BT_EXTRA_KEYS,   ""},
     {TERMCAP2KEY('k', '0'), IF_EB("\033[10~", ESC_STR "[10~")},	/* F0 */
@@ -1280,6 +1284,10 @@ struct builtin_term builtin_termcaps[] =
     {(int)KS_CWP,	"[%dCWP%d]"},
 #  endif
     {(int)KS_CRV,	"[CRV]"},
+    {(int)KS_BSU,	"[BSU]"},
+    {(int)KS_ESU,	"[ESU]"},
+    {(int)KS_CBE,	"[BE]"},
+    {(int)KS_CBD,	"[BD]"},
     {K_UP,		"[KU]"},
     {K_DOWN,		"[KD]"},
     {K_LEFT,		"[KL]"},
@@ -2511,6 +2519,21 @@ termcapinit(name)
 static char_u		out_buf[OUT_SIZE + 1];
 static int		out_pos = 0;	/* number of chars in out_buf */
 
+/*
+ * While updating the screen the output is collected in "out_frame_ga", which
+ * grows as needed, so that a whole screen update is written with one
+ * ui_write() call.  out_frame_depth is non-zero while inside a frame.
+ * When t_BU is set the frame starts with it, and ends with t_EU.
+ */
+static garray_T		out_frame_ga = {0, 0, sizeof(char_u), 4096, NULL};
+static int		out_frame_depth = 0;	/* nesting of frames */
+static int		out_collecting = FALSE;	/* using out_frame_ga */
+static int		out_frame_hdr;	/* length of t_BU in out_frame_ga */
+static long		out_frame_start_bytes;
+static long		out_frame_start_writes;
+
+static void out_buf_full __ARGS((void));
+
 /*
  * out_flush(): flush the output buffer
  */
@@ -2519,15 +2542,128 @@ out_flush()
 {
     int	    len;
 
+    if (out_collecting && out_frame_ga.ga_len > 0)
+    {
+	/* Inside a frame: write what was collected plus out_buf[] at once. */
+	if (out_pos == 0 && out_frame_ga.ga_len == out_frame_hdr)
+	    return;		/* nothing besides t_BU */
+	len = out_pos + (int)STRLEN(T_ESU);
+	if (ga_grow(&out_frame_ga, len) == OK)
+	{
+	    char_u  *p = (char_u *)out_frame_ga.ga_data + out_frame_ga.ga_len;
+
+	    mch_memmove(p, out_buf, (size_t)out_pos);
+	    mch_memmove(p + out_pos, T_ESU, STRLEN(T_ESU));
+	    out_frame_ga.ga_len += len;
+	    out_frame_ga.ga_room -= len;
+	    out_pos = 0;
+	}
+
+	/* set ga_len back to the t_BU header before ui_write, to avoid
+	 * recursiveness */
+	len = out_frame_ga.ga_len;
+	out_frame_ga.ga_room += len - out_frame_hdr;
+	out_frame_ga.ga_len = out_frame_hdr;
+	out_bytes += len;
+	++out_writes;
+	ui_write((char_u *)out_frame_ga.ga_data, len);
+    }
+
     if (out_pos != 0)
     {
 	/* set out_pos to 0 before ui_write, to avoid recursiveness */
 	len = out_pos;
 	out_pos = 0;
+	out_bytes += len;
+	++out_writes;
 	ui_write(out_buf, len);
     }
 }
 
+/*
+ * Called when out_buf[] is (almost) full.  Outside of a frame it is flushed.
+ * Inside a frame its contents is moved to out_frame_ga, to be written when
+ * the frame ends.
+ */
+    static void
+out_buf_full()
+{
+    if (out_collecting && out_pos > 0 && !p_wd)
+    {
+	/* Grow by doubling, a full screen update can be big. */
+	if (out_frame_ga.ga_growsize < out_frame_ga.ga_len)
+	    out_frame_ga.ga_growsize = out_frame_ga.ga_len;
+	if (ga_grow(&out_frame_ga, out_pos) == OK)
+	{
+	    mch_memmove((char_u *)out_frame_ga.ga_data + out_frame_ga.ga_len,
+						  out_buf, (size_t)out_pos);
+	    out_frame_ga.ga_len += out_pos;
+	    out_frame_ga.ga_room -= out_pos;
+	    out_pos = 0;
+	    return;
+	}
+    }
+    out_flush();
+}
+
+/*
+ * Start collecting output for a screen update.  Frames may be nested, the
+ * output is written when the outermost one ends.  Every call must be matched
+ * with a call to out_frame_end().
+ * An explicit out_flush() inside a frame still writes the output, e.g., to
+ * show a message before waiting.
+ */
+    void
+out_frame_start()
+{
+    if (out_frame_depth++ > 0)
+	return;
+#ifdef FEAT_GUI
+    /* The GUI draws directly, collecting output doesn't help. */
+    if (gui.in_use)
+	return;
+#endif
+    /* Write what was produced before the frame separately. */
+    out_flush();
+    out_frame_start_bytes = out_bytes;
+    out_frame_start_writes = out_writes;
+
+    out_frame_hdr = 0;
+    out_frame_ga.ga_room += out_frame_ga.ga_len;
+    out_frame_ga.ga_len = 0;
+    if (*T_BSU != NUL && ga_grow(&out_frame_ga, (int)STRLEN(T_BSU)) == OK)
+    {
+	out_frame_hdr = (int)STRLEN(T_BSU);
+	mch_memmove(out_frame_ga.ga_data, T_BSU, (size_t)out_frame_hdr);
+	out_frame_ga.ga_len = out_frame_hdr;
+	out_frame_ga.ga_room -= out_frame_hdr;
+    }
+    out_collecting = TRUE;
+}
+
+/*
+ * End collecting output for a screen update, see out_frame_start().
+ */
+    void
+out_frame_end()
+{
+    if (out_frame_depth == 0 || --out_frame_depth > 0 || !out_collecting)
+	return;
+    out_flush();
+    out_collecting = FALSE;
+    out_frame_ga.ga_room += out_frame_ga.ga_len;
+    out_frame_ga.ga_len = 0;
+    out_frame_bytes = out_bytes - out_frame_start_bytes;
+    out_frame_writes = out_writes - out_frame_start_writes;
+
+    /* Don't keep a huge buffer around after redrawing a large screen. */
+    if (out_frame_ga.ga_room > 65536)
+    {
+	ga_clear(&out_frame_ga);
+	out_frame_ga.ga_growsize = 4096;
+    }
+}
+
 #if defined(FEAT_MBYTE) || defined(PROTO)
 /*
  * Sometimes a byte out of a multi-byte character is written with out_char().
@@ -2537,7 +2673,7 @@ out_flush()
 out_flush_check()
 {
     if (enc_dbcs != 0 && out_pos >= OUT_SIZE - MB_MAXBYTES)
-	out_flush();
+	out_buf_full();
 }
 #endif
 
@@ -2549,6 +2685,11 @@ out_flush_check()
 out_trash()
 {
     out_pos = 0;
+    if (out_frame_ga.ga_len > out_frame_hdr)
+    {
+	out_frame_ga.ga_room += out_frame_ga.ga_len - out_frame_hdr;
+	out_frame_ga.ga_len = out_frame_hdr;
+    }
 }
 #endif
 
@@ -2570,8 +2711,10 @@ out_char(c)
     out_buf[out_pos++] = c;
 
     /* For testing we flush each time. */
-    if (out_pos >= OUT_SIZE || p_wd)
+    if (p_wd)
 	out_flush();
+    else if (out_pos >= OUT_SIZE)
+	out_buf_full();
 }
 
 static void out_char_nf __ARGS((unsigned));
@@ -2591,7 +2734,7 @@ out_char_nf(c)
     out_buf[out_pos++] = c;
 
     if (out_pos >= OUT_SIZE)
-	out_flush();
+	out_buf_full();
 }
 
 /*
@@ -2608,7 +2751,7 @@ out_str_nf(s)
     char_u *s;
 {
     if (out_pos > OUT_SIZE - 20)  /* avoid terminal strings being split up */
-	out_flush();
+	out_buf_full();
     while (*s)
 	out_char_nf(*s++);
 
@@ -2639,7 +2782,7 @@ out_str(s)
 #endif
 	/* avoid terminal strings being split up */
 	if (out_pos > OUT_SIZE - 20)
-	    out_flush();
+	    out_buf_full();
 #ifdef HAVE_TGETENT
 	tputs((char *)s, 1, TPUTSFUNCAST out_char_nf);
 #else
@@ -2671,6 +2814,28 @@ term_cursor_right(i)
     OUT_STR(tgoto((char *)T_CRI, 0, i));
 }
 
+/*
+ * Return the number of bytes term_windgoto() would output, for choosing the
+ * cheapest way to move the cursor.
+ */
+    int
+term_windgoto_len(row, col)
+    int	    row;
+    int	    col;
+{
+    return (int)STRLEN(tgoto((char *)T_CM, col, row));
+}
+
+/*
+ * Return the number of bytes term_cursor_right() would output.
+ */
+    int
+term_cursor_right_len(i)
+    int	    i;
+{
+    return (int)STRLEN(tgoto((char *)T_CRI, 0, i));
+}
+
     void
 term_append_lines(line_count)
     int	    line_count;
@@ -3190,6 +3355,7 @@ starttermcap()
     {
 	out_str(T_TI);			/* start termcap mode */
 	out_str(T_KS);			/* start "keypad transmit" mode */
+	out_str(T_BE);			/* enable bracketed paste mode */
 	out_flush();
 	termcap_active = TRUE;
 	screen_start();			/* don't know where cursor is now */
@@ -3217,6 +3383,7 @@ stoptermcap()
 	 * them. */
 	check_for_codes_from_term();
 #endif
+	out_str(T_BD);			/* disable bracketed paste mode */
 	out_str(T_KE);			/* stop "keypad transmit" mode */
 	out_flush();
 	termcap_active = FALSE;
@@ -76,6 +76,10 @@ enum SpecialKey
     KS_CWP,	/* set window position in pixels */
     KS_CWS,	/* set window size in characters */
     KS_CRV,	/* request version string */
+    KS_BSU,	/* begin synchronized update */
+    KS_ESU,	/* end synchronized update */
+    KS_CBE,	/* enable bracketed paste mode */
+    KS_CBD,	/* disable bracketed paste mode */
 #ifdef FEAT_VERTSPLIT
     KS_CSV,	/* scroll region vertical */
 #endif
@@ -149,6 +153,10 @@ extern char_u *(term_strings[]);    /* current terminal strings */
 #define T_CWP	(term_str(KS_CWP))	/* window position */
 #define T_CWS	(term_str(KS_CWS))	/* window size */
 #define T_CRV	(term_str(KS_CRV))	/* request version string */
+#define T_BSU	(term_str(KS_BSU))	/* begin synchronized update */
+#define T_ESU	(term_str(KS_ESU))	/* end synchronized update */
+#define T_BE	(term_str(KS_CBE))	/* enable bracketed paste mode */
+#define T_BD	(term_str(KS_CBD))	/* disable bracketed paste mode */
 #define T_OP	(term_str(KS_OP))	/* original color pair */
 
 #define TMODE_COOK  0	/* terminal mode for external cmds and Ex mode */
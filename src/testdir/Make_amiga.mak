@@ -23,7 +23,7 @@ SCRIPTS = test1.out test3.out test4.out test5.out test6.out \
 		test33.out test34.out test35.out test36.out test37.out \
 		test38.out test39.out test40.out test41.out test42.out \
 		test43.out test44.out test45.out test46.out test47.out \
-		test48.out test51.out
+		test48.out test51.out test53.out test54.out
 
 .SUFFIXES: .in .out
 
@@ -95,3 +95,5 @@ test46.out: test46.in
 test47.out: test47.in
 test48.out: test48.in
 test51.out: test51.in
+test53.out: test53.in
+test54.out: test54.in
@@ -41,28 +41,90 @@
  * curbuf->b_u_curhead points to the header of the last undo (the next redo),
  * or is NULL if nothing has been undone.
  *
+ * When a change is made after undoing, the undone changes are not freed but
+ * kept as an alternate branch: the new header gets the same uh_next as
+ * b_u_curhead had, and is linked in front of it with uh_alt_next.  Thus the
+ * headers form a tree, b_u_newhead is the end of the branch that undo and
+ * redo currently use.  ":undo N" moves to another branch.
+ *
+ * Lines that are changed but not inserted or deleted are mostly stored as the
+ * difference with the text that is in the buffer when the entry is used,
+ * see u_compress_entry().  Changing one character in a long line then only
+ * keeps a few bytes.
+ *
  * All data is allocated with u_alloc_line(), thus it will be freed as soon as
  * we switch files!
  */
 
 #include "vim.h"
 
+#if defined(HAVE_GETTIMEOFDAY) && defined(HAVE_SYS_TIME_H)
+# define UNDO_TIME		/* measure the time used for undo/redo */
+#endif
+
+/*
+ * Only store a line as a difference when it saves at least this many bytes.
+ */
+#define UD_MINSAVE  16
+
+/* Statistics collected by ":undolist". */
+typedef struct
+{
+    long	us_lines;	/* nr of saved lines */
+    long	us_bytes;	/* bytes used for saved text */
+    long	us_dlines;	/* nr of lines stored as a difference */
+    long	us_dbytes;	/* bytes used for those */
+    long	us_dfull;	/* bytes those would use in full */
+} undostat_T;
+
+/* A leaf of the undo tree, for ":undolist". */
+typedef struct
+{
+    long	ul_seq;		/* change number */
+    long	ul_changes;	/* nr of changes to get there */
+} undoleaf_T;
+
 static u_entry_T *u_get_headentry __ARGS((void));
 static void u_getbot __ARGS((void));
 static int u_savecommon __ARGS((linenr_T, linenr_T, linenr_T));
+static int undo_allowed __ARGS((void));
 static void u_doit __ARGS((int count));
+static int u_undo_step __ARGS((void));
+static int u_redo_step __ARGS((void));
+static u_header_T *u_find_seq __ARGS((u_header_T *uhp, long seq));
+static void u_make_first __ARGS((u_header_T *uhp));
 static void u_undoredo __ARGS((void));
 static void u_undo_end __ARGS((void));
-static void u_freelist __ARGS((struct u_header *));
+static void u_unch_branch __ARGS((u_header_T *uhp));
+static void u_list_branch __ARGS((u_header_T *uhp, long changes, garray_T *gap, undostat_T *st));
+static int
+#ifdef __BORLANDC__
+    _RTLENTRYF
+#endif
+	undoleaf_compare __ARGS((const void *s1, const void *s2));
+static void u_freeheader __ARGS((u_header_T *uhp, u_header_T **uhpp));
+static void u_freebranch __ARGS((u_header_T *uhp, u_header_T **uhpp));
+static void u_freeentries __ARGS((u_header_T *uhp, u_header_T **uhpp));
 static void u_freeentry __ARGS((u_entry_T *, long));
-
-static char_u *u_blockalloc __ARGS((long_u));
-static void u_free_line __ARGS((char_u *, int keep));
+static char_u *u_delta_make __ARGS((char_u *line, char_u *base));
+static char_u *u_delta_apply __ARGS((char_u *delta, char_u *base));
+static void u_compress_entry __ARGS((u_entry_T *uep, linenr_T lnum, long count));
+static int u_expand_entry __ARGS((u_entry_T *uep, linenr_T lnum));
+
+static mblock_T *u_blockalloc __ARGS((int c, long_u size));
+static void u_blockrelease __ARGS((mblock_T *mbp));
+static void u_free_line __ARGS((char_u *));
 static char_u *u_alloc_line __ARGS((unsigned));
 static char_u *u_save_line __ARGS((linenr_T));
 
 static long	u_newcount, u_oldcount;
 
+#ifdef UNDO_TIME
+static long	u_usec = 0;	/* time used by the last undo/redo */
+static long	u_time_lines = 0; /* nr of lines changed by it */
+#endif
+static long	u_walk = 0;	/* last used value for uh_walk */
+
 /*
  * When 'u' flag included in 'cpoptions', we behave like vi.  Need to remember
  * the action that "u" should do.
@@ -154,6 +216,8 @@ u_savecommon(top, bot, newbot)
     linenr_T		lnum;
     long		i;
     struct u_header	*uhp;
+    u_header_T		*old_curhead;
+    u_header_T		*uhfree;
     u_entry_T		*uep;
     u_entry_T		*prev_uep;
     long		size;
@@ -215,17 +279,34 @@ u_savecommon(top, bot, newbot)
 #endif
 
 	/*
-	 * if we undid more than we redid, free the entry lists before and
-	 * including curbuf->b_u_curhead
+	 * If we undid more than we redid, keep the entry lists before and
+	 * including curbuf->b_u_curhead as an alternate branch.
 	 */
-	while (curbuf->b_u_curhead != NULL)
-	    u_freelist(curbuf->b_u_newhead);
+	old_curhead = curbuf->b_u_curhead;
+	if (old_curhead != NULL)
+	{
+	    curbuf->b_u_newhead = old_curhead->uh_next;
+	    curbuf->b_u_curhead = NULL;
+	}
 
 	/*
 	 * free headers to keep the size right
 	 */
 	while (curbuf->b_u_numhead > p_ul && curbuf->b_u_oldhead != NULL)
-	    u_freelist(curbuf->b_u_oldhead);
+	{
+	    uhfree = curbuf->b_u_oldhead;
+
+	    /* If there is no branch only free one header.  Otherwise free the
+	     * oldest alternate branch as a whole. */
+	    if (uhfree->uh_alt_next == NULL)
+		u_freeheader(uhfree, &old_curhead);
+	    else
+	    {
+		while (uhfree->uh_alt_next != NULL)
+		    uhfree = uhfree->uh_alt_next;
+		u_freebranch(uhfree, &old_curhead);
+	    }
+	}
 
 	if (p_ul < 0)		/* no undo at all */
 	{
@@ -242,8 +323,22 @@ u_savecommon(top, bot, newbot)
 	    goto nomem;
 	uhp->uh_prev = NULL;
 	uhp->uh_next = curbuf->b_u_newhead;
+	uhp->uh_alt_next = old_curhead;
+	if (old_curhead != NULL)
+	{
+	    uhp->uh_alt_prev = old_curhead->uh_alt_prev;
+	    if (uhp->uh_alt_prev != NULL)
+		uhp->uh_alt_prev->uh_alt_next = uhp;
+	    old_curhead->uh_alt_prev = uhp;
+	    if (curbuf->b_u_oldhead == old_curhead)
+		curbuf->b_u_oldhead = uhp;
+	}
+	else
+	    uhp->uh_alt_prev = NULL;
 	if (curbuf->b_u_newhead != NULL)
 	    curbuf->b_u_newhead->uh_prev = uhp;
+	uhp->uh_seq = ++curbuf->b_u_seq_last;
+	uhp->uh_walk = 0;
 	uhp->uh_entry = NULL;
 	uhp->uh_getbot_entry = NULL;
 	uhp->uh_cursor = curwin->w_cursor;	/* save cursor pos. for undo */
@@ -323,6 +418,11 @@ u_savecommon(top, bot, newbot)
 			curbuf->b_u_newhead->uh_entry = uep;
 		    }
 
+		    /* The line is going to change, the saved text can't be
+		     * a difference with it. */
+		    if (u_expand_entry(uep, top + 1) == FAIL)
+			goto nomem;
+
 		    /* The executed command may change the line count. */
 		    if (newbot != 0)
 			uep->ue_bot = newbot;
@@ -362,6 +462,8 @@ u_savecommon(top, bot, newbot)
 
     uep->ue_size = size;
     uep->ue_top = top;
+    uep->ue_array = NULL;
+    uep->ue_delta = NULL;
     if (newbot != 0)
 	uep->ue_bot = newbot;
     /*
@@ -452,63 +554,227 @@ u_redo(count)
 }
 
 /*
- * Undo or redo, depending on 'undo_undoes', 'count' times.
+ * Return FAIL and give an error message when the text can't be changed by
+ * undo or redo.
  */
-    static void
-u_doit(count)
-    int count;
+    static int
+undo_allowed()
 {
     /* Don't allow changes when 'modifiable' is off. */
     if (!curbuf->b_p_ma)
     {
 	EMSG(_(e_modifiable));
-	return;
+	return FAIL;
     }
 #ifdef HAVE_SANDBOX
     /* In the sandbox it's not allowed to change the text. */
     if (sandbox != 0)
     {
 	EMSG(_(e_sandbox));
-	return;
+	return FAIL;
     }
 #endif
+    return OK;
+}
+
+/*
+ * Undo or redo, depending on 'undo_undoes', 'count' times.
+ */
+    static void
+u_doit(count)
+    int count;
+{
+    if (undo_allowed() == FAIL)
+	return;
 
     u_newcount = 0;
     u_oldcount = 0;
+#ifdef UNDO_TIME
+    u_usec = 0;
+#endif
     while (count--)
     {
 	if (undo_undoes)
 	{
-	    if (curbuf->b_u_curhead == NULL)		/* first undo */
-		curbuf->b_u_curhead = curbuf->b_u_newhead;
-	    else if (p_ul > 0)				/* multi level undo */
-		/* get next undo */
-		curbuf->b_u_curhead = curbuf->b_u_curhead->uh_next;
-	    /* nothing to undo */
-	    if (curbuf->b_u_numhead == 0 || curbuf->b_u_curhead == NULL)
-	    {
-		/* stick curbuf->b_u_curhead at end */
-		curbuf->b_u_curhead = curbuf->b_u_oldhead;
-		beep_flush();
+	    if (u_undo_step() == FAIL)
 		break;
-	    }
-
-	    u_undoredo();
 	}
-	else
+	else if (u_redo_step() == FAIL)
+	    break;
+    }
+    u_undo_end();
+}
+
+/*
+ * Undo the change that was made to get to the current state.
+ * Returns FAIL and beeps when there is nothing to undo.
+ */
+    static int
+u_undo_step()
+{
+    if (curbuf->b_u_curhead == NULL)		/* first undo */
+	curbuf->b_u_curhead = curbuf->b_u_newhead;
+    else if (p_ul > 0)				/* multi level undo */
+	/* get next undo */
+	curbuf->b_u_curhead = curbuf->b_u_curhead->uh_next;
+    /* nothing to undo */
+    if (curbuf->b_u_numhead == 0 || curbuf->b_u_curhead == NULL)
+    {
+	/* stick curbuf->b_u_curhead at end */
+	curbuf->b_u_curhead = curbuf->b_u_oldhead;
+	beep_flush();
+	return FAIL;
+    }
+
+    u_undoredo();
+    return OK;
+}
+
+/*
+ * Redo the change in b_u_curhead.
+ * Returns FAIL and beeps when there is nothing to redo.
+ */
+    static int
+u_redo_step()
+{
+    if (curbuf->b_u_curhead == NULL || p_ul <= 0)
+    {
+	beep_flush();	/* nothing to redo */
+	return FAIL;
+    }
+
+    u_undoredo();
+    /* Advance for next redo.  Set "newhead" when at the end of the branch. */
+    if (curbuf->b_u_curhead->uh_prev == NULL)
+	curbuf->b_u_newhead = curbuf->b_u_curhead;
+    curbuf->b_u_curhead = curbuf->b_u_curhead->uh_prev;
+    return OK;
+}
+
+/*
+ * ":undo N": Go to the state just after change "target", also when it is in
+ * another branch of the undo tree.  Zero is the state before the first
+ * change.  Undoes changes up to where the branches meet, and redoes the
+ * changes from there.
+ */
+    void
+u_undo_to(target)
+    long	target;
+{
+    u_header_T	*tp;
+    u_header_T	*uhp;
+    u_header_T	*common;
+    u_header_T	*first = NULL;
+    long	ucount;
+    long	rcount;
+
+    if (undo_allowed() == FAIL)
+	return;
+    if (curbuf->b_u_synced == FALSE)
+	u_sync();
+
+    if (target == 0)
+	tp = NULL;
+    else
+    {
+	tp = u_find_seq(curbuf->b_u_oldhead, target);
+	if (tp == NULL)
 	{
-	    if (curbuf->b_u_curhead == NULL || p_ul <= 0)
-	    {
-		beep_flush();	/* nothing to redo */
+	    EMSGN(_("E680: Undo number %ld not found"), target);
+	    return;
+	}
+    }
+
+    /* Mark the target and the changes it depends on. */
+    ++u_walk;
+    for (uhp = tp; uhp != NULL; uhp = uhp->uh_next)
+	uhp->uh_walk = u_walk;
+
+    /* Count the changes to undo from the current state up to a marked one,
+     * where the two branches meet (NULL: the state before all changes). */
+    ucount = 0;
+    uhp = curbuf->b_u_curhead != NULL ? curbuf->b_u_curhead->uh_next
+						       : curbuf->b_u_newhead;
+    for ( ; uhp != NULL && uhp->uh_walk != u_walk; uhp = uhp->uh_next)
+	++ucount;
+    common = uhp;
+
+    /* Make the branch down to the target the one that is used for redo. */
+    rcount = 0;
+    for (uhp = tp; uhp != common; uhp = uhp->uh_next)
+    {
+	u_make_first(uhp);
+	first = uhp;
+	++rcount;
+    }
+
+    u_newcount = 0;
+    u_oldcount = 0;
+#ifdef UNDO_TIME
+    u_usec = 0;
+#endif
+    while (ucount-- > 0)
+	if (u_undo_step() == FAIL)
+	    break;
+    if (rcount > 0)
+    {
+	curbuf->b_u_curhead = first;
+	while (rcount-- > 0)
+	    if (u_redo_step() == FAIL)
 		break;
-	    }
+    }
+    u_undo_end();
+}
 
-	    u_undoredo();
-	    /* advance for next redo */
-	    curbuf->b_u_curhead = curbuf->b_u_curhead->uh_prev;
+/*
+ * Find the header for change "seq" in the tree starting at "uhp".
+ */
+    static u_header_T *
+u_find_seq(uhp, seq)
+    u_header_T	*uhp;
+    long	seq;
+{
+    u_header_T	*found;
+
+    for ( ; uhp != NULL; uhp = uhp->uh_prev)
+    {
+	if (uhp->uh_seq == seq)
+	    return uhp;
+	if (uhp->uh_alt_next != NULL)
+	{
+	    found = u_find_seq(uhp->uh_alt_next, seq);
+	    if (found != NULL)
+		return found;
 	}
     }
-    u_undo_end();
+    return NULL;
+}
+
+/*
+ * Make "uhp" the first in its list of alternates, so that redo uses it.
+ */
+    static void
+u_make_first(uhp)
+    u_header_T	*uhp;
+{
+    u_header_T	*first;
+
+    if (uhp->uh_alt_prev == NULL)
+	return;
+    for (first = uhp; first->uh_alt_prev != NULL; first = first->uh_alt_prev)
+	;
+
+    uhp->uh_alt_prev->uh_alt_next = uhp->uh_alt_next;
+    if (uhp->uh_alt_next != NULL)
+	uhp->uh_alt_next->uh_alt_prev = uhp->uh_alt_prev;
+    uhp->uh_alt_next = first;
+    uhp->uh_alt_prev = NULL;
+    first->uh_alt_prev = uhp;
+
+    if (curbuf->b_u_oldhead == first)
+	curbuf->b_u_oldhead = uhp;
+    if (uhp->uh_next != NULL)
+	uhp->uh_next->uh_prev = uhp;
 }
 
 /*
@@ -534,6 +800,11 @@ u_undoredo()
     int		new_flags;
     pos_T	namedm[NMARKS];
     int		empty_buffer;		    /* buffer became empty */
+#ifdef UNDO_TIME
+    struct timeval start_tv, end_tv;
+
+    gettimeofday(&start_tv, NULL);
+#endif
 
     old_flags = curbuf->b_u_curhead->uh_flags;
     new_flags = (curbuf->b_changed ? UH_CHANGED : 0) +
@@ -566,6 +837,20 @@ u_undoredo()
 	oldsize = bot - top - 1;    /* number of lines before undo */
 	newsize = uep->ue_size;	    /* number of lines after undo */
 
+	/* Lines stored as a difference with the text in the buffer are
+	 * needed in full now. */
+	if (u_expand_entry(uep, top + 1) == FAIL)
+	{
+	    do_outofmem_msg((long_u)0);
+	    while (uep != NULL)
+	    {
+		nuep = uep->ue_next;
+		u_freeentry(uep, uep->ue_size);
+		uep = nuep;
+	    }
+	    break;
+	}
+
 	if (top < newlnum)
 	{
 	    /* If the saved cursor is somewhere in this undo block, move it to
@@ -601,6 +886,7 @@ u_undoredo()
 	empty_buffer = FALSE;
 
 	/* delete the lines between top and bot and save them in newarray */
+	newarray = NULL;
 	if (oldsize)
 	{
 	    if ((newarray = (char_u **)u_alloc_line(
@@ -646,9 +932,9 @@ u_undoredo()
 		    ml_replace((linenr_T)1, uep->ue_array[i], TRUE);
 		else
 		    ml_append(lnum, uep->ue_array[i], (colnr_T)0, FALSE);
-		u_free_line(uep->ue_array[i], FALSE);
+		u_free_line(uep->ue_array[i]);
 	    }
-	    u_free_line((char_u *)uep->ue_array, FALSE);
+	    u_free_line((char_u *)uep->ue_array);
 	}
 
 	/* adjust marks */
@@ -678,6 +964,10 @@ u_undoredo()
 	uep->ue_array = newarray;
 	uep->ue_bot = top + newsize + 1;
 
+	/* When redoing this entry the buffer will contain the lines that
+	 * were just inserted. */
+	u_compress_entry(uep, top + 1, (long)newsize);
+
 	/*
 	 * insert this entry in front of the new entry list
 	 */
@@ -739,6 +1029,13 @@ u_undoredo()
 
     /* Make sure the cursor is on an existing line and column. */
     check_cursor();
+
+#ifdef UNDO_TIME
+    gettimeofday(&end_tv, NULL);
+    u_usec += (end_tv.tv_sec - start_tv.tv_sec) * 1000000L
+					  + (end_tv.tv_usec - start_tv.tv_usec);
+    u_time_lines = u_newcount > u_oldcount ? u_newcount : u_oldcount;
+#endif
 }
 
 /*
@@ -793,11 +1090,170 @@ u_sync()
 u_unchanged(buf)
     buf_T	*buf;
 {
-    struct u_header	*uh;
+    u_unch_branch(buf->b_u_oldhead);
+    buf->b_did_warn = FALSE;
+}
 
-    for (uh = buf->b_u_newhead; uh; uh = uh->uh_next)
+/*
+ * Set the UH_CHANGED flag in all headers of the tree starting at "uhp".
+ */
+    static void
+u_unch_branch(uhp)
+    u_header_T	*uhp;
+{
+    u_header_T	*uh;
+
+    for (uh = uhp; uh != NULL; uh = uh->uh_prev)
+    {
 	uh->uh_flags |= UH_CHANGED;
-    buf->b_did_warn = FALSE;
+	if (uh->uh_alt_next != NULL)
+	    u_unch_branch(uh->uh_alt_next);	    /* recursive */
+    }
+}
+
+/*
+ * ":undolist": List the leafs of the undo tree, and how much memory the undo
+ * information uses.
+ */
+/*ARGSUSED*/
+    void
+ex_undolist(eap)
+    exarg_T	*eap;
+{
+    garray_T	ga;
+    undostat_T	st;
+    undoleaf_T	*ulp;
+    long	cur;
+    int		i;
+
+    if (curbuf->b_u_oldhead == NULL)
+    {
+	MSG(_("Nothing to undo"));
+	return;
+    }
+
+    ga_init2(&ga, (int)sizeof(undoleaf_T), 20);
+    vim_memset(&st, 0, sizeof(st));
+    u_list_branch(curbuf->b_u_oldhead, 0L, &ga, &st);
+    if (ga.ga_len > 1)
+	qsort(ga.ga_data, (size_t)ga.ga_len, sizeof(undoleaf_T),
+							    undoleaf_compare);
+
+    if (curbuf->b_u_curhead != NULL)
+	cur = curbuf->b_u_curhead->uh_next == NULL ? 0L
+					 : curbuf->b_u_curhead->uh_next->uh_seq;
+    else
+	cur = curbuf->b_u_newhead == NULL ? 0L : curbuf->b_u_newhead->uh_seq;
+
+    msg_start();
+    msg_puts_attr((char_u *)_("number changes"), hl_attr(HLF_T));
+    for (i = 0; i < ga.ga_len && !got_int; ++i)
+    {
+	ulp = (undoleaf_T *)ga.ga_data + i;
+	msg_putchar('\n');
+	sprintf((char *)IObuff, "%6ld %7ld", ulp->ul_seq, ulp->ul_changes);
+	msg_puts(IObuff);
+    }
+    ga_clear(&ga);
+
+    msg_putchar('\n');
+    sprintf((char *)IObuff, _("%d changes, current is %ld"),
+						    curbuf->b_u_numhead, cur);
+    msg_puts(IObuff);
+    msg_putchar('\n');
+    sprintf((char *)IObuff, _("Saved text: %ld lines, %ld bytes"),
+						       st.us_lines, st.us_bytes);
+    msg_puts(IObuff);
+    msg_putchar('\n');
+    sprintf((char *)IObuff, _("Memory: %ld bytes in %ld blocks, %ld in use"),
+		     (long)curbuf->b_mb_alloc, curbuf->b_mb_count,
+						    (long)curbuf->b_mb_inuse);
+    msg_puts(IObuff);
+    if (st.us_dlines > 0)
+    {
+	msg_putchar('\n');
+	sprintf((char *)IObuff,
+		_("Stored as difference: %ld lines, %ld bytes instead of %ld"),
+					st.us_dlines, st.us_dbytes, st.us_dfull);
+	msg_puts(IObuff);
+    }
+#ifdef UNDO_TIME
+    if (u_time_lines > 0)
+    {
+	msg_putchar('\n');
+	sprintf((char *)IObuff, _("Last undo/redo: %ld lines in %ld.%03ld msec"),
+				  u_time_lines, u_usec / 1000L, u_usec % 1000L);
+	msg_puts(IObuff);
+    }
+#endif
+    msg_end();
+}
+
+/*
+ * Collect the leafs of the tree starting at "uhp" in "gap" and add the memory
+ * used by the entries to "st".  "changes" is the number of changes before
+ * "uhp".
+ */
+    static void
+u_list_branch(uhp, changes, gap, st)
+    u_header_T	*uhp;
+    long	changes;
+    garray_T	*gap;
+    undostat_T	*st;
+{
+    u_entry_T	*uep;
+    u_delta_T	*dp;
+    long	i;
+    long	len;
+
+    for ( ; uhp != NULL && !got_int; uhp = uhp->uh_prev)
+    {
+	if (uhp->uh_alt_next != NULL)
+	    u_list_branch(uhp->uh_alt_next, changes, gap, st);  /* recursive */
+	++changes;
+
+	for (uep = uhp->uh_entry; uep != NULL; uep = uep->ue_next)
+	    for (i = 0; i < uep->ue_size; ++i)
+	    {
+		++st->us_lines;
+		if (uep->ue_delta != NULL && uep->ue_delta[i])
+		{
+		    dp = (u_delta_T *)uep->ue_array[i];
+		    len = (long)STRLEN(dp->ud_text);
+		    ++st->us_dlines;
+		    st->us_dbytes += (long)sizeof(u_delta_T) + len;
+		    st->us_dfull += dp->ud_head + len + dp->ud_tail + 1;
+		    st->us_bytes += (long)sizeof(u_delta_T) + len;
+		}
+		else
+		    st->us_bytes += (long)STRLEN(uep->ue_array[i]) + 1;
+	    }
+
+	if (uhp->uh_prev == NULL && ga_grow(gap, 1) == OK)
+	{
+	    ((undoleaf_T *)gap->ga_data)[gap->ga_len].ul_seq = uhp->uh_seq;
+	    ((undoleaf_T *)gap->ga_data)[gap->ga_len].ul_changes = changes;
+	    ++gap->ga_len;
+	    --gap->ga_room;
+	}
+    }
+}
+
+/*
+ * Compare function for qsort() in ex_undolist(): sort on change number.
+ */
+    static int
+#ifdef __BORLANDC__
+_RTLENTRYF
+#endif
+undoleaf_compare(s1, s2)
+    const void	*s1;
+    const void	*s2;
+{
+    long	n1 = ((undoleaf_T *)s1)->ul_seq;
+    long	n2 = ((undoleaf_T *)s2)->ul_seq;
+
+    return n1 == n2 ? 0 : n1 > n2 ? 1 : -1;
 }
 
 /*
@@ -851,27 +1307,36 @@ u_getbot()
 	curbuf->b_u_newhead->uh_getbot_entry = NULL;
     }
 
+    /* The text of the last entry is complete now, the lines in the buffer
+     * stay like this until it is used for undo.  Only keep the difference
+     * with them. */
+    uep = curbuf->b_u_newhead->uh_entry;
+    u_compress_entry(uep, uep->ue_top + 1, (long)((uep->ue_bot == 0
+			      ? curbuf->b_ml.ml_line_count + 1 : uep->ue_bot)
+							   - uep->ue_top - 1));
+
     curbuf->b_u_synced = TRUE;
 }
 
 /*
- * u_freelist: free one entry list and adjust the pointers
+ * u_freeheader: free one header with its entry list and adjust the pointers.
+ * Alternate branches after it are freed as well, they can't be reached.
+ * "*uhpp" is set to NULL when it points to a freed header.
  */
     static void
-u_freelist(uhp)
-    struct u_header *uhp;
+u_freeheader(uhp, uhpp)
+    u_header_T	*uhp;
+    u_header_T	**uhpp;
 {
-    u_entry_T	*uep, *nuep;
+    u_header_T	*uhap;
 
-    for (uep = uhp->uh_entry; uep != NULL; uep = nuep)
-    {
-	nuep = uep->ue_next;
-	u_freeentry(uep, uep->ue_size);
-    }
+    if (uhp->uh_alt_next != NULL)
+	u_freebranch(uhp->uh_alt_next, uhpp);
 
-    if (curbuf->b_u_curhead == uhp)
-	curbuf->b_u_curhead = NULL;
+    if (uhp->uh_alt_prev != NULL)
+	uhp->uh_alt_prev->uh_alt_next = NULL;
 
+    /* Update the links in the list to remove the header. */
     if (uhp->uh_next == NULL)
 	curbuf->b_u_oldhead = uhp->uh_prev;
     else
@@ -880,9 +1345,70 @@ u_freelist(uhp)
     if (uhp->uh_prev == NULL)
 	curbuf->b_u_newhead = uhp->uh_next;
     else
-	uhp->uh_prev->uh_next = uhp->uh_next;
+	for (uhap = uhp->uh_prev; uhap != NULL; uhap = uhap->uh_alt_next)
+	    uhap->uh_next = uhp->uh_next;
+
+    u_freeentries(uhp, uhpp);
+}
+
+/*
+ * u_freebranch: free an alternate branch and everything after it.
+ */
+    static void
+u_freebranch(uhp, uhpp)
+    u_header_T	*uhp;
+    u_header_T	**uhpp;
+{
+    u_header_T	*tofree, *next;
+
+    /* If this is the top branch u_freeheader() must update all the
+     * pointers. */
+    if (uhp == curbuf->b_u_oldhead)
+    {
+	while (curbuf->b_u_oldhead != NULL)
+	    u_freeheader(curbuf->b_u_oldhead, uhpp);
+	return;
+    }
 
-    u_free_line((char_u *)uhp, FALSE);
+    if (uhp->uh_alt_prev != NULL)
+	uhp->uh_alt_prev->uh_alt_next = NULL;
+
+    next = uhp;
+    while (next != NULL)
+    {
+	tofree = next;
+	if (tofree->uh_alt_next != NULL)
+	    u_freebranch(tofree->uh_alt_next, uhpp);	    /* recursive */
+	next = tofree->uh_prev;
+	u_freeentries(tofree, uhpp);
+    }
+}
+
+/*
+ * u_freeentries: free the entry list of header "uhp" and the header itself.
+ */
+    static void
+u_freeentries(uhp, uhpp)
+    u_header_T	*uhp;
+    u_header_T	**uhpp;
+{
+    u_entry_T	*uep, *nuep;
+
+    /* Check for pointers to the header that become invalid now. */
+    if (curbuf->b_u_curhead == uhp)
+	curbuf->b_u_curhead = NULL;
+    if (curbuf->b_u_newhead == uhp)
+	curbuf->b_u_newhead = NULL;
+    if (uhpp != NULL && uhp == *uhpp)
+	*uhpp = NULL;
+
+    for (uep = uhp->uh_entry; uep != NULL; uep = nuep)
+    {
+	nuep = uep->ue_next;
+	u_freeentry(uep, uep->ue_size);
+    }
+
+    u_free_line((char_u *)uhp);
     --curbuf->b_u_numhead;
 }
 
@@ -895,8 +1421,152 @@ u_freeentry(uep, n)
     long	    n;
 {
     while (n)
-	u_free_line(uep->ue_array[--n], FALSE);
-    u_free_line((char_u *)uep, FALSE);
+	u_free_line(uep->ue_array[--n]);
+    u_free_line((char_u *)uep->ue_array);
+    u_free_line(uep->ue_delta);
+    u_free_line((char_u *)uep);
+}
+
+/*
+ * Return "line" stored as the difference with "base", allocated with
+ * u_alloc_line().  Returns NULL when this doesn't save enough memory.
+ */
+    static char_u *
+u_delta_make(line, base)
+    char_u	*line;
+    char_u	*base;
+{
+    colnr_T	len, blen;
+    colnr_T	head, tail;
+    u_delta_T	*dp;
+
+    len = (colnr_T)STRLEN(line);
+    if (len <= (colnr_T)sizeof(u_delta_T) + UD_MINSAVE)
+	return NULL;
+    blen = (colnr_T)STRLEN(base);
+
+    for (head = 0; line[head] != NUL && line[head] == base[head]; ++head)
+	;
+    for (tail = 0; tail < len - head && tail < blen - head
+			     && line[len - 1 - tail] == base[blen - 1 - tail];
+									++tail)
+	;
+    len -= head + tail;
+    if (head + tail < (colnr_T)sizeof(u_delta_T) + UD_MINSAVE)
+	return NULL;
+
+    dp = (u_delta_T *)u_alloc_line((unsigned)(sizeof(u_delta_T) + len));
+    if (dp == NULL)
+	return NULL;
+    dp->ud_head = head;
+    dp->ud_tail = tail;
+    mch_memmove(dp->ud_text, line + head, (size_t)len);
+    dp->ud_text[len] = NUL;
+    return (char_u *)dp;
+}
+
+/*
+ * Return the line for "delta", made with u_delta_make() with the same text
+ * as "base".  Returns NULL when out of memory.
+ */
+    static char_u *
+u_delta_apply(delta, base)
+    char_u	*delta;
+    char_u	*base;
+{
+    u_delta_T	*dp = (u_delta_T *)delta;
+    colnr_T	blen, head, tail, len;
+    char_u	*p;
+
+    blen = (colnr_T)STRLEN(base);
+    head = dp->ud_head;
+    tail = dp->ud_tail;
+    if (head > blen)		/* should never happen */
+	head = blen;
+    if (tail > blen - head)
+	tail = blen - head;
+    len = (colnr_T)STRLEN(dp->ud_text);
+
+    p = u_alloc_line((unsigned)(head + len + tail));
+    if (p != NULL)
+    {
+	mch_memmove(p, base, (size_t)head);
+	mch_memmove(p + head, dp->ud_text, (size_t)len);
+	mch_memmove(p + head + len, base + blen - tail, (size_t)tail);
+	p[head + len + tail] = NUL;
+    }
+    return p;
+}
+
+/*
+ * Store the lines of entry "uep" as the difference with the "count" lines in
+ * the buffer starting at "lnum", when that saves memory.  These lines must
+ * have the same text when the entry is used for undo/redo.
+ */
+    static void
+u_compress_entry(uep, lnum, count)
+    u_entry_T	*uep;
+    linenr_T	lnum;
+    long	count;
+{
+    long	i;
+    char_u	*p;
+
+    if (count > uep->ue_size)
+	count = uep->ue_size;
+    for (i = 0; i < count; ++i)
+    {
+	if ((uep->ue_delta != NULL && uep->ue_delta[i])
+						   || uep->ue_array[i] == NULL)
+	    continue;
+	p = u_delta_make(uep->ue_array[i], ml_get(lnum + i));
+	if (p == NULL)
+	    continue;
+	if (uep->ue_delta == NULL)
+	{
+	    uep->ue_delta = u_alloc_line((unsigned)uep->ue_size);
+	    if (uep->ue_delta == NULL)
+	    {
+		u_free_line(p);
+		return;
+	    }
+	    vim_memset(uep->ue_delta, FALSE, (size_t)uep->ue_size);
+	}
+	u_free_line(uep->ue_array[i]);
+	uep->ue_array[i] = p;
+	uep->ue_delta[i] = TRUE;
+    }
+}
+
+/*
+ * Turn the lines of entry "uep" that are stored as a difference back into
+ * full lines.  The buffer lines starting at "lnum" must be the same as when
+ * u_compress_entry() was used.
+ * Returns FAIL when out of memory.
+ */
+    static int
+u_expand_entry(uep, lnum)
+    u_entry_T	*uep;
+    linenr_T	lnum;
+{
+    long	i;
+    char_u	*p;
+
+    if (uep->ue_delta == NULL)
+	return OK;
+    for (i = 0; i < uep->ue_size; ++i)
+	if (uep->ue_delta[i])
+	{
+	    p = u_delta_apply(uep->ue_array[i], ml_get(lnum + i));
+	    if (p == NULL)
+		return FAIL;
+	    u_free_line(uep->ue_array[i]);
+	    uep->ue_array[i] = p;
+	    uep->ue_delta[i] = FALSE;
+	}
+    u_free_line(uep->ue_delta);
+    uep->ue_delta = NULL;
+    return OK;
 }
 
 /*
@@ -909,6 +1579,7 @@ u_clearall(buf)
     buf->b_u_newhead = buf->b_u_oldhead = buf->b_u_curhead = NULL;
     buf->b_u_synced = TRUE;
     buf->b_u_numhead = 0;
+    buf->b_u_seq_last = 0;
     buf->b_u_line_ptr = NULL;
     buf->b_u_line_lnum = 0;
 }
@@ -943,7 +1614,7 @@ u_clearline()
 {
     if (curbuf->b_u_line_ptr != NULL)
     {
-	u_free_line(curbuf->b_u_line_ptr, FALSE);
+	u_free_line(curbuf->b_u_line_ptr);
 	curbuf->b_u_line_ptr = NULL;
 	curbuf->b_u_line_lnum = 0;
     }
@@ -981,7 +1652,7 @@ u_undoline()
     }
     ml_replace(curbuf->b_u_line_lnum, curbuf->b_u_line_ptr, TRUE);
     changed_bytes(curbuf->b_u_line_lnum, 0);
-    u_free_line(curbuf->b_u_line_ptr, FALSE);
+    u_free_line(curbuf->b_u_line_ptr);
     curbuf->b_u_line_ptr = oldp;
 
     t = curbuf->b_u_line_colnr;
@@ -996,98 +1667,133 @@ u_undoline()
  */
 
 /*
- * Memory is allocated in relatively large blocks. These blocks are linked
- * in the allocated block list, headed by curbuf->b_block_head. They are all
- * freed when abandoning a file, so we don't have to free every single line.
- * The list is kept sorted on memory address.
- * block_alloc() allocates a block.
- * m_blockfree() frees all blocks.
- *
- * The available chunks of memory are kept in free chunk lists. There is
- * one free list for each block of allocated memory. The list is kept sorted
- * on memory address.
- * u_alloc_line() gets a chunk from the free lists.
- * u_free_line() returns a chunk to the free lists.
- * curbuf->b_m_search points to the chunk before the chunk that was
- * freed/allocated the last time.
- * curbuf->b_mb_current points to the b_head where curbuf->b_m_search
- * points into the free list.
+ * Memory is allocated in blocks that are divided in chunks of one size
+ * class.  All blocks are linked in the allocated block list, headed by
+ * curbuf->b_block_head.  They are all freed when abandoning a file, so we
+ * don't have to free every single line.
+ * u_blockalloc() allocates a block.
+ * u_blockfree() frees all blocks.
  *
+ * Each block keeps a list of its free chunks.  The blocks of a size class
+ * that have a free chunk are linked in curbuf->b_mb_free[class].
+ * u_alloc_line() takes the first free chunk of the first block in that list.
+ * u_free_line() puts a chunk back in the list of the block it is in, which is
+ * found through the header in front of the chunk.  Neither has to search, no
+ * matter how many lines are saved.  When all chunks of a block are free it is
+ * released, unless it is the only block of its class with free chunks.
  *
- *  b_block_head     /---> block #1	/---> block #2
- *	 mb_next ---/	    mb_next ---/       mb_next ---> NULL
- *	 mb_info	    mb_info	       mb_info
- *	    |		       |		  |
- *	    V		       V		  V
- *	  NULL		free chunk #1.1      free chunk #2.1
- *			       |		  |
- *			       V		  V
- *			free chunk #1.2		 NULL
- *			       |
- *			       V
- *			      NULL
+ *  b_block_head ---> block #1 ---> block #2 ---> block #3 ---> NULL
+ *			mb_free	      mb_free	    mb_free
+ *			   |		 |	       |
+ *			   V		 V	       V
+ *			  NULL	   free chunk	  free chunk
+ *				       |	       |
+ *				       V	       V
+ *				   free chunk	      NULL
  *
- * When a single free chunk list would have been used, it could take a lot
- * of time in u_free_line() to find the correct place to insert a chunk in the
- * free list. The single free list would become very long when many lines are
- * changed (e.g. with :%s/^M$//).
+ * Chunks that don't fit in the largest size class get a block of their own,
+ * with size class MB_LARGE.
  */
 
- /*
-  * this blocksize is used when allocating new lines
-  */
-#define MEMBLOCKSIZE 2044
-
 /*
- * The size field contains the size of the chunk, including the size field
- * itself.
- *
- * When the chunk is not in-use it is preceded with the m_info structure.
- * The m_next field links it in one of the free chunk lists.
- *
- * On most unix systems structures have to be longword (32 or 64 bit) aligned.
- * On most other systems they are short (16 bit) aligned.
+ * Size of the chunks for each size class, excluding the header.  Must be a
+ * multiple of ALIGN_SIZE.
  */
+static short_u mb_class_size[MB_CLASSES] =
+	{16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
 
-/* the structure definitions are now in structs.h */
+/*
+ * Size of a block for chunks of a size class; it has at least MB_MINCHUNKS
+ * chunks.
+ */
+#define MB_BLOCKSIZE 4096
+#define MB_MINCHUNKS 4
 
-#ifdef ALIGN_LONG
-    /* size of m_size */
-# define M_OFFSET (sizeof(long_u))
-#else
-    /* size of m_size */
-# define M_OFFSET (sizeof(short_u))
-#endif
+/* size of the header in front of each chunk */
+#define M_OFFSET (sizeof(minfo_T))
 
 /*
- * Allocate a block of memory and link it in the allocated block list.
+ * Allocate a block for size class "c" and link it in the allocated block
+ * list.  For MB_LARGE the block has one chunk of "size" bytes, which is
+ * returned.  Otherwise the block is divided in chunks that are put in the free
+ * list of the block, and the block is put in front of b_mb_free[c].
  */
-    static char_u *
-u_blockalloc(size)
+    static mblock_T *
+u_blockalloc(c, size)
+    int		c;
     long_u	size;
 {
-    mblock_T	*p;
-    mblock_T	*mp, *next;
+    mblock_T	*mbp;
+    minfo_T	*mp;
+    long_u	csize;
+    int		n;
 
-    p = (mblock_T *)lalloc(size + sizeof(mblock_T), FALSE);
-    if (p != NULL)
+    if (c == MB_LARGE)
     {
-	 /* Insert the block into the allocated block list, keeping it
-		    sorted on address. */
-	for (mp = &curbuf->b_block_head;
-		(next = mp->mb_next) != NULL && next < p;
-			mp = next)
-	    ;
-	p->mb_next = next;		/* link in block list */
-	p->mb_size = size;
-	mp->mb_next = p;
-	p->mb_info.m_next = NULL;	/* clear free list */
-	p->mb_info.m_size = 0;
-	curbuf->b_mb_current = p;	/* remember current block */
-	curbuf->b_m_search = NULL;
-	p++;				/* return usable memory */
+	csize = (size + ALIGN_MASK) & ~ALIGN_MASK;
+	n = 1;
     }
-    return (char_u *)p;
+    else
+    {
+	csize = mb_class_size[c];
+	n = MB_BLOCKSIZE / (M_OFFSET + csize);
+	if (n < MB_MINCHUNKS)
+	    n = MB_MINCHUNKS;
+    }
+
+    mbp = (mblock_T *)lalloc((long_u)sizeof(mblock_T)
+					     + n * (M_OFFSET + csize), FALSE);
+    if (mbp == NULL)
+	return NULL;
+    mbp->mb_class = c;
+    mbp->mb_size = n * (M_OFFSET + csize);
+    mbp->mb_used = 0;
+    mbp->mb_free = NULL;
+    mbp->mb_free_next = NULL;
+    mbp->mb_free_prev = NULL;
+
+    /* Link in the allocated block list. */
+    mbp->mb_prev = NULL;
+    mbp->mb_next = curbuf->b_block_head;
+    if (mbp->mb_next != NULL)
+	mbp->mb_next->mb_prev = mbp;
+    curbuf->b_block_head = mbp;
+    curbuf->b_mb_alloc += (long_u)sizeof(mblock_T) + mbp->mb_size;
+    ++curbuf->b_mb_count;
+
+    if (c != MB_LARGE)
+    {
+	/* Put all chunks in the free list, the first one in front. */
+	while (--n >= 0)
+	{
+	    mp = (minfo_T *)((char_u *)(mbp + 1) + n * (M_OFFSET + csize));
+	    mp->m_next = mbp->mb_free;
+	    mbp->mb_free = mp;
+	}
+	mbp->mb_free_next = curbuf->b_mb_free[c];
+	if (mbp->mb_free_next != NULL)
+	    mbp->mb_free_next->mb_free_prev = mbp;
+	curbuf->b_mb_free[c] = mbp;
+    }
+    return mbp;
+}
+
+/*
+ * Remove block "mbp" from the allocated block list and free it.
+ */
+    static void
+u_blockrelease(mbp)
+    mblock_T	*mbp;
+{
+    if (mbp->mb_prev == NULL)
+	curbuf->b_block_head = mbp->mb_next;
+    else
+	mbp->mb_prev->mb_next = mbp->mb_next;
+    if (mbp->mb_next != NULL)
+	mbp->mb_next->mb_prev = mbp->mb_prev;
+    curbuf->b_mb_alloc -= (long_u)sizeof(mblock_T) + mbp->mb_size;
+    --curbuf->b_mb_count;
+    vim_free(mbp);
 }
 
 /*
@@ -1098,139 +1804,72 @@ u_blockfree(buf)
     buf_T	*buf;
 {
     mblock_T	*p, *np;
+    int		c;
 
-    for (p = buf->b_block_head.mb_next; p != NULL; p = np)
+    for (p = buf->b_block_head; p != NULL; p = np)
     {
 	np = p->mb_next;
 	vim_free(p);
     }
-    buf->b_block_head.mb_next = NULL;
-    buf->b_m_search = NULL;
-    buf->b_mb_current = NULL;
+    buf->b_block_head = NULL;
+    for (c = 0; c < MB_CLASSES; ++c)
+	buf->b_mb_free[c] = NULL;
+    buf->b_mb_alloc = 0;
+    buf->b_mb_inuse = 0;
+    buf->b_mb_count = 0;
 }
 
 /*
  * Free a chunk of memory for the current buffer.
- * Insert the chunk into the correct free list, keeping it sorted on address.
+ * Put the chunk in the free list of its block.
  */
     static void
-u_free_line(ptr, keep)
+u_free_line(ptr)
     char_u	*ptr;
-    int		keep;	/* don't free the block when it's empty */
 {
-    minfo_T	*next;
-    minfo_T	*prev, *curr;
     minfo_T	*mp;
-    mblock_T	*nextb;
-    mblock_T	*prevb;
+    mblock_T	*mbp;
+    int		c;
 
     if (ptr == NULL || ptr == IObuff)
 	return;	/* illegal address can happen in out-of-memory situations */
 
-    mp = (minfo_T *)(ptr - M_OFFSET);
-
-    /* find block where chunk could be a part off */
-    /* if we change curbuf->b_mb_current, curbuf->b_m_search is set to NULL */
-    if (curbuf->b_mb_current == NULL || mp < (minfo_T *)curbuf->b_mb_current)
-    {
-	curbuf->b_mb_current = curbuf->b_block_head.mb_next;
-	curbuf->b_m_search = NULL;
-    }
-    if ((nextb = curbuf->b_mb_current->mb_next) != NULL
-						     && (minfo_T *)nextb < mp)
-    {
-	curbuf->b_mb_current = nextb;
-	curbuf->b_m_search = NULL;
-    }
-    while ((nextb = curbuf->b_mb_current->mb_next) != NULL
-						     && (minfo_T *)nextb < mp)
-	curbuf->b_mb_current = nextb;
-
-    curr = NULL;
-    /*
-     * If mp is smaller than curbuf->b_m_search->m_next go to the start of
-     * the free list
-     */
-    if (curbuf->b_m_search == NULL || mp < (curbuf->b_m_search->m_next))
-	next = &(curbuf->b_mb_current->mb_info);
-    else
-	next = curbuf->b_m_search;
-    /*
-     * The following loop is executed very often.
-     * Therefore it has been optimized at the cost of readability.
-     * Keep it fast!
-     */
-#ifdef SLOW_BUT_EASY_TO_READ
-    do
-    {
-	prev = curr;
-	curr = next;
-	next = next->m_next;
-    }
-    while (mp > next && next != NULL);
-#else
-    do					    /* first, middle, last */
-    {
-	prev = next->m_next;		    /* curr, next, prev */
-	if (prev == NULL || mp <= prev)
-	{
-	    prev = curr;
-	    curr = next;
-	    next = next->m_next;
-	    break;
-	}
-	curr = prev->m_next;		    /* next, prev, curr */
-	if (curr == NULL || mp <= curr)
-	{
-	    prev = next;
-	    curr = prev->m_next;
-	    next = curr->m_next;
-	    break;
-	}
-	next = curr->m_next;		    /* prev, curr, next */
-    }
-    while (mp > next && next != NULL);
-#endif
-
-    /* if *mp and *next are concatenated, join them into one chunk */
-    if ((char_u *)mp + mp->m_size == (char_u *)next)
+    mp = (minfo_T *)ptr - 1;
+    mbp = mp->m_block;
+    c = mbp->mb_class;
+    if (c == MB_LARGE)
     {
-	mp->m_size += next->m_size;
-	mp->m_next = next->m_next;
+	curbuf->b_mb_inuse -= mbp->mb_size;
+	u_blockrelease(mbp);
+	return;
     }
-    else
-	mp->m_next = next;
+    curbuf->b_mb_inuse -= mb_class_size[c];
 
-    /* if *curr and *mp are concatenated, join them */
-    if (prev != NULL && (char_u *)curr + curr->m_size == (char_u *)mp)
+    /* A full block is not in the list of blocks with free chunks, put it in
+     * front now. */
+    if (mbp->mb_free == NULL)
     {
-	curr->m_size += mp->m_size;
-	curr->m_next = mp->m_next;
-	curbuf->b_m_search = prev;
-    }
-    else
-    {
-	curr->m_next = mp;
-	curbuf->b_m_search = curr;  /* put curbuf->b_m_search before freed
-				       chunk */
+	mbp->mb_free_next = curbuf->b_mb_free[c];
+	if (mbp->mb_free_next != NULL)
+	    mbp->mb_free_next->mb_free_prev = mbp;
+	mbp->mb_free_prev = NULL;
+	curbuf->b_mb_free[c] = mbp;
     }
+    mp->m_next = mbp->mb_free;
+    mbp->mb_free = mp;
 
-    /*
-     * If the block only containes free memory now, release it.
-     */
-    if (!keep && curbuf->b_mb_current->mb_size
-			      == curbuf->b_mb_current->mb_info.m_next->m_size)
+    /* Release a block without used chunks, unless it's the only one with free
+     * chunks, to avoid allocating it again right away. */
+    if (--mbp->mb_used == 0
+		     && (mbp->mb_free_prev != NULL || mbp->mb_free_next != NULL))
     {
-	/* Find the block before the current one to be able to unlink it from
-	 * the list of blocks. */
-	prevb = &curbuf->b_block_head;
-	for (nextb = prevb->mb_next; nextb != curbuf->b_mb_current;
-						       nextb = nextb->mb_next)
-	    prevb = nextb;
-	prevb->mb_next = nextb->mb_next;
-	vim_free(nextb);
-	curbuf->b_mb_current = NULL;
-	curbuf->b_m_search = NULL;
+	if (mbp->mb_free_prev == NULL)
+	    curbuf->b_mb_free[c] = mbp->mb_free_next;
+	else
+	    mbp->mb_free_prev->mb_free_next = mbp->mb_free_next;
+	if (mbp->mb_free_next != NULL)
+	    mbp->mb_free_next->mb_free_prev = mbp->mb_free_prev;
+	u_blockrelease(mbp);
     }
 }
 
@@ -1242,96 +1881,49 @@ u_free_line(ptr, keep)
 u_alloc_line(size)
     unsigned	size;
 {
-    minfo_T	*mp, *mprev, *mp2;
+    minfo_T	*mp;
     mblock_T	*mbp;
-    int		size_align;
-
-    /*
-     * Add room for size field and trailing NUL byte.
-     * Adjust for minimal size (must be able to store minfo_T
-     * plus a trailing NUL, so the chunk can be released again)
-     */
-    size += M_OFFSET + 1;
-    if (size < sizeof(minfo_T) + 1)
-	size = sizeof(minfo_T) + 1;
+    long_u	need;
+    int		c;
 
-    /*
-     * round size up for alignment
-     */
-    size_align = (size + ALIGN_MASK) & ~ALIGN_MASK;
-
-    /*
-     * If curbuf->b_m_search is NULL (uninitialized free list) start at
-     * curbuf->b_block_head
-     */
-    if (curbuf->b_mb_current == NULL || curbuf->b_m_search == NULL)
-    {
-	curbuf->b_mb_current = &curbuf->b_block_head;
-	curbuf->b_m_search = &(curbuf->b_block_head.mb_info);
-    }
+    need = (long_u)size + 1;	    /* add room for the trailing NUL */
+    for (c = 0; c < MB_CLASSES && mb_class_size[c] < need; ++c)
+	;
 
-    /* search for space in free list */
-    mprev = curbuf->b_m_search;
-    mbp = curbuf->b_mb_current;
-    mp = curbuf->b_m_search->m_next;
-    if (mp == NULL)
+    if (c == MB_LARGE)
     {
-	if (mbp->mb_next)
-	    mbp = mbp->mb_next;
-	else
-	    mbp = &curbuf->b_block_head;
-	mp = curbuf->b_m_search = &(mbp->mb_info);
+	/* Too big for a size class: a block for this chunk only. */
+	mbp = u_blockalloc(MB_LARGE, need);
+	if (mbp == NULL)
+	    return NULL;
+	mp = (minfo_T *)(mbp + 1);
+	curbuf->b_mb_inuse += mbp->mb_size;
     }
-    while (mp->m_size < size)
+    else
     {
-	if (mp == curbuf->b_m_search)	    /* back where we started in free
-					       chunk list */
+	mbp = curbuf->b_mb_free[c];
+	if (mbp == NULL && (mbp = u_blockalloc(c, 0L)) == NULL)
+	    return NULL;
+	mp = mbp->mb_free;
+	mbp->mb_free = mp->m_next;
+
+	/* When the block is full now remove it from the list of blocks with
+	 * free chunks.  It's always the first one. */
+	if (mbp->mb_free == NULL)
 	{
-	    if (mbp->mb_next)
-		mbp = mbp->mb_next;
-	    else
-		mbp = &curbuf->b_block_head;
-	    mp = curbuf->b_m_search = &(mbp->mb_info);
-	    if (mbp == curbuf->b_mb_current)	/* back where we started in
-						   block list */
-	    {
-		int	n = (size_align > (MEMBLOCKSIZE / 4)
-						 ? size_align : MEMBLOCKSIZE);
-
-		mp = (minfo_T *)u_blockalloc((long_u)n);
-		if (mp == NULL)
-		    return (NULL);
-		mp->m_size = n;
-		u_free_line((char_u *)mp + M_OFFSET, TRUE);
-		mp = curbuf->b_m_search;
-		mbp = curbuf->b_mb_current;
-	    }
+	    curbuf->b_mb_free[c] = mbp->mb_free_next;
+	    if (mbp->mb_free_next != NULL)
+		mbp->mb_free_next->mb_free_prev = NULL;
+	    mbp->mb_free_next = NULL;
 	}
-	mprev = mp;
-	if ((mp = mp->m_next) == NULL)	    /* at end of the list */
-	    mp = &(mbp->mb_info);	    /* wrap around to begin */
+	curbuf->b_mb_inuse += mb_class_size[c];
     }
+    ++mbp->mb_used;
+    mp->m_block = mbp;
 
-    /* if the chunk we found is large enough, split it up in two */
-    if ((long)mp->m_size - size_align >= (long)(sizeof(minfo_T) + 1))
-    {
-	mp2 = (minfo_T *)((char_u *)mp + size_align);
-	mp2->m_size = mp->m_size - size_align;
-	mp2->m_next = mp->m_next;
-	mprev->m_next = mp2;
-	mp->m_size = size_align;
-    }
-    else		    /* remove *mp from the free list */
-    {
-	mprev->m_next = mp->m_next;
-    }
-    curbuf->b_m_search = mprev;
-    curbuf->b_mb_current = mbp;
-
-    mp = (minfo_T *)((char_u *)mp + M_OFFSET);
+    ++mp;
     *(char_u *)mp = NUL;		    /* set the first byte to NUL */
-
-    return ((char_u *)mp);
+    return (char_u *)mp;
 }
 
 /*
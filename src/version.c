@@ -411,6 +411,11 @@ static char *(features[]) =
 #else
 	"-printer",
 #endif
+#ifdef FEAT_PROFILE
+	"+profile",
+#else
+	"-profile",
+#endif
 #ifdef FEAT_PYTHON
 # ifdef DYNAMIC_PYTHON
 	"+python/dyn",
@@ -459,6 +464,11 @@ static char *(features[]) =
 #else
 	"-sniff",
 #endif
+#ifdef FEAT_STARTUPTIME
+	"+startuptime",
+#else
+	"-startuptime",
+#endif
 #ifdef FEAT_STL_OPT
 	"+statusline",
 #else
@@ -483,6 +493,11 @@ static char *(features[]) =
 #else
 	"-tag_binary",
 #endif
+#ifdef FEAT_TAG_INDEX
+	"+tag_index",
+#else
+	"-tag_index",
+#endif
 #ifdef FEAT_TAG_OLDSTATIC
 	"+tag_old_static",
 #else
@@ -493,6 +508,11 @@ static char *(features[]) =
 #else
 	"-tag_any_white",
 #endif
+#ifdef FEAT_TAG_XREF
+	"+tag_xref",
+#else
+	"-tag_xref",
+#endif
 #ifdef FEAT_TCL
 # ifdef DYNAMIC_TCL
 	"+tcl/dyn",
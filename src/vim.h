@@ -542,6 +542,12 @@ extern char* (*dyn_libintl_textdomain)(const char* domainname);
 # define OK			1
 #endif
 #define FAIL			0
+#define NOTDONE			2	/* not OK or FAIL but skipped */
+
+/* Values for do_profiling */
+#define PROF_NONE	0	/* profiling not started */
+#define PROF_YES	1	/* profiling busy */
+#define PROF_PAUSED	2	/* profiling paused */
 
 /* flags for b_flags */
 #define BF_RECOVERED	0x01	/* buffer has been recovered */
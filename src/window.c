@@ -3148,6 +3148,10 @@ win_free(wp)
 #ifdef FEAT_SEARCH_EXTRA
     vim_free(wp->w_match.regprog);
 #endif
+#ifdef FEAT_STL_OPT
+    stl_clear_cache(&wp->w_stl_cache);
+    stl_clear_cache(&wp->w_ruf_cache);
+#endif
 #ifdef FEAT_JUMPLIST
     free_jumplist(wp);
 #endif